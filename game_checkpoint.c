@@ -0,0 +1,203 @@
+#include "game_checkpoint.h"
+#include "laser_tag_arena.h"
+#include <furi.h>
+#include <storage/storage.h>
+#include <toolbox/crc32_calc.h>
+
+#define TAG "GameCheckpoint"
+
+#define GAME_CHECKPOINT_PATH      APP_DATA_PATH("checkpoint.bin")
+#define GAME_CHECKPOINT_TEMP_PATH APP_DATA_PATH("checkpoint.tmp")
+
+#define GAME_CHECKPOINT_MAGIC   0x4B43544C // "LTCK"
+#define GAME_CHECKPOINT_VERSION 1
+
+// The record, a storage round trip and a log line at once.
+#define GAME_CHECKPOINT_STACK_SIZE (2 * 1024)
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size; // of the whole record
+    GameCheckpointData data;
+    uint32_t crc; // over everything before it
+} GameCheckpointRecord;
+
+typedef enum {
+    GameCheckpointOpNone,
+    GameCheckpointOpSave,
+    GameCheckpointOpDiscard,
+} GameCheckpointOp;
+
+typedef enum {
+    GameCheckpointEventStop = (1 << 0),
+    GameCheckpointEventWork = (1 << 1),
+    GameCheckpointEventAll = (GameCheckpointEventStop | GameCheckpointEventWork),
+} GameCheckpointEventType;
+
+struct GameCheckpoint {
+    Storage* storage;
+    FuriThread* thread;
+    GameCheckpointOp op; // guarded by a critical section, as is pending
+    GameCheckpointData pending;
+    GameCheckpointData loaded;
+    uint32_t stack_free; // set by the thread as it stops
+};
+
+LASER_TAG_ARENA_CHECK(GameCheckpoint, LASER_TAG_ARENA_GAME_CHECKPOINT_SIZE);
+
+static uint32_t game_checkpoint_crc(const GameCheckpointRecord* record) {
+    return crc32_calc_buffer(0, record, offsetof(GameCheckpointRecord, crc));
+}
+
+static bool game_checkpoint_read(Storage* storage, const char* path, GameCheckpointData* data) {
+    GameCheckpointRecord record;
+    File* file = storage_file_alloc(storage);
+    bool valid = false;
+    if(storage_file_open(file, path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        valid = storage_file_read(file, &record, sizeof(record)) == sizeof(record) &&
+                record.magic == GAME_CHECKPOINT_MAGIC &&
+                record.version == GAME_CHECKPOINT_VERSION && record.size == sizeof(record) &&
+                record.crc == game_checkpoint_crc(&record);
+        storage_file_close(file);
+    }
+    storage_file_free(file);
+
+    if(valid) {
+        *data = record.data;
+    }
+    return valid;
+}
+
+static bool game_checkpoint_write(Storage* storage, const GameCheckpointData* data) {
+    GameCheckpointRecord record = {
+        .magic = GAME_CHECKPOINT_MAGIC,
+        .version = GAME_CHECKPOINT_VERSION,
+        .size = sizeof(GameCheckpointRecord),
+        .data = *data,
+    };
+    record.crc = game_checkpoint_crc(&record);
+
+    File* file = storage_file_alloc(storage);
+    bool written = false;
+    if(storage_file_open(file, GAME_CHECKPOINT_TEMP_PATH, FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
+        written = storage_file_write(file, &record, sizeof(record)) == sizeof(record) &&
+                  storage_file_sync(file);
+        storage_file_close(file);
+    }
+    storage_file_free(file);
+    if(!written) {
+        return false;
+    }
+
+    // Rename doesn't replace an existing file. If the app dies in between,
+    // the temporary file is complete and is loaded instead.
+    storage_common_remove(storage, GAME_CHECKPOINT_PATH);
+    return storage_common_rename(storage, GAME_CHECKPOINT_TEMP_PATH, GAME_CHECKPOINT_PATH) ==
+           FSE_OK;
+}
+
+// Runs on the checkpoint thread.
+static void game_checkpoint_work(GameCheckpoint* checkpoint) {
+    GameCheckpointOp op;
+    GameCheckpointData data;
+    FURI_CRITICAL_ENTER();
+    op = checkpoint->op;
+    data = checkpoint->pending;
+    checkpoint->op = GameCheckpointOpNone;
+    FURI_CRITICAL_EXIT();
+
+    if(op == GameCheckpointOpSave) {
+        uint32_t start = furi_get_tick();
+        if(game_checkpoint_write(checkpoint->storage, &data)) {
+            FURI_LOG_D(TAG, "Saved in %lu ticks", furi_get_tick() - start);
+        } else {
+            FURI_LOG_W(TAG, "Failed to save");
+        }
+    } else if(op == GameCheckpointOpDiscard) {
+        storage_common_remove(checkpoint->storage, GAME_CHECKPOINT_PATH);
+        storage_common_remove(checkpoint->storage, GAME_CHECKPOINT_TEMP_PATH);
+        FURI_LOG_D(TAG, "Discarded");
+    }
+}
+
+static int32_t game_checkpoint_thread(void* context) {
+    GameCheckpoint* checkpoint = context;
+
+    while(true) {
+        uint32_t flags =
+            furi_thread_flags_wait(GameCheckpointEventAll, FuriFlagWaitAny, FuriWaitForever);
+        if(flags & FuriFlagError) {
+            continue;
+        }
+        game_checkpoint_work(checkpoint);
+        if(flags & GameCheckpointEventStop) {
+            break;
+        }
+    }
+    checkpoint->stack_free = furi_thread_get_stack_space(furi_thread_get_current_id());
+    return 0;
+}
+
+GameCheckpoint* game_checkpoint_alloc(void) {
+    GameCheckpoint* checkpoint = laser_tag_arena_alloc(sizeof(GameCheckpoint));
+    checkpoint->storage = furi_record_open(RECORD_STORAGE);
+    checkpoint->op = GameCheckpointOpNone;
+    checkpoint->thread =
+        furi_thread_alloc_ex(
+        "game_checkpoint", GAME_CHECKPOINT_STACK_SIZE, game_checkpoint_thread, checkpoint);
+    furi_thread_set_priority(checkpoint->thread, FuriThreadPriorityLow);
+    furi_thread_start(checkpoint->thread);
+    return checkpoint;
+}
+
+void game_checkpoint_free(GameCheckpoint* checkpoint) {
+    furi_assert(checkpoint);
+    furi_thread_flags_set(furi_thread_get_id(checkpoint->thread), GameCheckpointEventStop);
+    furi_thread_join(checkpoint->thread);
+    furi_thread_free(checkpoint->thread);
+    furi_record_close(RECORD_STORAGE);
+    FURI_LOG_I(
+        TAG,
+        "Thread stack: %lu of %d bytes never used",
+        checkpoint->stack_free,
+        GAME_CHECKPOINT_STACK_SIZE);
+}
+
+bool game_checkpoint_load(GameCheckpoint* checkpoint) {
+    furi_assert(checkpoint);
+    if(game_checkpoint_read(checkpoint->storage, GAME_CHECKPOINT_PATH, &checkpoint->loaded) ||
+       game_checkpoint_read(checkpoint->storage, GAME_CHECKPOINT_TEMP_PATH, &checkpoint->loaded)) {
+        FURI_LOG_I(TAG, "Found a match to resume");
+        return true;
+    }
+    return false;
+}
+
+const GameCheckpointData* game_checkpoint_get_loaded(GameCheckpoint* checkpoint) {
+    furi_assert(checkpoint);
+    return &checkpoint->loaded;
+}
+
+static void game_checkpoint_post(
+    GameCheckpoint* checkpoint,
+    GameCheckpointOp op,
+    const GameCheckpointData* data) {
+    FURI_CRITICAL_ENTER();
+    checkpoint->op = op;
+    if(data) {
+        checkpoint->pending = *data;
+    }
+    FURI_CRITICAL_EXIT();
+    furi_thread_flags_set(furi_thread_get_id(checkpoint->thread), GameCheckpointEventWork);
+}
+
+void game_checkpoint_save(GameCheckpoint* checkpoint, const GameCheckpointData* data) {
+    furi_assert(checkpoint);
+    game_checkpoint_post(checkpoint, GameCheckpointOpSave, data);
+}
+
+void game_checkpoint_discard(GameCheckpoint* checkpoint) {
+    furi_assert(checkpoint);
+    game_checkpoint_post(checkpoint, GameCheckpointOpDiscard, NULL);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "game_state.h"
+#include "game_rules.h"
+
+/*
+ * Crash-safe checkpoint of the running match, so it can be resumed after the
+ * app crashed or was closed by accident. The checkpoint is one small
+ * versioned record with a CRC. It is written to a temporary file first and
+ * then renamed over the previous one, so there is always a complete
+ * checkpoint on the card.
+ *
+ * Saving only copies the record, a low-priority thread does the writing. If
+ * saves come in faster than the card takes them, only the latest is written.
+ */
+
+typedef struct {
+    GameStateSnapshot game;
+    GameRules rules;
+    uint32_t shot_counter; // see shot_auth_get_counter
+} GameCheckpointData;
+
+typedef struct GameCheckpoint GameCheckpoint;
+
+GameCheckpoint* game_checkpoint_alloc(void);
+
+/** Finishes a pending save or discard first. */
+void game_checkpoint_free(GameCheckpoint* checkpoint);
+
+/**
+ * Read the checkpoint from the card. Blocks on the card, so call it off the
+ * main thread.
+ *
+ * @returns true if there is a valid one, it is then kept for game_checkpoint_get_loaded.
+ */
+bool game_checkpoint_load(GameCheckpoint* checkpoint);
+const GameCheckpointData* game_checkpoint_get_loaded(GameCheckpoint* checkpoint);
+
+/** Never blocks. */
+void game_checkpoint_save(GameCheckpoint* checkpoint, const GameCheckpointData* data);
+
+/** Delete the checkpoint, e.g. when the match is over. Never blocks. */
+void game_checkpoint_discard(GameCheckpoint* checkpoint);
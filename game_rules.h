@@ -0,0 +1,15 @@
+#pragma once
+
+#include <infrared.h>
+
+/*
+ * Settings every player in a match has to agree on. They are picked before
+ * the match starts and stay fixed until it ends.
+ */
+typedef struct {
+    InfraredProtocol shot_protocol; // see shot_protocol.h
+    uint32_t match_key; // tournament mode if not 0, see shot_auth.h
+} GameRules;
+
+// NEC is what older builds of the app always used.
+#define GAME_RULES_DEFAULT {.shot_protocol = InfraredProtocolNEC, .match_key = 0}
@@ -1,26 +1,31 @@
 #include "game_state.h"
+#include "laser_tag_arena.h"
 #include <furi.h>
 #include <stdlib.h>
 
 struct GameState {
     LaserTagTeam team;
     uint8_t health;
+    uint8_t armor;
     uint16_t ammo;
-    uint32_t game_time;
+    uint16_t max_ammo;
+    uint32_t start_tick;
+    uint32_t end_tick; // the clock stops here once game_over is set
     bool game_over;
+    bool has_flag;
+    uint16_t captures;
 };
 
+LASER_TAG_ARENA_CHECK(GameState, LASER_TAG_ARENA_GAME_STATE_SIZE);
+
 GameState* game_state_alloc() {
-    GameState* state = malloc(sizeof(GameState));
+    GameState* state = laser_tag_arena_alloc(sizeof(GameState));
     if(!state) {
         FURI_LOG_E("GameState", "Failed to allocate GameState");
         return NULL;
     }
     state->team = TeamRed;
-    state->health = INITIAL_HEALTH;
-    state->ammo = INITIAL_AMMO;
-    state->game_time = 0;
-    state->game_over = false;
+    game_state_reset(state);
     FURI_LOG_I("GameState", "GameState allocated successfully");
     return state;
 }
@@ -28,9 +33,14 @@ GameState* game_state_alloc() {
 void game_state_reset(GameState* state) {
     furi_assert(state);
     state->health = INITIAL_HEALTH;
+    state->armor = 0;
     state->ammo = INITIAL_AMMO;
-    state->game_time = 0;
+    state->max_ammo = INITIAL_AMMO;
+    state->start_tick = furi_get_tick();
+    state->end_tick = state->start_tick;
     state->game_over = false;
+    state->has_flag = false;
+    state->captures = 0;
     FURI_LOG_I("GameState", "GameState reset");
 }
 
@@ -47,11 +57,15 @@ LaserTagTeam game_state_get_team(GameState* state) {
 
 void game_state_decrease_health(GameState* state, uint8_t amount) {
     furi_assert(state);
+    // Armor soaks up damage before health does.
+    uint8_t absorbed = MIN(state->armor, amount);
+    state->armor -= absorbed;
+    amount -= absorbed;
     if(state->health > amount) {
         state->health -= amount;
     } else {
         state->health = 0;
-        state->game_over = true;
+        game_state_set_game_over(state, true);
         FURI_LOG_W("GameState", "Health depleted, game over");
     }
     FURI_LOG_I("GameState", "Health decreased to %d", state->health);
@@ -68,6 +82,17 @@ uint8_t game_state_get_health(GameState* state) {
     return state->health;
 }
 
+void game_state_increase_armor(GameState* state, uint8_t amount) {
+    furi_assert(state);
+    state->armor = (state->armor + amount > MAX_ARMOR) ? MAX_ARMOR : state->armor + amount;
+    FURI_LOG_I("GameState", "Armor increased to %d", state->armor);
+}
+
+uint8_t game_state_get_armor(GameState* state) {
+    furi_assert(state);
+    return state->armor;
+}
+
 void game_state_decrease_ammo(GameState* state, uint16_t amount) {
     furi_assert(state);
     if(state->ammo > amount) {
@@ -90,15 +115,76 @@ uint16_t game_state_get_ammo(GameState* state) {
     return state->ammo;
 }
 
-void game_state_update_time(GameState* state, uint32_t delta_time) {
+void game_state_increase_max_ammo(GameState* state, uint16_t amount) {
+    furi_assert(state);
+    state->max_ammo = (state->max_ammo + amount > MAX_AMMO) ? MAX_AMMO : state->max_ammo + amount;
+    FURI_LOG_I("GameState", "Max ammo increased to %d", state->max_ammo);
+}
+
+uint16_t game_state_get_max_ammo(GameState* state) {
+    furi_assert(state);
+    return state->max_ammo;
+}
+
+void game_state_set_flag(GameState* state, bool has_flag) {
+    furi_assert(state);
+    state->has_flag = has_flag;
+    FURI_LOG_I("GameState", "Flag %s", has_flag ? "picked up" : "dropped");
+}
+
+bool game_state_has_flag(GameState* state) {
     furi_assert(state);
-    state->game_time += delta_time;
-    FURI_LOG_I("GameState", "Game time updated to %ld seconds", state->game_time);
+    return state->has_flag;
+}
+
+void game_state_add_capture(GameState* state) {
+    furi_assert(state);
+    state->captures++;
+    FURI_LOG_I("GameState", "Captures increased to %d", state->captures);
+}
+
+uint16_t game_state_get_captures(GameState* state) {
+    furi_assert(state);
+    return state->captures;
+}
+
+uint32_t game_state_get_time_ms(GameState* state) {
+    furi_assert(state);
+    uint32_t end_tick = state->game_over ? state->end_tick : furi_get_tick();
+    return (uint64_t)(end_tick - state->start_tick) * 1000 / furi_kernel_get_tick_frequency();
 }
 
 uint32_t game_state_get_time(GameState* state) {
+    return game_state_get_time_ms(state) / 1000;
+}
+
+void game_state_get_snapshot(GameState* state, GameStateSnapshot* snapshot) {
     furi_assert(state);
-    return state->game_time;
+    *snapshot = (GameStateSnapshot){
+        .team = state->team,
+        .health = state->health,
+        .armor = state->armor,
+        .has_flag = state->has_flag,
+        .ammo = state->ammo,
+        .max_ammo = state->max_ammo,
+        .captures = state->captures,
+        .time_ms = game_state_get_time_ms(state),
+    };
+}
+
+void game_state_restore(GameState* state, const GameStateSnapshot* snapshot) {
+    furi_assert(state);
+    state->team = (snapshot->team == TeamBlue) ? TeamBlue : TeamRed;
+    state->health = MIN(snapshot->health, MAX_HEALTH);
+    state->armor = MIN(snapshot->armor, MAX_ARMOR);
+    state->has_flag = snapshot->has_flag;
+    state->max_ammo = MIN(snapshot->max_ammo, MAX_AMMO);
+    state->ammo = snapshot->ammo;
+    state->captures = snapshot->captures;
+    state->start_tick = furi_get_tick() - furi_ms_to_ticks(snapshot->time_ms);
+    state->end_tick = state->start_tick;
+    state->game_over = (state->health == 0);
+    FURI_LOG_I("GameState", "GameState restored at %lu ms", snapshot->time_ms);
 }
 
 bool game_state_is_game_over(GameState* state) {
@@ -108,6 +194,17 @@ bool game_state_is_game_over(GameState* state) {
 
 void game_state_set_game_over(GameState* state, bool game_over) {
     furi_assert(state);
+    if(game_over && !state->game_over) {
+        state->end_tick = furi_get_tick();
+    }
     state->game_over = game_over;
     FURI_LOG_I("GameState", "Game over status set to %s", game_over ? "true" : "false");
 }
+
+void game_state_respawn(GameState* state) {
+    furi_assert(state);
+    state->health = MAX_HEALTH;
+    state->ammo = state->max_ammo;
+    state->game_over = false;
+    FURI_LOG_I("GameState", "Respawned at %lu ms", game_state_get_time_ms(state));
+}
@@ -13,10 +13,24 @@ typedef enum {
     LaserTagStateTeamSelect,
     LaserTagStateGame,
     LaserTagStateGameOver,
+    LaserTagStateResume, // offering to pick up a match from its checkpoint
+    LaserTagStateReferee, // listening only, see referee.h
 } LaserTagState;
 
 typedef struct GameState GameState;
 
+// Everything about a running match that is needed to pick it back up.
+typedef struct {
+    uint8_t team;
+    uint8_t health;
+    uint8_t armor;
+    bool has_flag;
+    uint16_t ammo;
+    uint16_t max_ammo;
+    uint16_t captures;
+    uint32_t time_ms;
+} GameStateSnapshot;
+
 GameState* game_state_alloc();
 void game_state_reset(GameState* state);
 
@@ -27,16 +41,37 @@ void game_state_decrease_health(GameState* state, uint8_t amount);
 void game_state_increase_health(GameState* state, uint8_t amount);
 uint8_t game_state_get_health(GameState* state);
 
+void game_state_increase_armor(GameState* state, uint8_t amount);
+uint8_t game_state_get_armor(GameState* state);
+
 void game_state_decrease_ammo(GameState* state, uint16_t amount);
 void game_state_increase_ammo(GameState* state, uint16_t amount);
 uint16_t game_state_get_ammo(GameState* state);
 
-void game_state_update_time(GameState* state, uint32_t delta_time);
+void game_state_increase_max_ammo(GameState* state, uint16_t amount);
+uint16_t game_state_get_max_ammo(GameState* state);
+
+void game_state_set_flag(GameState* state, bool has_flag);
+bool game_state_has_flag(GameState* state);
+void game_state_add_capture(GameState* state);
+uint16_t game_state_get_captures(GameState* state);
+
+// The clock runs from the last reset until game over, in seconds or milliseconds.
+// After a respawn it shows the match time again, time spent out included.
 uint32_t game_state_get_time(GameState* state);
+uint32_t game_state_get_time_ms(GameState* state);
+
+void game_state_get_snapshot(GameState* state, GameStateSnapshot* snapshot);
+/** Continue a match from a snapshot, the clock picks up where it stopped. */
+void game_state_restore(GameState* state, const GameStateSnapshot* snapshot);
 
 bool game_state_is_game_over(GameState* state);
 void game_state_set_game_over(GameState* state, bool game_over);
+/** Back into the match after game over, with full health and a full magazine. */
+void game_state_respawn(GameState* state);
 
 #define INITIAL_HEALTH 100
 #define INITIAL_AMMO   100
 #define MAX_HEALTH     100
+#define MAX_ARMOR      100
+#define MAX_AMMO       250
@@ -1,5 +1,8 @@
 #include "infrared_controller.h"
+#include "laser_tag_arena.h"
+#include "shot_trace.h"
 #include <furi.h>
+#include <furi_hal.h>
 #include <infrared_worker.h>
 #include <infrared_signal.h>
 #include <notification/notification_messages.h>
@@ -9,6 +12,12 @@
 
 #define TAG "InfraredController"
 
+// Boards are plugged in by hand, so a change has to be seen on two polls in a
+// row before it counts. That filters out contact bounce while the module is
+// being seated.
+#define INFRARED_BOARD_POLL_MS  500
+#define INFRARED_BOARD_DEBOUNCE 2
+
 const NotificationSequence sequence_hit = {
     &message_vibro_on,
     &message_note_d4,
@@ -27,7 +36,14 @@ const NotificationSequence sequence_bloop = {
 
 extern const NotificationSequence sequence_short_beep;
 
-static bool external_board_connected = false;
+LASER_TAG_ARENA_CHECK(InfraredController, LASER_TAG_ARENA_INFRARED_CONTROLLER_SIZE);
+
+static void
+    infrared_controller_notify(InfraredController* controller, InfraredControllerEvent event) {
+    if(controller->callback) {
+        controller->callback(event, controller->callback_context);
+    }
+}
 
 static void infrared_setup_external_board(bool enable) {
     if(enable) {
@@ -41,45 +57,162 @@ static void infrared_setup_external_board(bool enable) {
     }
 }
 
-void update_infrared_board_status(InfraredController* controller) {
-    if(!controller || !controller->notification) return;
+// Runs on the timer thread, which every timer and pending callback shares, so
+// it never waits: a shot being transmitted just skips this poll.
+static void infrared_board_monitor_callback(void* context) {
+    InfraredController* controller = context;
+
+    if(furi_mutex_acquire(controller->tx_mutex, 0) != FuriStatusOk) {
+        controller->board_stats.skipped++;
+        return;
+    }
+
+    uint32_t start = DWT->CYCCNT;
+    bool connected = furi_hal_infrared_detect_tx_output() == FuriHalInfraredTxPinExtPA7;
+    uint32_t probe_us = (DWT->CYCCNT - start) / furi_hal_cortex_instructions_per_microsecond();
+
+    InfraredBoardStats* stats = &controller->board_stats;
+    stats->probes++;
+    stats->probe_total_us += probe_us;
+    stats->probe_max_us = MAX(stats->probe_max_us, probe_us);
+
+    bool changed = false;
+    if(connected == controller->board_connected) {
+        controller->board_mismatches = 0;
+    } else if(++controller->board_mismatches >= INFRARED_BOARD_DEBOUNCE) {
+        controller->board_mismatches = 0;
+        controller->board_connected = connected;
+        infrared_setup_external_board(connected);
+        changed = true;
+    }
 
-    FuriHalInfraredTxPin detected_pin = furi_hal_infrared_detect_tx_output();
+    furi_mutex_release(controller->tx_mutex);
 
-    if(detected_pin == FuriHalInfraredTxPinExtPA7 && !external_board_connected) {
-        external_board_connected = true;
-        infrared_setup_external_board(true);
+    if(!changed) {
+        return;
+    }
+
+    if(connected) {
         notification_message(controller->notification, &sequence_short_beep);
         FURI_LOG_I(TAG, "External infrared board connected and powered.");
-    } else if(detected_pin == FuriHalInfraredTxPinInternal && external_board_connected) {
-        external_board_connected = false;
-        infrared_setup_external_board(false);
+        infrared_controller_notify(controller, InfraredControllerEventBoardAttached);
+    } else {
         notification_message(controller->notification, &sequence_bloop);
         FURI_LOG_I(TAG, "External infrared board disconnected and power disabled.");
+        infrared_controller_notify(controller, InfraredControllerEventBoardDetached);
     }
 }
 
+void infrared_controller_start_board_monitor(InfraredController* controller) {
+    furi_assert(controller);
+    furi_timer_start(controller->board_timer, furi_ms_to_ticks(INFRARED_BOARD_POLL_MS));
+}
+
+// Runs on the timer thread.
 static void infrared_reset(void* context, uint32_t arg) {
     UNUSED(arg);
     InfraredController* controller = (InfraredController*)context;
     // furi_stream_buffer_reset(instance->stream) not exposed to the API.
-    // infrared_worker_rx_stop calls it internally.
-    infrared_worker_rx_stop(controller->worker);
-    infrared_worker_rx_start(controller->worker);
+    // infrared_worker_rx_stop calls it internally. If RX was paused in the
+    // meantime (e.g. handed over to RFID) it must stay off.
+    furi_mutex_acquire(controller->rx_mutex, FuriWaitForever);
+    if(controller->worker_rx_active) {
+        infrared_worker_rx_stop(controller->worker);
+        infrared_worker_rx_start(controller->worker);
+    }
+    furi_mutex_release(controller->rx_mutex);
     controller->processing_signal = false;
+    infrared_controller_notify(controller, InfraredControllerEventFeedbackDone);
+}
+
+static bool infrared_controller_is_hit(
+    InfraredController* controller,
+    const InfraredMessage* message,
+    uint32_t* shot) {
+    LaserTagTeam enemy = (controller->team == TeamRed) ? TeamBlue : TeamRed;
+    *shot = SHOT_TRACE_NO_ID;
+
+    if(!shot_auth_get_key(controller->auth)) {
+        LaserTagTeam shooter;
+        return shot_protocol_decode(controller->protocol, message, &shooter) && shooter == enemy;
+    }
+
+    uint32_t data;
+    if(!shot_protocol_decode_data(controller->protocol, message, &data)) {
+        return false;
+    }
+
+    uint32_t start = DWT->CYCCNT;
+    bool clash = shot_auth_is_clash(controller->auth, data, controller->team);
+    bool valid = shot_auth_verify(controller->auth, data, enemy);
+    controller->auth_cycles_max = MAX(controller->auth_cycles_max, DWT->CYCCNT - start);
+    if(clash && !atomic_exchange(&controller->shooter_clash, true)) {
+        infrared_controller_notify(controller, InfraredControllerEventShooterClash);
+    }
+    if(!valid) {
+        // Counted rather than logged, this runs on every frame. The total is
+        // logged when the controller is freed.
+        perf_counter_inc(&controller->rx_stats.rejected);
+    }
+    *shot = shot_auth_get_shot_id(data);
+    return valid;
+}
+
+// Referee mode RX path. Frames can arrive back to back, so there is no
+// logging (FURI_LOG_* allocates), no feedback and no RX restart here.
+static void infrared_controller_listen(
+    InfraredController* controller,
+    InfraredControllerShotCallback shot_callback,
+    InfraredWorkerSignal* signal) {
+    const InfraredMessage* message = signal ? infrared_worker_get_decoded_signal(signal) : NULL;
+    if(!message) {
+        return;
+    }
+    perf_counter_inc(&controller->rx_stats.decoded);
+
+    LaserTagTeam team;
+    uint32_t shooter = INFRARED_CONTROLLER_NO_SHOOTER;
+    if(!shot_auth_get_key(controller->auth)) {
+        if(!shot_protocol_decode(controller->protocol, message, &team)) {
+            return;
+        }
+    } else {
+        uint32_t data;
+        if(!shot_protocol_decode_data(controller->protocol, message, &data)) {
+            return;
+        }
+        team = (data & 1) ? TeamBlue : TeamRed;
+        if(!shot_auth_verify(controller->auth, data, team)) {
+            return;
+        }
+        shooter = shot_auth_get_shooter(data);
+    }
+
+    perf_counter_inc(&controller->rx_stats.accepted);
+    shot_callback(team, shooter, controller->shot_callback_context);
 }
 
 static void infrared_rx_callback(void* context, InfraredWorkerSignal* received_signal) {
+    InfraredController* controller = (InfraredController*)context;
+    perf_counter_inc(&controller->rx_stats.callbacks);
+    // Read once: the callback is only changed while RX is paused, but a
+    // second read must never be able to see NULL after the check.
+    InfraredControllerShotCallback shot_callback = controller->shot_callback;
+    if(shot_callback) {
+        infrared_controller_listen(controller, shot_callback, received_signal);
+        return;
+    }
+
     FURI_LOG_I(TAG, "RX callback triggered");
+    uint32_t stack_free = furi_thread_get_stack_space(furi_thread_get_current_id());
+    perf_counter_min(&controller->rx_stack_free, stack_free);
 
-    InfraredController* controller = (InfraredController*)context;
-    if(controller->processing_signal) {
+    if(atomic_exchange(&controller->processing_signal, true)) {
+        perf_counter_inc(&controller->rx_stats.dropped);
         FURI_LOG_W(TAG, "Already processing a signal, skipping callback");
         return;
     }
 
-    controller->processing_signal = true;
-
     if(!received_signal) {
         FURI_LOG_E(TAG, "Received signal is NULL");
         controller->processing_signal = false;
@@ -90,6 +223,7 @@ static void infrared_rx_callback(void* context, InfraredWorkerSignal* received_s
     FURI_LOG_I(TAG, "Received signal - signal address: %p", (void*)received_signal);
 
     if(message) {
+        perf_counter_inc(&controller->rx_stats.decoded);
         FURI_LOG_I(
             TAG,
             "Received message: protocol=%d, address=0x%lx, command=0x%lx",
@@ -97,11 +231,13 @@ static void infrared_rx_callback(void* context, InfraredWorkerSignal* received_s
             (unsigned long)message->address,
             (unsigned long)message->command);
 
-        if((controller->team == TeamRed && message->command == IR_COMMAND_BLUE_TEAM) ||
-           (controller->team == TeamBlue && message->command == IR_COMMAND_RED_TEAM)) {
-            controller->hit_received = true;
+        uint32_t shot;
+        if(infrared_controller_is_hit(controller, message, &shot)) {
+            shot_trace(ShotTraceRx, shot);
+            perf_counter_inc(&controller->rx_stats.accepted);
             FURI_LOG_I(
                 TAG, "Hit detected for team: %s", controller->team == TeamRed ? "Red" : "Blue");
+            infrared_controller_notify(controller, InfraredControllerEventHit);
             notification_message_block(controller->notification, &sequence_hit);
         }
     } else {
@@ -115,25 +251,61 @@ static void infrared_rx_callback(void* context, InfraredWorkerSignal* received_s
 InfraredController* infrared_controller_alloc() {
     FURI_LOG_I(TAG, "Allocating InfraredController");
 
-    InfraredController* controller = malloc(sizeof(InfraredController));
+    InfraredController* controller = laser_tag_arena_alloc(sizeof(InfraredController));
     if(!controller) {
         FURI_LOG_E(TAG, "Failed to allocate InfraredController");
         return NULL;
     }
 
     controller->team = TeamRed;
+    controller->protocol = InfraredProtocolNEC;
+    controller->auth = shot_auth_alloc();
+    controller->auth_cycles_max = 0;
     controller->worker = infrared_worker_alloc();
+    controller->rx_mutex = furi_mutex_alloc(FuriMutexTypeNormal);
     controller->signal = infrared_signal_alloc();
     controller->notification = furi_record_open(RECORD_NOTIFICATION);
-    controller->hit_received = false;
+    controller->worker_rx_active = false;
     controller->processing_signal = false;
-
-    if(controller->worker && controller->signal && controller->notification) {
+    controller->shooter_clash = false;
+    controller->rx_stack_free = UINT32_MAX;
+    controller->callback = NULL;
+    controller->callback_context = NULL;
+    controller->shot_callback = NULL;
+    controller->shot_callback_context = NULL;
+    controller->tx_mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    controller->board_timer =
+        furi_timer_alloc(infrared_board_monitor_callback, FuriTimerTypePeriodic, controller);
+    controller->board_connected = false;
+    controller->board_mismatches = 0;
+
+    if(controller->worker && controller->rx_mutex && controller->signal &&
+       controller->notification && controller->auth && controller->tx_mutex &&
+       controller->board_timer) {
         FURI_LOG_I(
             TAG, "InfraredWorker, InfraredSignal, and NotificationApp allocated successfully");
     } else {
+        // Undo in reverse order. The controller and ShotAuth live in the arena
+        // and go back with it when the app exits.
         FURI_LOG_E(TAG, "Failed to allocate resources");
-        free(controller);
+        if(controller->board_timer) {
+            furi_timer_free(controller->board_timer);
+        }
+        if(controller->tx_mutex) {
+            furi_mutex_free(controller->tx_mutex);
+        }
+        if(controller->notification) {
+            furi_record_close(RECORD_NOTIFICATION);
+        }
+        if(controller->signal) {
+            infrared_signal_free(controller->signal);
+        }
+        if(controller->rx_mutex) {
+            furi_mutex_free(controller->rx_mutex);
+        }
+        if(controller->worker) {
+            infrared_worker_free(controller->worker);
+        }
         return NULL;
     }
 
@@ -145,24 +317,67 @@ InfraredController* infrared_controller_alloc() {
     return controller;
 }
 
+static void infrared_controller_flush_callback(void* context, uint32_t arg) {
+    UNUSED(arg);
+    furi_semaphore_release(context);
+}
+
+// Pending timer callbacks run in order, so once this one ran, no
+// infrared_reset queued by the RX callback can touch the controller anymore.
+static void infrared_controller_flush_timer_thread(void) {
+    FuriSemaphore* flushed = furi_semaphore_alloc(1, 0);
+    furi_timer_pending_callback(infrared_controller_flush_callback, flushed, 0);
+    furi_semaphore_acquire(flushed, FuriWaitForever);
+    furi_semaphore_free(flushed);
+}
+
 void infrared_controller_free(InfraredController* controller) {
     FURI_LOG_I(TAG, "Freeing InfraredController");
 
     if(controller) {
-        if(controller->worker_rx_active) {
-            FURI_LOG_I(TAG, "Stopping RX worker");
-            infrared_worker_rx_stop(controller->worker);
+        furi_timer_stop(controller->board_timer);
+        furi_timer_free(controller->board_timer);
+        if(controller->board_connected) {
+            infrared_setup_external_board(false);
+        }
+
+        const InfraredBoardStats* stats = &controller->board_stats;
+        if(stats->probes) {
+            FURI_LOG_I(
+                TAG,
+                "Board probe ran %lu times, avg %lu us, max %lu us, skipped %lu",
+                stats->probes,
+                stats->probe_total_us / stats->probes,
+                stats->probe_max_us,
+                stats->skipped);
+        }
+
+        infrared_controller_pause(controller);
+        infrared_controller_flush_timer_thread();
+
+        if(controller->auth_cycles_max) {
+            FURI_LOG_I(
+                TAG,
+                "Shot authentication took up to %lu cycles (%lu us), %lu shots rejected",
+                controller->auth_cycles_max,
+                controller->auth_cycles_max / furi_hal_cortex_instructions_per_microsecond(),
+                perf_counter_get(&controller->rx_stats.rejected));
+        }
+
+        uint32_t rx_stack_free = perf_counter_get(&controller->rx_stack_free);
+        if(rx_stack_free != UINT32_MAX) {
+            FURI_LOG_I(TAG, "RX thread stack: %lu bytes never used", rx_stack_free);
         }
 
         FURI_LOG_I(TAG, "Freeing InfraredWorker and InfraredSignal");
         infrared_worker_free(controller->worker);
         infrared_signal_free(controller->signal);
+        furi_mutex_free(controller->tx_mutex);
+        furi_mutex_free(controller->rx_mutex);
 
         FURI_LOG_I(TAG, "Closing NotificationApp");
         furi_record_close(RECORD_NOTIFICATION);
 
-        free(controller);
-
         FURI_LOG_I(TAG, "InfraredController freed successfully");
     } else {
         FURI_LOG_W(TAG, "Attempted to free NULL InfraredController");
@@ -174,13 +389,90 @@ void infrared_controller_set_team(InfraredController* controller, LaserTagTeam t
     controller->team = team;
 }
 
+void infrared_controller_reset(InfraredController* controller, LaserTagTeam team) {
+    furi_assert(controller);
+    FURI_LOG_I(TAG, "Resetting InfraredController for a new match");
+    infrared_controller_pause(controller);
+    controller->processing_signal = false;
+    controller->shooter_clash = false;
+    infrared_controller_set_team(controller, team);
+}
+
+// Only change it while RX is paused: the RX callback reads it.
+void infrared_controller_set_protocol(
+    InfraredController* controller,
+    InfraredProtocol protocol) {
+    furi_assert(controller);
+    const ShotProtocol* shot_protocol = shot_protocol_get(protocol);
+    if(!shot_protocol) {
+        FURI_LOG_E(TAG, "Protocol %d can't carry shots, keeping the current one", protocol);
+        return;
+    }
+    FURI_LOG_I(
+        TAG,
+        "Shots use %s, up to %u ms on air in open play",
+        shot_protocol->name,
+        shot_protocol->air_time_ms);
+    controller->protocol = protocol;
+}
+
+// Only change it while RX is paused, after the protocol: 0 turns tournament mode off.
+void infrared_controller_set_match_key(InfraredController* controller, uint32_t key) {
+    furi_assert(controller);
+    if(key && shot_protocol_get_data_bits(controller->protocol) < SHOT_AUTH_DATA_BITS) {
+        FURI_LOG_E(TAG, "Shot protocol too short for tournament mode, playing open");
+        key = 0;
+    }
+    if(key) {
+        FURI_LOG_I(
+            TAG,
+            "Tournament shots, up to %u ms on air",
+            shot_protocol_get(controller->protocol)->tournament_air_time_ms);
+    }
+    shot_auth_set_key(controller->auth, key);
+}
+
+uint32_t infrared_controller_get_shot_counter(InfraredController* controller) {
+    furi_assert(controller);
+    return shot_auth_get_counter(controller->auth);
+}
+
+// Only change it while RX is paused, after the match key.
+void infrared_controller_set_shot_counter(InfraredController* controller, uint32_t counter) {
+    furi_assert(controller);
+    shot_auth_set_counter(controller->auth, counter);
+}
+
+void infrared_controller_set_event_callback(
+    InfraredController* controller,
+    InfraredControllerEventCallback callback,
+    void* context) {
+    furi_assert(controller);
+    controller->callback = callback;
+    controller->callback_context = context;
+}
+
+void infrared_controller_set_shot_callback(
+    InfraredController* controller,
+    InfraredControllerShotCallback callback,
+    void* context) {
+    furi_assert(controller);
+    controller->shot_callback = callback;
+    controller->shot_callback_context = context;
+}
+
 void infrared_controller_send(InfraredController* controller) {
     FURI_LOG_I(TAG, "Preparing to send infrared signal");
 
-    InfraredMessage message = {
-        .protocol = InfraredProtocolNEC,
-        .address = 0x42,
-        .command = (controller->team == TeamRed) ? IR_COMMAND_RED_TEAM : IR_COMMAND_BLUE_TEAM};
+    InfraredMessage message;
+    uint32_t shot = SHOT_TRACE_NO_ID;
+    if(shot_auth_get_key(controller->auth)) {
+        uint32_t data = shot_auth_next(controller->auth, controller->team);
+        shot_protocol_encode_data(controller->protocol, data, &message);
+        shot = shot_auth_get_shot_id(data);
+    } else {
+        shot_protocol_encode(controller->protocol, controller->team, &message);
+    }
 
     FURI_LOG_I(
         TAG,
@@ -189,6 +481,7 @@ void infrared_controller_send(InfraredController* controller) {
         (unsigned long)message.address,
         (unsigned long)message.command);
 
+    furi_mutex_acquire(controller->rx_mutex, FuriWaitForever);
     if(controller->worker_rx_active) {
         FURI_LOG_I(TAG, "Stopping RX worker");
         infrared_worker_rx_stop(controller->worker);
@@ -199,51 +492,37 @@ void infrared_controller_send(InfraredController* controller) {
     infrared_signal_set_message(controller->signal, &message);
 
     FURI_LOG_I(TAG, "Starting infrared signal transmission");
+    furi_mutex_acquire(controller->tx_mutex, FuriWaitForever);
+    shot_trace(ShotTraceTxStart, shot);
     infrared_signal_transmit(controller->signal);
+    shot_trace(ShotTraceTxEnd, shot);
+    furi_mutex_release(controller->tx_mutex);
 
     if(!controller->worker_rx_active) {
         infrared_worker_rx_start(controller->worker);
         controller->worker_rx_active = true;
     }
+    furi_mutex_release(controller->rx_mutex);
 
     FURI_LOG_I(TAG, "Infrared signal transmission completed");
 }
 
-bool infrared_controller_receive(InfraredController* controller) {
-    FURI_LOG_I(TAG, "Starting infrared signal reception");
-
-    if(controller->processing_signal) {
-        FURI_LOG_W(TAG, "Cannot start reception, another signal is still being processed");
-        return false;
-    }
-
-    if(!controller->worker_rx_active) {
-        infrared_worker_rx_start(controller->worker);
-        controller->worker_rx_active = true;
-        furi_delay_ms(250);
-    }
-
-    bool hit = controller->hit_received;
-
-    FURI_LOG_I(TAG, "Signal reception complete, hit received: %s", hit ? "true" : "false");
-
-    controller->hit_received = false;
-
-    return hit;
-}
-
 void infrared_controller_pause(InfraredController* controller) {
+    furi_mutex_acquire(controller->rx_mutex, FuriWaitForever);
     if(controller->worker_rx_active) {
         FURI_LOG_I(TAG, "Stopping RX worker");
         infrared_worker_rx_stop(controller->worker);
         controller->worker_rx_active = false;
     }
+    furi_mutex_release(controller->rx_mutex);
 }
 
 void infrared_controller_resume(InfraredController* controller) {
+    furi_mutex_acquire(controller->rx_mutex, FuriWaitForever);
     if(!controller->worker_rx_active) {
         FURI_LOG_I(TAG, "Starting RX worker");
         infrared_worker_rx_start(controller->worker);
         controller->worker_rx_active = true;
     }
+    furi_mutex_release(controller->rx_mutex);
 }
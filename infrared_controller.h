@@ -1,29 +1,96 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdatomic.h>
 #include <notification/notification.h>
 #include <infrared_worker.h>
 #include <infrared_signal.h>
 #include "game_state.h"
+#include "shot_protocol.h"
+#include "shot_auth.h"
+#include "perf_counter.h"
 
+typedef enum {
+    InfraredControllerEventHit,
+    InfraredControllerEventFeedbackDone,
+    InfraredControllerEventBoardAttached,
+    InfraredControllerEventBoardDetached,
+    InfraredControllerEventShooterClash, // another player shares our tournament shooter id
+} InfraredControllerEvent;
+
+typedef struct {
+    uint32_t probes; // board detection runs
+    uint32_t probe_max_us; // slowest run
+    uint32_t probe_total_us; // sum of all runs
+    uint32_t skipped; // polls skipped because a shot was being sent
+} InfraredBoardStats;
+
+// Written by the IR worker thread only.
+typedef struct {
+    PerfCounter callbacks; // RX callbacks
+    PerfCounter decoded; // frames the worker decoded
+    PerfCounter accepted; // hits
+    PerfCounter rejected; // tournament shots that failed authentication or were replayed
+    PerfCounter dropped; // skipped while the previous hit was being processed
+} InfraredRxStats;
+
+typedef void (*InfraredControllerEventCallback)(InfraredControllerEvent event, void* context);
+
+#define INFRARED_CONTROLLER_NO_SHOOTER UINT32_MAX
+
+/** Called from the IR worker thread. The shooter is only known in tournament mode. */
+typedef void (*InfraredControllerShotCallback)(LaserTagTeam team, uint32_t shooter, void* context);
+
+// Shared with the IR worker thread (RX callback) and the timer thread (hit
+// feedback reset), on top of the thread that owns the controller.
 typedef struct InfraredController {
-    LaserTagTeam team;
+    _Atomic LaserTagTeam team; // switched by a tag mid-match
+    InfraredProtocol protocol;
+    ShotAuth* auth;
+    uint32_t auth_cycles_max;
     InfraredWorker* worker;
+    FuriMutex* rx_mutex; // starting and stopping RX, and worker_rx_active
     bool worker_rx_active;
     InfraredSignal* signal;
     NotificationApp* notification;
-    bool hit_received;
-    bool processing_signal;
+    atomic_bool processing_signal; // a hit is being shown, RX ignores shots until reset
+    atomic_bool shooter_clash; // reported once per match
+    PerfCounter rx_stack_free; // lowest seen, written by the IR worker thread
+    InfraredRxStats rx_stats;
+    InfraredControllerEventCallback callback;
+    void* callback_context;
+    InfraredControllerShotCallback shot_callback; // listen only, see set_shot_callback
+    void* shot_callback_context;
+    FuriMutex* tx_mutex; // board probes reconfigure the TX pin, never during a transmission
+    FuriTimer* board_timer;
+    bool board_connected;
+    uint8_t board_mismatches;
+    InfraredBoardStats board_stats;
 } InfraredController;
 
 InfraredController* infrared_controller_alloc();
 void infrared_controller_free(InfraredController* controller);
 void infrared_controller_set_team(InfraredController* controller, LaserTagTeam team);
+void infrared_controller_reset(InfraredController* controller, LaserTagTeam team);
+void infrared_controller_set_protocol(InfraredController* controller, InfraredProtocol protocol);
+void infrared_controller_set_match_key(InfraredController* controller, uint32_t key);
+/** Tournament mode shot counter, see shot_auth_get_counter. */
+uint32_t infrared_controller_get_shot_counter(InfraredController* controller);
+void infrared_controller_set_shot_counter(InfraredController* controller, uint32_t counter);
+void infrared_controller_set_event_callback(
+    InfraredController* controller,
+    InfraredControllerEventCallback callback,
+    void* context);
+/**
+ * Referee mode: while set, every valid shot from either team goes to the
+ * callback and nothing counts as a hit. Only change it while RX is paused.
+ */
+void infrared_controller_set_shot_callback(
+    InfraredController* controller,
+    InfraredControllerShotCallback callback,
+    void* context);
 void infrared_controller_send(InfraredController* controller);
-bool infrared_controller_receive(InfraredController* controller);
-void update_infrared_board_status(InfraredController* controller);
+/** Start watching for the external IR board, attach/detach is reported through the callback. */
+void infrared_controller_start_board_monitor(InfraredController* controller);
 void infrared_controller_pause(InfraredController* controller);
 void infrared_controller_resume(InfraredController* controller);
-
-#define IR_COMMAND_RED_TEAM  0xA1
-#define IR_COMMAND_BLUE_TEAM 0xB2
@@ -2,102 +2,277 @@
 #include "laser_tag_view.h"
 #include "infrared_controller.h"
 #include "game_state.h"
+#include "game_rules.h"
+#include "shot_protocol.h"
 #include "lfrfid_reader.h"
+#include "radio_scheduler.h"
+#include "tag_opcodes.h"
+#include "timer_wheel.h"
+#include "shot_trace.h"
+#include "perf_overlay.h"
+#include "log_sink.h"
+#include "game_checkpoint.h"
+#include "referee.h"
+#include "laser_tag_arena.h"
 #include <furi.h>
+#include <furi_hal.h>
 #include <gui/gui.h>
 #include <input/input.h>
 #include <notification/notification.h>
+#include <storage/storage.h>
+#include <stdatomic.h>
 
 #define TAG "LaserTagApp"
 
+#define LASER_TAG_EVENT_QUEUE_SIZE    16
+#define LASER_TAG_TAG_DATA_SIZE       TAG_PAYLOAD_SIZE
+#define LASER_TAG_SCAN_TIMEOUT_MS     3000
+#define LASER_TAG_SCAN_TICK_MS        100
+#define LASER_TAG_TAG_COOLDOWN_MS     30000
+#define LASER_TAG_SPLASH_MS           2000
+#define LASER_TAG_PERF_SAMPLE_MS      1000
+#define LASER_TAG_MATCH_LOG_PATH      APP_DATA_PATH("match.log")
+#define LASER_TAG_CHECKPOINT_S        5
+#define LASER_TAG_REFEREE_REFRESH_MS  500
+#define LASER_TAG_REFEREE_TOP_PLAYERS 6
+#define LASER_TAG_HIT_DAMAGE          10
+#define LASER_TAG_RESPAWN_DELAY_MS    5000
+
+// Shots fired after the last checkpoint were already seen by the victims, so
+// a resumed tournament match skips this many counters ahead.
+#define LASER_TAG_CHECKPOINT_SHOT_SKIP 64
+
+// Matches stack_size in application.fam. Less than this left free at exit means
+// the main thread came too close to overflowing.
+#define LASER_TAG_MAIN_STACK_SIZE       (2 * 1024)
+#define LASER_TAG_MAIN_STACK_MIN_MARGIN 256
+
+// The init thread reads the checkpoint from storage and logs as it goes, as
+// much as the main thread does at a time.
+#define LASER_TAG_INIT_STACK_SIZE (2 * 1024)
+
+typedef enum {
+    LaserTagEventTypeInput,
+    LaserTagEventTypeHit,
+    LaserTagEventTypeTagPickup,
+    LaserTagEventTypeTimer,
+    LaserTagEventTypeBoardAttached,
+    LaserTagEventTypeBoardDetached,
+    LaserTagEventTypeFeedbackDone,
+    LaserTagEventTypeRadioReady,
+    LaserTagEventTypeShooterClash,
+} LaserTagEventType;
+
+typedef enum {
+    LaserTagLogEventStart,
+    LaserTagLogEventFire,
+    LaserTagLogEventReload,
+    LaserTagLogEventHit,
+    LaserTagLogEventTag,
+    LaserTagLogEventGameOver,
+    LaserTagLogEventRespawn,
+} LaserTagLogEvent;
+
+// One record per game event in the match log, which holds the last match.
+typedef struct {
+    uint32_t tick;
+    uint8_t event; // LaserTagLogEvent
+    uint8_t health;
+    uint16_t ammo;
+} LaserTagLogRecord;
+
+typedef struct {
+    LaserTagEventType type;
+    union {
+        InputEvent input;
+        struct {
+            uint8_t data[LASER_TAG_TAG_DATA_SIZE];
+            uint8_t length;
+        } tag;
+    };
+} LaserTagEvent;
+
 struct LaserTagApp {
+    // Held by the main loop while it handles an event and by the draw
+    // callback, so a frame never shows half an update.
+    FuriMutex* mutex;
     Gui* gui;
     ViewPort* view_port;
     LaserTagView* view;
     FuriMessageQueue* event_queue;
-    FuriTimer* timer;
+    TimerWheel* timers;
+    TimerWheelTimer splash_timer;
+    TimerWheelTimer clock_timer;
     NotificationApp* notifications;
     InfraredController* ir_controller;
+    LFRFIDReader* rfid_reader;
     GameState* game_state;
+    GameRules rules;
+    LogSink* match_log; // NULL without an SD card or outside a match
+    GameCheckpoint* checkpoint;
+    Referee* referee;
+    bool resume_available; // set by the init thread before RadioReady
     LaserTagState state;
     bool need_redraw;
-    LFRFIDReader* reader;
+    bool trace_hit; // the next redraw shows a hit
+    RadioScheduler* radio;
+    FuriThread* init_thread;
+    RadioScheduler* init_radio;
+    uint32_t init_stack_free; // set by the init thread before RadioReady
+    uint32_t start_tick;
+    size_t start_free_heap;
+    uint32_t first_frame_tick;
+    TimerWheelTimer scan_timer;
+    bool scan_active;
+    uint32_t scan_started;
+    bool scan_success;
+    TimerWheelTimer respawn_timer; // pending from the respawn point scan until back in
+    atomic_uint dropped_events;
+    // Debug overlay, toggled by holding Left during a game. The loop counters
+    // are only touched by the main thread.
+    PerfOverlay* perf;
+    TimerWheelTimer perf_timer;
+    bool perf_visible;
+    uint32_t loop_iterations;
+    uint32_t loop_max_cycles;
+    uint32_t redraws;
+    uint32_t main_stack_free;
 };
 
+LASER_TAG_ARENA_CHECK(struct LaserTagApp, LASER_TAG_ARENA_APP_SIZE);
+
+// Game tags are always EM4100, so that is the only decoder the reader runs.
+static const LFRFIDProtocol laser_tag_rfid_protocols[] = {LFRFIDProtocolEM4100};
+
 const NotificationSequence sequence_vibro_1 = {&message_vibro_on, &message_vibro_off, NULL};
 const NotificationSequence sequence_short_beep =
     {&message_note_c4, &message_delay_50, &message_sound_off, NULL};
 
-static void laser_tag_app_timer_callback(void* context) {
+// Called from the timer, input, IR worker and RFID threads. Never blocks: if the
+// main loop falls behind, the event is dropped and counted.
+static void laser_tag_app_post_event(LaserTagApp* app, const LaserTagEvent* event) {
+    if(furi_message_queue_put(app->event_queue, event, 0) != FuriStatusOk) {
+        atomic_fetch_add_explicit(&app->dropped_events, 1, memory_order_relaxed);
+    }
+}
+
+static void laser_tag_app_timer_wake_callback(void* context) {
     furi_assert(context);
     LaserTagApp* app = context;
-    FURI_LOG_D(TAG, "Timer callback triggered");
-
-    if(app->state == LaserTagStateSplashScreen) {
-        if(game_state_get_time(app->game_state) >= 2) {
-            FURI_LOG_I(TAG, "Splash screen time over, switching to TeamSelect");
-            app->state = LaserTagStateTeamSelect;
-            game_state_reset(app->game_state);
-            FURI_LOG_D(TAG, "Game state reset after splash screen");
-        } else {
-            FURI_LOG_D(TAG, "Updating splash screen time");
-            game_state_update_time(app->game_state, 1);
-        }
-    } else if(app->state == LaserTagStateGame) {
-        FURI_LOG_D(TAG, "Updating game time by 1 second");
-        game_state_update_time(app->game_state, 1);
-    }
+    LaserTagEvent event = {.type = LaserTagEventTypeTimer};
+    laser_tag_app_post_event(app, &event);
+}
 
-    if(app->view) {
-        FURI_LOG_D(TAG, "Updating view with the latest game state");
-        laser_tag_view_update(app->view, app->game_state);
-        app->need_redraw = true;
+static void laser_tag_app_input_callback(InputEvent* input_event, void* context) {
+    furi_assert(context);
+    LaserTagApp* app = context;
+    if(input_event->key == InputKeyOk && input_event->type == InputTypePress) {
+        shot_trace(ShotTraceInput, SHOT_TRACE_NO_ID);
     }
+    LaserTagEvent event = {.type = LaserTagEventTypeInput, .input = *input_event};
+    laser_tag_app_post_event(app, &event);
 }
 
-static void laser_tag_app_input_callback(InputEvent* input_event, void* context) {
+static void laser_tag_app_ir_callback(InfraredControllerEvent ir_event, void* context) {
     furi_assert(context);
     LaserTagApp* app = context;
-    FURI_LOG_D(TAG, "Input event received: type=%d, key=%d", input_event->type, input_event->key);
-    furi_message_queue_put(app->event_queue, input_event, 0);
-    FURI_LOG_D(TAG, "Input event queued successfully");
+    LaserTagEvent event;
+    switch(ir_event) {
+    case InfraredControllerEventHit:
+        event.type = LaserTagEventTypeHit;
+        break;
+    case InfraredControllerEventFeedbackDone:
+        event.type = LaserTagEventTypeFeedbackDone;
+        break;
+    case InfraredControllerEventBoardAttached:
+        event.type = LaserTagEventTypeBoardAttached;
+        break;
+    case InfraredControllerEventBoardDetached:
+        event.type = LaserTagEventTypeBoardDetached;
+        break;
+    case InfraredControllerEventShooterClash:
+        event.type = LaserTagEventTypeShooterClash;
+        break;
+    default:
+        return;
+    }
+    laser_tag_app_post_event(app, &event);
+}
+
+// Team totals, then the most active shooters in two columns.
+static void laser_tag_app_draw_scoreboard(LaserTagApp* app, Canvas* canvas) {
+    RefereePlayer players[LASER_TAG_REFEREE_TOP_PLAYERS];
+    char line[32];
+
+    canvas_clear(canvas);
+    canvas_set_font(canvas, FontPrimary);
+    canvas_draw_str(canvas, 2, 10, "REFEREE");
+
+    canvas_set_font(canvas, FontSecondary);
+    const ShotProtocol* shot_protocol = shot_protocol_get(app->rules.shot_protocol);
+    if(app->rules.match_key) {
+        canvas_draw_str_aligned(canvas, 126, 10, AlignRight, AlignBottom, "Tournament");
+    } else if(shot_protocol) {
+        canvas_draw_str_aligned(canvas, 126, 10, AlignRight, AlignBottom, shot_protocol->name);
+    }
+
+    snprintf(
+        line,
+        sizeof(line),
+        "Red %lu   Blue %lu",
+        referee_get_team_shots(app->referee, TeamRed),
+        referee_get_team_shots(app->referee, TeamBlue));
+    canvas_draw_str(canvas, 2, 22, line);
+    canvas_draw_line(canvas, 0, 25, 127, 25);
+
+    if(!app->rules.match_key) {
+        canvas_draw_str(canvas, 2, 40, "Players: tournament only");
+        return;
+    }
+    size_t count = referee_get_top_players(app->referee, players, COUNT_OF(players));
+    for(size_t i = 0; i < count; i++) {
+        snprintf(
+            line,
+            sizeof(line),
+            "#%u %s %lu",
+            players[i].id,
+            players[i].team == TeamBlue ? "Blue" : "Red",
+            players[i].shots);
+        canvas_draw_str(canvas, (i % 2) ? 66 : 2, 36 + (i / 2) * 10, line);
+    }
 }
 
 static void laser_tag_app_draw_callback(Canvas* canvas, void* context) {
     furi_assert(context);
     LaserTagApp* app = context;
-    FURI_LOG_D(TAG, "Entering draw callback");
+    furi_mutex_acquire(app->mutex, FuriWaitForever);
+
+    if(!app->first_frame_tick) {
+        app->first_frame_tick = furi_get_tick();
+    }
 
+    // No logging or formatting here: FURI_LOG_* allocates a FuriString per
+    // message, and this runs on every frame. The static geometry is drawn
+    // primitive by primitive, which test_render measures as cheaper than
+    // blitting it from a full-screen bitmap: a blit tests all 8192 bits.
     if(app->state == LaserTagStateSplashScreen) {
         canvas_clear(canvas);
+        canvas_draw_frame(canvas, 0, 0, 128, 64);
+        canvas_draw_line(canvas, 0, 30, 127, 30);
+        canvas_draw_circle(canvas, 110, 15, 12);
+        canvas_draw_disc(canvas, 110, 15, 4);
         canvas_set_font(canvas, FontPrimary);
         canvas_draw_str(canvas, 5, 20, "Laser Tag!");
         canvas_set_font(canvas, FontSecondary);
         canvas_draw_str(canvas, 5, 40, "https://github.com/");
         canvas_draw_str(canvas, 5, 50, "RocketGod-git/");
         canvas_draw_str(canvas, 5, 60, "Flipper-Zero-Laser-Tag");
-        canvas_draw_frame(canvas, 0, 0, 128, 64);
-        canvas_draw_line(canvas, 0, 30, 127, 30);
-        canvas_draw_circle(canvas, 110, 15, 12);
-        canvas_draw_disc(canvas, 110, 15, 4);
 
     } else if(app->state == LaserTagStateTeamSelect) {
         canvas_clear(canvas);
         canvas_draw_frame(canvas, 0, 0, 128, 64);
-
-        canvas_set_font(canvas, FontPrimary);
-        canvas_draw_str(canvas, 14, 13, "SELECT TEAM");
-
         canvas_draw_line(canvas, 0, 16, 127, 16);
 
-        canvas_set_font(canvas, FontSecondary);
-        canvas_draw_str(canvas, 5, 30, "LEFT");
-        canvas_draw_str(canvas, 95, 30, "RIGHT");
-
-        canvas_set_font(canvas, FontPrimary);
-        canvas_draw_str(canvas, 10, 45, "RED");
-        canvas_draw_str(canvas, 95, 45, "BLUE");
-
         // Gun icon for Red team
         canvas_draw_line(canvas, 10, 50, 25, 50);
         canvas_draw_line(canvas, 25, 50, 25, 55);
@@ -118,15 +293,67 @@ static void laser_tag_app_draw_callback(Canvas* canvas, void* context) {
         canvas_draw_circle(canvas, 60, 32, 5);
         canvas_draw_circle(canvas, 60, 32, 2);
 
-    } else if(app->state == LaserTagStateGameOver) {
+        canvas_set_font(canvas, FontPrimary);
+        canvas_draw_str(canvas, 14, 13, "SELECT TEAM");
+
+        canvas_set_font(canvas, FontSecondary);
+        canvas_draw_str(canvas, 5, 30, "LEFT");
+        canvas_draw_str(canvas, 95, 30, "RIGHT");
+
+        canvas_set_font(canvas, FontPrimary);
+        canvas_draw_str(canvas, 10, 45, "RED");
+        canvas_draw_str(canvas, 95, 45, "BLUE");
+
+        // Shot protocol, picked with UP/DOWN, or the tournament match card
+        // scanned with OK. Everyone in the match needs the same. In tournament
+        // mode the shooter id is shown so that players can compare before the
+        // match: two who share one need a new card.
+        const ShotProtocol* shot_protocol = shot_protocol_get(app->rules.shot_protocol);
+        const char* rules = shot_protocol ? shot_protocol->name : NULL;
+        char tournament[24];
+        if(app->scan_active) {
+            rules = "Scan card...";
+        } else if(app->rules.match_key) {
+            snprintf(
+                tournament,
+                sizeof(tournament),
+                "Tournament, id %lu",
+                shot_auth_shooter_for_key(app->rules.match_key));
+            rules = tournament;
+        }
+        if(rules) {
+            canvas_set_font(canvas, FontSecondary);
+            canvas_draw_str_aligned(canvas, 60, 62, AlignCenter, AlignBottom, rules);
+        }
+
+    } else if(app->state == LaserTagStateResume) {
+        const GameCheckpointData* checkpoint = game_checkpoint_get_loaded(app->checkpoint);
+        char line[32];
         canvas_clear(canvas);
+        canvas_draw_frame(canvas, 0, 0, 128, 64);
 
         canvas_set_font(canvas, FontPrimary);
+        canvas_draw_str_aligned(canvas, 64, 14, AlignCenter, AlignBottom, "RESUME MATCH?");
 
-        // Display "GAME OVER!" centered on the screen
-        canvas_draw_str_aligned(canvas, 64, 25, AlignCenter, AlignCenter, "GAME OVER!");
+        canvas_set_font(canvas, FontSecondary);
+        snprintf(
+            line,
+            sizeof(line),
+            "%s, %u HP, %02lu:%02lu",
+            checkpoint->game.team == TeamBlue ? "Blue" : "Red",
+            checkpoint->game.health,
+            checkpoint->game.time_ms / 60000,
+            checkpoint->game.time_ms / 1000 % 60);
+        canvas_draw_str_aligned(canvas, 64, 30, AlignCenter, AlignBottom, line);
+        canvas_draw_str_aligned(canvas, 64, 46, AlignCenter, AlignBottom, "OK: resume");
+        canvas_draw_str_aligned(canvas, 64, 58, AlignCenter, AlignBottom, "Back: new game");
+
+    } else if(app->state == LaserTagStateReferee) {
+        laser_tag_app_draw_scoreboard(app, canvas);
 
-        // Add a solid block border around the screen
+    } else if(app->state == LaserTagStateGameOver) {
+        canvas_clear(canvas);
+        // Solid block border around the screen
         for(int x = 0; x < 128; x += 8) {
             canvas_draw_box(canvas, x, 0, 8, 8);
             canvas_draw_box(canvas, x, 56, 8, 8);
@@ -136,68 +363,369 @@ static void laser_tag_app_draw_callback(Canvas* canvas, void* context) {
             canvas_draw_box(canvas, 120, y, 8, 8);
         }
 
+        canvas_set_font(canvas, FontPrimary);
+        canvas_draw_str_aligned(canvas, 64, 25, AlignCenter, AlignCenter, "GAME OVER!");
+
+        const char* hint = "Up Respawn  OK Restart";
+        if(timer_wheel_is_pending(&app->respawn_timer)) {
+            hint = "Respawning...";
+        } else if(app->scan_active) {
+            hint = "Scan respawn point";
+        }
         canvas_set_font(canvas, FontSecondary);
-        canvas_draw_str_aligned(canvas, 64, 50, AlignCenter, AlignCenter, "Press OK to Restart");
+        canvas_draw_str_aligned(canvas, 64, 50, AlignCenter, AlignCenter, hint);
 
     } else if(app->view) {
-        FURI_LOG_D(TAG, "Drawing game view");
         laser_tag_view_draw(laser_tag_view_get_view(app->view), canvas);
+        if(app->perf_visible) {
+            perf_overlay_draw(app->perf, canvas);
+        }
     }
-    FURI_LOG_D(TAG, "Exiting draw callback");
-}
 
-static bool matching_team(LaserTagApp* app, uint8_t data) {
-    if(data == 0) {
-        return true;
-    } else if(game_state_get_team(app->game_state) == TeamRed) {
-        return data == 0xA1;
-    } else if(game_state_get_team(app->game_state) == TeamBlue) {
-        return data == 0xB2;
-    }
-    return false;
+    furi_mutex_release(app->mutex);
 }
 
 static void tag_callback(uint8_t* data, uint8_t length, void* context) {
     LaserTagApp* app = (LaserTagApp*)context;
 
-    if(length != 5) {
+    if(length != LASER_TAG_TAG_DATA_SIZE) {
         FURI_LOG_W(TAG, "Tag is not for game.  Length: %d", length);
         return;
     }
 
-    if(data[0] != 0x13 || data[1] != 0x37) {
-        FURI_LOG_D(
+    LaserTagEvent event = {.type = LaserTagEventTypeTagPickup};
+    memcpy(event.tag.data, data, length);
+    event.tag.length = length;
+    laser_tag_app_post_event(app, &event);
+}
+
+static bool laser_tag_app_apply_command(LaserTagApp* app, const GameCommand* command) {
+    switch(command->type) {
+    case GameCommandAddAmmo:
+        game_state_increase_ammo(app->game_state, command->value);
+        FURI_LOG_D(TAG, "Increased ammo by: %d", command->value);
+        break;
+    case GameCommandAddHealth:
+        game_state_increase_health(app->game_state, command->value);
+        break;
+    case GameCommandAddArmor:
+        game_state_increase_armor(app->game_state, command->value);
+        break;
+    case GameCommandAddMaxAmmo:
+        game_state_increase_max_ammo(app->game_state, command->value);
+        break;
+    case GameCommandSwitchTeam: {
+        LaserTagTeam team = (game_state_get_team(app->game_state) == TeamRed) ? TeamBlue : TeamRed;
+        game_state_set_team(app->game_state, team);
+        game_state_set_flag(app->game_state, false);
+        infrared_controller_set_team(app->ir_controller, team);
+        break;
+    }
+    case GameCommandPickupFlag:
+        game_state_set_flag(app->game_state, true);
+        break;
+    case GameCommandCaptureFlag:
+        game_state_set_flag(app->game_state, false);
+        game_state_add_capture(app->game_state);
+        break;
+    case GameCommandRespawn:
+        if(game_state_is_game_over(app->game_state)) {
+            // The player is back in once the delay is up, see laser_tag_app_respawn.
+            timer_wheel_schedule(app->timers, &app->respawn_timer, LASER_TAG_RESPAWN_DELAY_MS);
+            break;
+        }
+        game_state_increase_health(app->game_state, MAX_HEALTH);
+        game_state_increase_ammo(
+            app->game_state,
+            game_state_get_max_ammo(app->game_state) - game_state_get_ammo(app->game_state));
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+static void laser_tag_app_log(LaserTagApp* app, LaserTagLogEvent event) {
+    if(!app->match_log) {
+        return;
+    }
+
+    LaserTagLogRecord record = {
+        .tick = furi_get_tick(),
+        .event = event,
+        .health = game_state_get_health(app->game_state),
+        .ammo = game_state_get_ammo(app->game_state),
+    };
+    log_sink_append(app->match_log, &record);
+}
+
+static void laser_tag_app_checkpoint(LaserTagApp* app) {
+    GameCheckpointData data = {
+        .rules = app->rules,
+        .shot_counter = infrared_controller_get_shot_counter(app->ir_controller),
+    };
+    game_state_get_snapshot(app->game_state, &data.game);
+    game_checkpoint_save(app->checkpoint, &data);
+}
+
+static void laser_tag_app_close_match_log(LaserTagApp* app) {
+    if(app->match_log) {
+        log_sink_free(app->match_log);
+        app->match_log = NULL;
+    }
+}
+
+// Any EM4100 card works as a match card, all players scan the same one.
+static uint32_t laser_tag_app_match_key(const uint8_t* data, uint8_t length) {
+    // FNV-1a
+    uint32_t key = 2166136261UL;
+    for(uint8_t i = 0; i < length; i++) {
+        key = (key ^ data[i]) * 16777619UL;
+    }
+    return key ? key : 1;
+}
+
+// A station only cools down once it did something for this player. Reads of it
+// may already be queued behind the one that was applied, so check first.
+static bool laser_tag_app_handle_tag(LaserTagApp* app, const uint8_t* data, uint8_t length) {
+    if(lfrfid_reader_tag_cooling_down(app->rfid_reader, data, length)) {
+        return false;
+    }
+    GameCommand command;
+    if(!tag_opcode_decode(app->game_state, data, length, &command) ||
+       !laser_tag_app_apply_command(app, &command)) {
+        return false;
+    }
+    lfrfid_reader_tag_consumed(app->rfid_reader, data, length);
+    return true;
+}
+
+// The radios are by far the most expensive part of startup (IR worker, RFID
+// protocol dictionary and worker, their threads), and the splash screen needs
+// none of them. They are brought up here while the splash is showing.
+static int32_t laser_tag_app_init_thread(void* context) {
+    LaserTagApp* app = context;
+
+    LFRFIDReader* reader =
+        lfrfid_reader_alloc(laser_tag_rfid_protocols, COUNT_OF(laser_tag_rfid_protocols));
+    lfrfid_reader_set_tag_callback(reader, LFRFIDProtocolEM4100, tag_callback, app);
+    lfrfid_reader_set_cooldown(reader, LASER_TAG_TAG_COOLDOWN_MS);
+
+    InfraredController* ir_controller = infrared_controller_alloc();
+    if(ir_controller) {
+        infrared_controller_set_event_callback(ir_controller, laser_tag_app_ir_callback, app);
+        infrared_controller_start_board_monitor(ir_controller);
+        app->init_radio = radio_scheduler_alloc(ir_controller, reader);
+        app->resume_available = game_checkpoint_load(app->checkpoint);
+    } else {
+        FURI_LOG_E(TAG, "Failed to allocate IR controller");
+        lfrfid_reader_free(reader);
+    }
+
+    app->init_stack_free = furi_thread_get_stack_space(furi_thread_get_current_id());
+    LaserTagEvent event = {.type = LaserTagEventTypeRadioReady};
+    laser_tag_app_post_event(app, &event);
+    return 0;
+}
+
+// Waits for the background init if it is still running and publishes its
+// result. Returns whether the radios are usable.
+static bool laser_tag_app_radio_ready(LaserTagApp* app) {
+    if(app->init_thread) {
+        furi_thread_join(app->init_thread);
+        furi_thread_free(app->init_thread);
+        app->init_thread = NULL;
+        FURI_LOG_I(
             TAG,
-            "Tag is not for game.  Data: %02x %02x %02x %02x %02x",
-            data[0],
-            data[1],
-            data[2],
-            data[3],
-            data[4]);
+            "Init thread stack: %lu of %d bytes never used",
+            app->init_stack_free,
+            LASER_TAG_INIT_STACK_SIZE);
+
+        app->radio = app->init_radio;
+        app->init_radio = NULL;
+        if(app->radio) {
+            app->ir_controller = radio_scheduler_get_ir_controller(app->radio);
+            app->rfid_reader = radio_scheduler_get_rfid_reader(app->radio);
+            FURI_LOG_I(
+                TAG,
+                "First frame after %lu ms, ready to fire after %lu ms",
+                app->first_frame_tick ? app->first_frame_tick - app->start_tick : 0,
+                furi_get_tick() - app->start_tick);
+        }
+    }
+    return app->radio != NULL;
+}
+
+// The ammo scan is a small state machine driven by the scan timer and
+// TagPickup events: the antenna stays up until a tag changes the ammo count,
+// the deadline passes or the player cancels with Back. The main loop stays
+// live throughout.
+static void laser_tag_app_scan_start(LaserTagApp* app) {
+    if(app->scan_active) {
         return;
     }
 
-    if(matching_team(app, data[2])) {
-        if(data[3] == 0xFD) {
-            uint16_t max_delta_ammo = data[4];
-            uint16_t ammo = game_state_get_ammo(app->game_state);
-            uint16_t delta_ammo = INITIAL_AMMO - ammo;
-            if(delta_ammo > max_delta_ammo) {
-                delta_ammo = max_delta_ammo;
-            }
-            game_state_increase_ammo(app->game_state, delta_ammo);
-            FURI_LOG_D(TAG, "Increased ammo by: %d", delta_ammo);
+    notification_message(app->notifications, &sequence_short_beep);
+    app->scan_active = true;
+    app->scan_started = furi_get_tick();
+    app->scan_success = false;
+    radio_scheduler_hold_rfid(app->radio, true);
+    timer_wheel_schedule(app->timers, &app->scan_timer, LASER_TAG_SCAN_TICK_MS);
+    laser_tag_view_set_scan_progress(app->view, 1);
+    app->need_redraw = true;
+}
+
+static void laser_tag_app_scan_finish(LaserTagApp* app, bool notify) {
+    if(!app->scan_active) {
+        return;
+    }
+
+    timer_wheel_cancel(app->timers, &app->scan_timer);
+    radio_scheduler_hold_rfid(app->radio, false);
+    app->scan_active = false;
+    laser_tag_view_set_scan_progress(app->view, 0);
+
+    if(notify) {
+        if(app->scan_success) {
+            notification_message(app->notifications, &sequence_success);
         } else {
-            FURI_LOG_W(TAG, "Tag action unknown: %02x %02x", data[3], data[4]);
+            notification_message(app->notifications, &sequence_error);
         }
+    }
+    app->need_redraw = true;
+}
+
+static void laser_tag_app_scan_tick(void* context) {
+    LaserTagApp* app = context;
+    if(!app->scan_active) {
+        return;
+    }
+
+    uint32_t elapsed = furi_get_tick() - app->scan_started;
+    uint32_t timeout = furi_ms_to_ticks(LASER_TAG_SCAN_TIMEOUT_MS);
+    if(elapsed >= timeout) {
+        FURI_LOG_I(TAG, "Ammo scan timed out");
+        laser_tag_app_scan_finish(app, true);
     } else {
-        FURI_LOG_I(TAG, "Tag not for team: %02x", data[2]);
+        laser_tag_view_set_scan_progress(app->view, 1 + (99 * elapsed) / timeout);
+        timer_wheel_schedule(app->timers, &app->scan_timer, LASER_TAG_SCAN_TICK_MS);
+        app->need_redraw = true;
     }
 }
 
+// Game over stops the radios and the HUD clock but keeps the match going, so
+// a player who scanned their respawn point picks it up where it is now.
+static void laser_tag_app_respawn(void* context) {
+    LaserTagApp* app = context;
+    if(app->state != LaserTagStateGameOver) {
+        return;
+    }
+
+    FURI_LOG_I(TAG, "Respawn delay over, back in the game");
+    game_state_respawn(app->game_state);
+    laser_tag_app_log(app, LaserTagLogEventRespawn);
+    laser_tag_view_update(app->view, app->game_state);
+    app->state = LaserTagStateGame;
+    radio_scheduler_start(app->radio);
+    uint32_t time_ms = game_state_get_time_ms(app->game_state);
+    timer_wheel_schedule(app->timers, &app->clock_timer, 1000 - time_ms % 1000);
+    laser_tag_app_checkpoint(app);
+    notification_message(app->notifications, &sequence_success);
+    app->need_redraw = true;
+}
+
+static void laser_tag_app_splash_done(void* context) {
+    LaserTagApp* app = context;
+    if(app->state != LaserTagStateSplashScreen) {
+        return;
+    }
+
+    FURI_LOG_I(TAG, "Splash screen time over, switching to TeamSelect");
+    app->state = LaserTagStateTeamSelect;
+    game_state_reset(app->game_state);
+    FURI_LOG_D(TAG, "Game state reset after splash screen");
+    app->need_redraw = true;
+}
+
+// The game clock is computed from the tick counter whenever it is read, so
+// this only has to redraw the HUD on each full second of the match clock.
+static void laser_tag_app_clock_tick(void* context) {
+    LaserTagApp* app = context;
+    if(app->state == LaserTagStateReferee) {
+        // The scoreboard refreshes at a fixed rate, however fast shots come in.
+        timer_wheel_schedule(app->timers, &app->clock_timer, LASER_TAG_REFEREE_REFRESH_MS);
+        app->need_redraw = true;
+        return;
+    }
+    if(app->state != LaserTagStateGame) {
+        return;
+    }
+
+    uint32_t time_ms = game_state_get_time_ms(app->game_state);
+    timer_wheel_schedule(app->timers, &app->clock_timer, 1000 - time_ms % 1000);
+    if(time_ms / 1000 % LASER_TAG_CHECKPOINT_S == 0) {
+        laser_tag_app_checkpoint(app);
+    }
+    laser_tag_view_update(app->view, app->game_state);
+    app->need_redraw = true;
+}
+
+static void laser_tag_app_perf_sample(LaserTagApp* app, PerfSample* sample) {
+    uint32_t stack_free = furi_thread_get_stack_space(furi_thread_get_current_id());
+    app->main_stack_free = MIN(app->main_stack_free, stack_free);
+
+    *sample = (PerfSample){
+        .loop_iterations = app->loop_iterations,
+        .loop_max_us = app->loop_max_cycles / furi_hal_cortex_instructions_per_microsecond(),
+        .redraws = app->redraws,
+        .queue_depth = furi_message_queue_get_count(app->event_queue),
+        .queue_size = LASER_TAG_EVENT_QUEUE_SIZE,
+        .queue_overflows = atomic_load(&app->dropped_events),
+        .free_heap = memmgr_get_free_heap(),
+        .main_stack_free = app->main_stack_free,
+        .rx_stack_free = UINT32_MAX,
+    };
+    app->loop_max_cycles = 0;
+
+    if(app->ir_controller) {
+        InfraredRxStats* rx = &app->ir_controller->rx_stats;
+        sample->rx_callbacks = perf_counter_get(&rx->callbacks);
+        sample->rx_decoded = perf_counter_get(&rx->decoded);
+        sample->rx_accepted = perf_counter_get(&rx->accepted);
+        sample->rx_dropped = perf_counter_get(&rx->dropped);
+        sample->rx_stack_free = perf_counter_get(&app->ir_controller->rx_stack_free);
+    }
+}
+
+static void laser_tag_app_perf_tick(void* context) {
+    LaserTagApp* app = context;
+    if(!app->perf_visible) {
+        return;
+    }
+
+    PerfSample sample;
+    laser_tag_app_perf_sample(app, &sample);
+    perf_overlay_update(app->perf, &sample);
+    timer_wheel_schedule(app->timers, &app->perf_timer, LASER_TAG_PERF_SAMPLE_MS);
+    app->need_redraw = true;
+}
+
+static void laser_tag_app_perf_toggle(LaserTagApp* app) {
+    app->perf_visible = !app->perf_visible;
+    if(app->perf_visible) {
+        PerfSample sample;
+        laser_tag_app_perf_sample(app, &sample);
+        perf_overlay_reset(app->perf, &sample);
+        timer_wheel_schedule(app->timers, &app->perf_timer, LASER_TAG_PERF_SAMPLE_MS);
+    } else {
+        timer_wheel_cancel(app->timers, &app->perf_timer);
+    }
+    app->need_redraw = true;
+}
+
 LaserTagApp* laser_tag_app_alloc() {
     FURI_LOG_D(TAG, "Allocating Laser Tag App");
-    LaserTagApp* app = malloc(sizeof(LaserTagApp));
+    LaserTagApp* app = laser_tag_arena_alloc(sizeof(LaserTagApp));
     if(!app) {
         FURI_LOG_E(TAG, "Failed to allocate LaserTagApp");
         return NULL;
@@ -205,22 +733,31 @@ LaserTagApp* laser_tag_app_alloc() {
     FURI_LOG_I(TAG, "LaserTagApp allocated successfully");
 
     memset(app, 0, sizeof(LaserTagApp));
+    app->start_tick = furi_get_tick();
+    app->start_free_heap = memmgr_get_free_heap();
 
+    app->mutex = furi_mutex_alloc(FuriMutexTypeNormal);
     app->gui = furi_record_open(RECORD_GUI);
     app->view_port = view_port_alloc();
     app->view = laser_tag_view_alloc();
     app->notifications = furi_record_open(RECORD_NOTIFICATION);
     app->game_state = game_state_alloc();
-    app->event_queue = furi_message_queue_alloc(8, sizeof(InputEvent));
-
-    if(!app->gui || !app->view_port || !app->view || !app->notifications || !app->game_state ||
-       !app->event_queue) {
+    app->perf = perf_overlay_alloc();
+    app->checkpoint = game_checkpoint_alloc();
+    app->referee = referee_alloc();
+    app->main_stack_free = UINT32_MAX;
+    app->event_queue =
+        furi_message_queue_alloc(LASER_TAG_EVENT_QUEUE_SIZE, sizeof(LaserTagEvent));
+
+    if(!app->mutex || !app->gui || !app->view_port || !app->view || !app->notifications ||
+       !app->game_state || !app->event_queue) {
         FURI_LOG_E(TAG, "Failed to allocate resources for LaserTagApp");
         laser_tag_app_free(app);
         return NULL;
     }
 
     app->state = LaserTagStateSplashScreen;
+    app->rules = (GameRules)GAME_RULES_DEFAULT;
     app->need_redraw = true;
     FURI_LOG_I(TAG, "Initial state set to SplashScreen");
 
@@ -229,50 +766,97 @@ LaserTagApp* laser_tag_app_alloc() {
     gui_add_view_port(app->gui, app->view_port, GuiLayerFullscreen);
     FURI_LOG_D(TAG, "ViewPort callbacks set and added to GUI");
 
-    app->timer = furi_timer_alloc(laser_tag_app_timer_callback, FuriTimerTypePeriodic, app);
-    if(!app->timer) {
-        FURI_LOG_E(TAG, "Failed to allocate timer");
-        laser_tag_app_free(app);
-        return NULL;
-    }
-    FURI_LOG_I(TAG, "Timer allocated");
-
-    app->reader = lfrfid_reader_alloc();
-    lfrfid_reader_set_tag_callback(app->reader, "EM4100", tag_callback, app);
-
-    furi_timer_start(app->timer, furi_kernel_get_tick_frequency());
-    FURI_LOG_D(TAG, "Timer started");
+    // Every timed thing in the game is a timer on this one wheel, which runs
+    // on the main thread.
+    app->timers = timer_wheel_alloc(laser_tag_app_timer_wake_callback, app);
+    timer_wheel_timer_init(&app->splash_timer, laser_tag_app_splash_done, app);
+    timer_wheel_timer_init(&app->clock_timer, laser_tag_app_clock_tick, app);
+    timer_wheel_timer_init(&app->scan_timer, laser_tag_app_scan_tick, app);
+    timer_wheel_timer_init(&app->perf_timer, laser_tag_app_perf_tick, app);
+    timer_wheel_timer_init(&app->respawn_timer, laser_tag_app_respawn, app);
+    timer_wheel_schedule(app->timers, &app->splash_timer, LASER_TAG_SPLASH_MS);
+    FURI_LOG_D(TAG, "Timers started");
+
+    app->init_thread =
+        furi_thread_alloc_ex(
+        "laser_tag_init", LASER_TAG_INIT_STACK_SIZE, laser_tag_app_init_thread, app);
+    furi_thread_set_priority(app->init_thread, FuriThreadPriorityLow);
+    furi_thread_start(app->init_thread);
 
     return app;
 }
 
+static void laser_tag_app_log_memory(LaserTagApp* app) {
+    size_t min_free_heap = memmgr_get_minimum_free_heap();
+    FURI_LOG_I(
+        TAG,
+        "Heap: %u free at start, %u lowest since boot, peak use up to %u",
+        (unsigned)app->start_free_heap,
+        (unsigned)min_free_heap,
+        (unsigned)(app->start_free_heap > min_free_heap ? app->start_free_heap - min_free_heap :
+                                                          0));
+
+    uint32_t stack_free = furi_thread_get_stack_space(furi_thread_get_current_id());
+    FURI_LOG_I(
+        TAG,
+        "Main thread stack: %lu of %d bytes never used",
+        stack_free,
+        LASER_TAG_MAIN_STACK_SIZE);
+    if(stack_free < LASER_TAG_MAIN_STACK_MIN_MARGIN) {
+        FURI_LOG_W(TAG, "Main thread stack nearly exhausted, raise stack_size in application.fam");
+    }
+}
+
 void laser_tag_app_free(LaserTagApp* app) {
     FURI_LOG_D(TAG, "Freeing Laser Tag App");
     furi_assert(app);
 
-    furi_timer_free(app->timer);
+    // Nothing is drawn anymore once this returns, so the rest can go without
+    // taking the mutex.
     view_port_enabled_set(app->view_port, false);
     gui_remove_view_port(app->gui, app->view_port);
+
+    // The init thread posts to the event queue, let it finish first.
+    laser_tag_app_radio_ready(app);
+
+    if(app->timers) {
+        timer_wheel_free(app->timers);
+    }
+    laser_tag_app_close_match_log(app);
+    if(app->checkpoint) {
+        game_checkpoint_free(app->checkpoint);
+    }
+    // The IR callbacks post to the event queue until the radios are gone.
+    if(app->radio) {
+        radio_scheduler_free(app->radio);
+        app->radio = NULL;
+        app->ir_controller = NULL;
+        app->rfid_reader = NULL;
+    }
+    if(app->referee) {
+        referee_free(app->referee);
+    }
+    if(app->dropped_events) {
+        FURI_LOG_W(TAG, "Dropped %u events on full queue", atomic_load(&app->dropped_events));
+    }
     view_port_free(app->view_port);
     laser_tag_view_free(app->view);
     furi_message_queue_free(app->event_queue);
-    if(app->ir_controller) {
-        infrared_controller_free(app->ir_controller);
-    }
-    if(app->reader) {
-        lfrfid_reader_free(app->reader);
-        app->reader = NULL;
+    if(app->mutex) {
+        furi_mutex_free(app->mutex);
     }
-    free(app->game_state);
     furi_record_close(RECORD_GUI);
     furi_record_close(RECORD_NOTIFICATION);
 
-    free(app);
+    shot_trace_dump();
+    laser_tag_app_log_memory(app);
+    laser_tag_arena_reset();
     FURI_LOG_I(TAG, "Laser Tag App freed successfully");
 }
 
 void laser_tag_app_fire(LaserTagApp* app) {
     furi_assert(app);
+    shot_trace(ShotTraceFire, SHOT_TRACE_NO_ID);
     FURI_LOG_D(TAG, "Firing laser");
 
     if(!app->ir_controller) {
@@ -285,9 +869,10 @@ void laser_tag_app_fire(LaserTagApp* app) {
         return;
     }
 
-    infrared_controller_send(app->ir_controller);
+    radio_scheduler_send(app->radio);
     FURI_LOG_D(TAG, "Laser fired, decreasing ammo by 1");
     game_state_decrease_ammo(app->game_state, 1);
+    laser_tag_app_log(app, LaserTagLogEventFire);
 
     notification_message(app->notifications, &sequence_short_beep);
 
@@ -304,9 +889,11 @@ void laser_tag_app_fire(LaserTagApp* app) {
 
 void laser_tag_app_handle_hit(LaserTagApp* app) {
     furi_assert(app);
-    FURI_LOG_D(TAG, "Handling hit, decreasing health by 10");
+    FURI_LOG_D(TAG, "Handling hit, decreasing health by %d", LASER_TAG_HIT_DAMAGE);
 
-    game_state_decrease_health(app->game_state, 10);
+    game_state_decrease_health(app->game_state, LASER_TAG_HIT_DAMAGE);
+    shot_trace(ShotTraceHealth, SHOT_TRACE_NO_ID);
+    laser_tag_app_log(app, LaserTagLogEventHit);
     notification_message(app->notifications, &sequence_vibro_1);
     FURI_LOG_I(TAG, "Notifying user with vibration");
 
@@ -315,39 +902,349 @@ void laser_tag_app_handle_hit(LaserTagApp* app) {
 
         notification_message(app->notifications, &sequence_error);
 
+        laser_tag_app_scan_finish(app, false);
+        radio_scheduler_stop(app->radio);
+        timer_wheel_cancel(app->timers, &app->clock_timer);
+        // The match log stays open, the player may still respawn.
+        laser_tag_app_log(app, LaserTagLogEventGameOver);
+        game_checkpoint_discard(app->checkpoint);
+        if(app->perf_visible) {
+            laser_tag_app_perf_toggle(app);
+        }
         app->state = LaserTagStateGameOver;
         app->need_redraw = true;
     }
 }
 
-static bool laser_tag_app_enter_game_state(LaserTagApp* app) {
+// Starts a new match, or picks one up from its checkpoint if resume is set.
+static bool laser_tag_app_enter_game_state(LaserTagApp* app, const GameCheckpointData* resume) {
     furi_assert(app);
     FURI_LOG_I(TAG, "Entering game state");
 
+    if(!laser_tag_app_radio_ready(app)) {
+        FURI_LOG_E(TAG, "Radios failed to initialize");
+        return false;
+    }
+
+    laser_tag_app_scan_finish(app, false);
     app->state = LaserTagStateGame;
     game_state_reset(app->game_state);
     FURI_LOG_D(TAG, "Game state reset");
+    if(resume) {
+        game_state_restore(app->game_state, &resume->game);
+        app->rules = resume->rules;
+    }
+    app->resume_available = false;
+
+    laser_tag_app_close_match_log(app);
+    app->match_log = log_sink_alloc(LASER_TAG_MATCH_LOG_PATH, sizeof(LaserTagLogRecord));
+    laser_tag_app_log(app, LaserTagLogEventStart);
 
     laser_tag_view_update(app->view, app->game_state);
+    laser_tag_view_set_shooter_clash(app->view, false);
     FURI_LOG_D(TAG, "View updated with new game state");
 
-    if(app->ir_controller) {
-        infrared_controller_free(app->ir_controller);
-        app->ir_controller = NULL;
+    // The controller lives as long as the app and is only reset between matches.
+    infrared_controller_reset(app->ir_controller, game_state_get_team(app->game_state));
+    infrared_controller_set_protocol(app->ir_controller, app->rules.shot_protocol);
+    infrared_controller_set_match_key(app->ir_controller, app->rules.match_key);
+    if(resume) {
+        infrared_controller_set_shot_counter(
+            app->ir_controller, resume->shot_counter + LASER_TAG_CHECKPOINT_SHOT_SKIP);
     }
-    app->ir_controller = infrared_controller_alloc();
-    if(!app->ir_controller) {
-        FURI_LOG_E(TAG, "Failed to allocate IR controller");
+    radio_scheduler_start(app->radio);
+    FURI_LOG_D(TAG, "IR controller reset, radios listening");
+    timer_wheel_cancel(app->timers, &app->splash_timer);
+    uint32_t time_ms = game_state_get_time_ms(app->game_state);
+    timer_wheel_schedule(app->timers, &app->clock_timer, 1000 - time_ms % 1000);
+    laser_tag_app_checkpoint(app);
+    app->need_redraw = true;
+    return true;
+}
+
+static void laser_tag_app_shot_callback(LaserTagTeam team, uint32_t shooter, void* context) {
+    LaserTagApp* app = context;
+    referee_record_shot(app->referee, team, shooter);
+}
+
+static bool laser_tag_app_enter_referee_state(LaserTagApp* app) {
+    FURI_LOG_I(TAG, "Entering referee state");
+
+    if(!laser_tag_app_radio_ready(app)) {
+        FURI_LOG_E(TAG, "Radios failed to initialize");
         return false;
     }
-    FURI_LOG_I(TAG, "IR controller allocated");
 
-    infrared_controller_set_team(app->ir_controller, game_state_get_team(app->game_state));
-    FURI_LOG_D(TAG, "IR controller team set");
+    laser_tag_app_scan_finish(app, false);
+    timer_wheel_cancel(app->timers, &app->splash_timer);
+
+    infrared_controller_reset(app->ir_controller, game_state_get_team(app->game_state));
+    infrared_controller_set_protocol(app->ir_controller, app->rules.shot_protocol);
+    infrared_controller_set_match_key(app->ir_controller, app->rules.match_key);
+    infrared_controller_set_shot_callback(app->ir_controller, laser_tag_app_shot_callback, app);
+    referee_start(app->referee);
+    // Nothing to pick up, RFID slots would only leave IR deaf.
+    radio_scheduler_set_duty_cycle(app->radio, RADIO_SCHEDULER_DEFAULT_PERIOD_MS, 0);
+    radio_scheduler_start(app->radio);
+
+    app->state = LaserTagStateReferee;
+    timer_wheel_schedule(app->timers, &app->clock_timer, LASER_TAG_REFEREE_REFRESH_MS);
     app->need_redraw = true;
     return true;
 }
 
+static void laser_tag_app_leave_referee_state(LaserTagApp* app) {
+    FURI_LOG_I(TAG, "Leaving referee state");
+
+    // The IR worker is joined once the radios are stopped, so no RX callback
+    // can still be recording a shot when the callback and the log go away.
+    radio_scheduler_stop(app->radio);
+    infrared_controller_set_shot_callback(app->ir_controller, NULL, NULL);
+    referee_stop(app->referee);
+    radio_scheduler_set_duty_cycle(
+        app->radio, RADIO_SCHEDULER_DEFAULT_PERIOD_MS, RADIO_SCHEDULER_DEFAULT_RFID_PERCENT);
+
+    timer_wheel_cancel(app->timers, &app->clock_timer);
+    app->state = LaserTagStateTeamSelect;
+    app->need_redraw = true;
+}
+
+// Short OK: tournament mode on or off. The match card scan starts on release
+// so that holding OK can make this Flipper the referee instead.
+static bool laser_tag_app_handle_setup_ok(LaserTagApp* app, const InputEvent* event) {
+    if(event->type == InputTypeLong) {
+        return laser_tag_app_enter_referee_state(app);
+    }
+    if(event->type != InputTypeShort || app->scan_active) {
+        return true;
+    }
+
+    if(app->rules.match_key) {
+        FURI_LOG_I(TAG, "Tournament mode off");
+        app->rules.match_key = 0;
+        app->need_redraw = true;
+    } else if(laser_tag_app_radio_ready(app)) {
+        FURI_LOG_I(TAG, "OK key pressed, scanning for a match card");
+        laser_tag_app_scan_start(app);
+    }
+    return true;
+}
+
+static bool laser_tag_app_handle_input(LaserTagApp* app, const InputEvent* event) {
+    bool running = true;
+
+    if(app->state == LaserTagStateGame && event->key == InputKeyLeft &&
+       event->type == InputTypeLong) {
+        laser_tag_app_perf_toggle(app);
+        return running;
+    }
+
+    if((app->state == LaserTagStateSplashScreen || app->state == LaserTagStateTeamSelect) &&
+       event->key == InputKeyOk) {
+        return laser_tag_app_handle_setup_ok(app, event);
+    }
+
+    if(event->type != InputTypePress && event->type != InputTypeRepeat) {
+        return running;
+    }
+
+    if(app->state == LaserTagStateSplashScreen || app->state == LaserTagStateTeamSelect) {
+        switch(event->key) {
+        case InputKeyLeft:
+            FURI_LOG_I(TAG, "Red team selected");
+            game_state_set_team(app->game_state, TeamRed);
+            running = laser_tag_app_enter_game_state(app, NULL);
+            break;
+        case InputKeyRight:
+            FURI_LOG_I(TAG, "Blue team selected");
+            game_state_set_team(app->game_state, TeamBlue);
+            running = laser_tag_app_enter_game_state(app, NULL);
+            break;
+        case InputKeyUp:
+            if(!app->rules.match_key) {
+                app->rules.shot_protocol = shot_protocol_next(app->rules.shot_protocol);
+                app->need_redraw = true;
+            }
+            break;
+        case InputKeyDown:
+            if(!app->rules.match_key) {
+                app->rules.shot_protocol = shot_protocol_prev(app->rules.shot_protocol);
+                app->need_redraw = true;
+            }
+            break;
+        case InputKeyBack:
+            if(app->scan_active) {
+                FURI_LOG_I(TAG, "Back key pressed, cancelling match card scan");
+                laser_tag_app_scan_finish(app, false);
+            } else {
+                FURI_LOG_I(TAG, "Back key pressed, exiting");
+                running = false;
+            }
+            break;
+        default:
+            break;
+        }
+    } else if(app->state == LaserTagStateReferee) {
+        if(event->key == InputKeyBack) {
+            laser_tag_app_leave_referee_state(app);
+        }
+    } else if(app->state == LaserTagStateResume) {
+        if(event->key == InputKeyOk) {
+            FURI_LOG_I(TAG, "OK key pressed, resuming match");
+            running = laser_tag_app_enter_game_state(
+                app, game_checkpoint_get_loaded(app->checkpoint));
+        } else if(event->key == InputKeyBack) {
+            FURI_LOG_I(TAG, "Back key pressed, dropping the saved match");
+            game_checkpoint_discard(app->checkpoint);
+            app->resume_available = false;
+            app->state = LaserTagStateTeamSelect;
+            app->need_redraw = true;
+        }
+    } else if(app->state == LaserTagStateGameOver) {
+        if(event->key == InputKeyUp && !timer_wheel_is_pending(&app->respawn_timer)) {
+            FURI_LOG_I(TAG, "Up key pressed, scanning for respawn point");
+            laser_tag_app_scan_start(app);
+        } else if(event->key == InputKeyBack && app->scan_active) {
+            FURI_LOG_I(TAG, "Back key pressed, cancelling respawn scan");
+            laser_tag_app_scan_finish(app, false);
+        } else if(event->key == InputKeyOk) {
+            FURI_LOG_I(TAG, "OK key pressed, restarting game");
+
+            // Restart game by resetting game state and transitioning to splash screen
+            laser_tag_app_scan_finish(app, false);
+            timer_wheel_cancel(app->timers, &app->respawn_timer);
+            laser_tag_app_close_match_log(app);
+            game_state_reset(app->game_state);
+            app->state = LaserTagStateSplashScreen;
+            timer_wheel_schedule(app->timers, &app->splash_timer, LASER_TAG_SPLASH_MS);
+            app->need_redraw = true;
+        }
+    } else if(app->state == LaserTagStateGame) {
+        if(event->key == InputKeyDown && game_state_get_ammo(app->game_state) == 0) {
+            // Reload ammo when Down button is pressed and ammo is depleted
+            FURI_LOG_I(TAG, "Down key pressed, reloading ammo");
+            game_state_increase_ammo(app->game_state, game_state_get_max_ammo(app->game_state));
+            laser_tag_app_log(app, LaserTagLogEventReload);
+            laser_tag_view_update(app->view, app->game_state);
+            app->need_redraw = true;
+        } else {
+            switch(event->key) {
+            case InputKeyBack:
+                if(app->scan_active) {
+                    FURI_LOG_I(TAG, "Back key pressed, cancelling ammo scan");
+                    laser_tag_app_scan_finish(app, false);
+                } else {
+                    // Saved so the match can be resumed if this was by accident.
+                    FURI_LOG_I(TAG, "Back key pressed, exiting");
+                    laser_tag_app_checkpoint(app);
+                    running = false;
+                }
+                break;
+            case InputKeyOk:
+                if(app->scan_active) {
+                    FURI_LOG_W(TAG, "Cannot fire while scanning for ammo");
+                } else {
+                    FURI_LOG_I(TAG, "OK key pressed, firing laser");
+                    laser_tag_app_fire(app);
+                }
+                break;
+            case InputKeyUp:
+                FURI_LOG_I(TAG, "Up key pressed, scanning for ammo");
+                laser_tag_app_scan_start(app);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    return running;
+}
+
+static bool laser_tag_app_handle_event(LaserTagApp* app, const LaserTagEvent* event) {
+    bool running = true;
+
+    switch(event->type) {
+    case LaserTagEventTypeInput:
+        running = laser_tag_app_handle_input(app, &event->input);
+        break;
+    case LaserTagEventTypeHit:
+        if(app->state == LaserTagStateGame) {
+            shot_trace(ShotTraceHitDequeue, SHOT_TRACE_NO_ID);
+            app->trace_hit = true;
+            FURI_LOG_D(TAG, "Hit received, processing");
+            laser_tag_app_handle_hit(app);
+            laser_tag_view_update(app->view, app->game_state);
+            app->need_redraw = true;
+        }
+        break;
+    case LaserTagEventTypeTagPickup:
+        if((app->state == LaserTagStateSplashScreen || app->state == LaserTagStateTeamSelect) &&
+           app->scan_active) {
+            // Tournament authentication needs every data bit NEC has.
+            app->rules.match_key = laser_tag_app_match_key(event->tag.data, event->tag.length);
+            app->rules.shot_protocol = InfraredProtocolNEC;
+            FURI_LOG_I(TAG, "Match card scanned, tournament mode on");
+            app->scan_success = true;
+            laser_tag_app_scan_finish(app, true);
+        } else if(app->state == LaserTagStateGameOver && app->scan_active) {
+            // Only a respawn point applies to a player who is out.
+            if(laser_tag_app_handle_tag(app, event->tag.data, event->tag.length)) {
+                laser_tag_app_log(app, LaserTagLogEventTag);
+                app->scan_success = true;
+                laser_tag_app_scan_finish(app, true);
+            }
+        } else if(app->state == LaserTagStateGame) {
+            if(laser_tag_app_handle_tag(app, event->tag.data, event->tag.length)) {
+                laser_tag_app_log(app, LaserTagLogEventTag);
+                laser_tag_view_update(app->view, app->game_state);
+                app->need_redraw = true;
+                if(app->scan_active) {
+                    app->scan_success = true;
+                    laser_tag_app_scan_finish(app, true);
+                } else {
+                    // Picked up passively during an RFID slot.
+                    notification_message(app->notifications, &sequence_success);
+                }
+            }
+        }
+        break;
+    case LaserTagEventTypeTimer:
+        // Due timers fire from the main loop after every event.
+        break;
+    case LaserTagEventTypeBoardAttached:
+        FURI_LOG_I(TAG, "External IR board attached");
+        break;
+    case LaserTagEventTypeBoardDetached:
+        FURI_LOG_I(TAG, "External IR board detached");
+        break;
+    case LaserTagEventTypeFeedbackDone:
+        FURI_LOG_D(TAG, "Hit feedback done, ready to fire");
+        break;
+    case LaserTagEventTypeShooterClash:
+        // Some of this player's shots will be dropped as replays by victims
+        // who also saw the other player. Only a new match card fixes that.
+        FURI_LOG_W(TAG, "Another player has the same shooter id");
+        if(app->state == LaserTagStateGame) {
+            laser_tag_view_set_shooter_clash(app->view, true);
+            notification_message(app->notifications, &sequence_error);
+            app->need_redraw = true;
+        }
+        break;
+    case LaserTagEventTypeRadioReady:
+        // A match that was cut short is offered before a new one is set up.
+        if(laser_tag_app_radio_ready(app) && app->resume_available && !app->scan_active &&
+           (app->state == LaserTagStateSplashScreen || app->state == LaserTagStateTeamSelect)) {
+            timer_wheel_cancel(app->timers, &app->splash_timer);
+            app->state = LaserTagStateResume;
+            app->need_redraw = true;
+        }
+        break;
+    }
+
+    return running;
+}
+
 int32_t laser_tag_app(void* p) {
     UNUSED(p);
     FURI_LOG_I(TAG, "Laser Tag app starting");
@@ -359,129 +1256,34 @@ int32_t laser_tag_app(void* p) {
     }
     FURI_LOG_D(TAG, "LaserTagApp allocated successfully");
 
-    InputEvent event;
+    // Everything that can change what is on screen arrives through the event
+    // queue, so the main thread sleeps until there is something to do.
+    LaserTagEvent event;
     bool running = true;
     while(running) {
-        FURI_LOG_D(TAG, "Start of main loop iteration");
-
-        update_infrared_board_status(app->ir_controller);
-
-        FuriStatus status = furi_message_queue_get(app->event_queue, &event, 100);
-        if(status == FuriStatusOk) {
-            FURI_LOG_D(TAG, "Received input event: type=%d, key=%d", event.type, event.key);
-            if(event.type == InputTypePress || event.type == InputTypeRepeat) {
-                if(app->state == LaserTagStateSplashScreen ||
-                   app->state == LaserTagStateTeamSelect) {
-                    switch(event.key) {
-                    case InputKeyLeft:
-                        FURI_LOG_I(TAG, "Red team selected");
-                        game_state_set_team(app->game_state, TeamRed);
-                        if(!laser_tag_app_enter_game_state(app)) {
-                            running = false;
-                        }
-                        break;
-                    case InputKeyRight:
-                        FURI_LOG_I(TAG, "Blue team selected");
-                        game_state_set_team(app->game_state, TeamBlue);
-                        if(!laser_tag_app_enter_game_state(app)) {
-                            running = false;
-                        }
-                        break;
-                    case InputKeyBack:
-                        FURI_LOG_I(TAG, "Back key pressed, exiting");
-                        running = false;
-                        break;
-                    default:
-                        break;
-                    }
-                } else if(app->state == LaserTagStateGameOver) {
-                    if(event.key == InputKeyOk) {
-                        FURI_LOG_I(TAG, "OK key pressed, restarting game");
-
-                        // Restart game by resetting game state and transitioning to splash screen
-                        game_state_reset(app->game_state);
-                        app->state = LaserTagStateSplashScreen;
-                        app->need_redraw = true;
-                    }
-                } else if(app->state == LaserTagStateGame) {
-                    if(event.key == InputKeyDown && game_state_get_ammo(app->game_state) == 0) {
-                        // Reload ammo when Down button is pressed and ammo is depleted
-                        FURI_LOG_I(TAG, "Down key pressed, reloading ammo");
-                        game_state_increase_ammo(app->game_state, INITIAL_AMMO);
-                        app->need_redraw = true;
-                    } else {
-                        switch(event.key) {
-                        case InputKeyBack:
-                            FURI_LOG_I(TAG, "Back key pressed, exiting");
-                            running = false;
-                            break;
-                        case InputKeyOk:
-                            FURI_LOG_I(TAG, "OK key pressed, firing laser");
-                            laser_tag_app_fire(app);
-                            break;
-                        case InputKeyUp:
-                            FURI_LOG_I(TAG, "Up key pressed, scanning for ammo");
-                            notification_message(app->notifications, &sequence_short_beep);
-                            uint16_t ammo = game_state_get_ammo(app->game_state);
-                            infrared_controller_pause(app->ir_controller);
-                            lfrfid_reader_start(app->reader);
-                            for(int i = 0; i < 30; i++) {
-                                furi_delay_ms(100);
-                                if(ammo != game_state_get_ammo(app->game_state)) {
-                                    break;
-                                }
-                            }
-                            lfrfid_reader_stop(app->reader);
-                            infrared_controller_resume(app->ir_controller);
-                            if(ammo != game_state_get_ammo(app->game_state)) {
-                                notification_message(app->notifications, &sequence_success);
-                            } else {
-                                notification_message(app->notifications, &sequence_error);
-                            }
-                            app->need_redraw = true;
-                            break;
-                        default:
-                            break;
-                        }
-                    }
-                }
-            }
-        } else if(status == FuriStatusErrorTimeout) {
-            FURI_LOG_D(TAG, "No input event, continuing");
-        } else {
-            FURI_LOG_E(TAG, "Failed to get input event, status: %d", status);
+        if(furi_message_queue_get(app->event_queue, &event, FuriWaitForever) != FuriStatusOk) {
+            continue;
         }
+        furi_mutex_acquire(app->mutex, FuriWaitForever);
+        uint32_t start = DWT->CYCCNT;
 
-        if(app->state == LaserTagStateGame && app->ir_controller) {
-            if(infrared_controller_receive(app->ir_controller)) {
-                FURI_LOG_D(TAG, "Hit received, processing");
-                laser_tag_app_handle_hit(app);
-            }
-
-            if(game_state_is_game_over(app->game_state)) {
-                FURI_LOG_I(TAG, "Game over, notifying user with error sequence");
-                notification_message(app->notifications, &sequence_error);
-                // Stop game logic after game over
-                app->state = LaserTagStateGameOver;
-                app->need_redraw = true;
-            }
-        } else if(app->state == LaserTagStateGameOver) {
-            if(event.key == InputKeyOk) {
-                FURI_LOG_I(TAG, "OK key pressed, restarting game");
-                game_state_reset(app->game_state);
-                app->state = LaserTagStateSplashScreen;
-                app->need_redraw = true;
-            }
-        }
+        running = laser_tag_app_handle_event(app, &event);
+        // Also catches up if a wake-up was dropped on a full queue.
+        timer_wheel_run(app->timers);
 
         if(app->need_redraw) {
-            FURI_LOG_D(TAG, "Updating viewport");
             view_port_update(app->view_port);
             app->need_redraw = false;
+            app->redraws++;
+            if(app->trace_hit) {
+                shot_trace(ShotTraceRedraw, SHOT_TRACE_NO_ID);
+                app->trace_hit = false;
+            }
         }
 
-        FURI_LOG_D(TAG, "End of main loop iteration");
-        furi_delay_ms(10);
+        app->loop_iterations++;
+        app->loop_max_cycles = MAX(app->loop_max_cycles, DWT->CYCCNT - start);
+        furi_mutex_release(app->mutex);
     }
 
     FURI_LOG_I(TAG, "Laser Tag app exiting");
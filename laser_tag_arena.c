@@ -0,0 +1,31 @@
+#include "laser_tag_arena.h"
+#include <furi.h>
+#include <stdatomic.h>
+
+#define TAG "LaserTagArena"
+
+static uint8_t laser_tag_arena[LASER_TAG_ARENA_SIZE]
+    __attribute__((aligned(LASER_TAG_ARENA_ALIGN)));
+static atomic_size_t laser_tag_arena_used;
+
+void* laser_tag_arena_alloc(size_t size) {
+    size = (size + LASER_TAG_ARENA_ALIGN - 1) & ~(size_t)(LASER_TAG_ARENA_ALIGN - 1);
+    // The radios are allocated on the init thread, so the bump must be atomic.
+    size_t offset = atomic_fetch_add(&laser_tag_arena_used, size);
+    furi_check(offset + size <= LASER_TAG_ARENA_SIZE);
+    return &laser_tag_arena[offset];
+}
+
+void laser_tag_arena_reset(void) {
+    FURI_LOG_I(
+        TAG,
+        "Arena used %u of %u bytes",
+        (unsigned)atomic_load(&laser_tag_arena_used),
+        (unsigned)LASER_TAG_ARENA_SIZE);
+    memset(laser_tag_arena, 0, sizeof(laser_tag_arena));
+    atomic_store(&laser_tag_arena_used, 0);
+}
+
+size_t laser_tag_arena_get_used(void) {
+    return atomic_load(&laser_tag_arena_used);
+}
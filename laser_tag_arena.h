@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stddef.h>
+
+/*
+ * All objects that live for the whole run of the app are carved out of one
+ * statically sized arena instead of separate heap blocks, so startup doesn't
+ * fail on a fragmented heap. Nothing is freed individually: the arena is reset
+ * as a whole when the app exits.
+ *
+ * Each object has a budget below, and its module checks at compile time that
+ * the object fits, so the arena can never run out at runtime.
+ */
+
+#define LASER_TAG_ARENA_ALIGN 8
+
+#define LASER_TAG_ARENA_APP_SIZE                 448
+#define LASER_TAG_ARENA_GAME_STATE_SIZE          64
+#define LASER_TAG_ARENA_VIEW_SIZE                16
+#define LASER_TAG_ARENA_INFRARED_CONTROLLER_SIZE 176
+#define LASER_TAG_ARENA_LFRFID_READER_SIZE       384
+#define LASER_TAG_ARENA_LFRFID_DATA_SIZE         32
+#define LASER_TAG_ARENA_RADIO_SCHEDULER_SIZE     128
+#define LASER_TAG_ARENA_SHOT_AUTH_SIZE           1040
+#define LASER_TAG_ARENA_TIMER_WHEEL_SIZE         (128 * sizeof(void*) + 64)
+#define LASER_TAG_ARENA_PERF_OVERLAY_SIZE        128
+#define LASER_TAG_ARENA_GAME_CHECKPOINT_SIZE     96
+#define LASER_TAG_ARENA_REFEREE_SIZE             672
+
+#define LASER_TAG_ARENA_SIZE                                                       \
+    (LASER_TAG_ARENA_APP_SIZE + LASER_TAG_ARENA_GAME_STATE_SIZE +                  \
+     LASER_TAG_ARENA_VIEW_SIZE + LASER_TAG_ARENA_INFRARED_CONTROLLER_SIZE +        \
+     LASER_TAG_ARENA_LFRFID_READER_SIZE + LASER_TAG_ARENA_LFRFID_DATA_SIZE +       \
+     LASER_TAG_ARENA_RADIO_SCHEDULER_SIZE + LASER_TAG_ARENA_SHOT_AUTH_SIZE +       \
+     LASER_TAG_ARENA_TIMER_WHEEL_SIZE + LASER_TAG_ARENA_PERF_OVERLAY_SIZE +       \
+     LASER_TAG_ARENA_GAME_CHECKPOINT_SIZE + LASER_TAG_ARENA_REFEREE_SIZE)
+
+#define LASER_TAG_ARENA_CHECK(type, budget)                                        \
+    _Static_assert(                                                                \
+        sizeof(type) <= (budget) && (budget) % LASER_TAG_ARENA_ALIGN == 0,         \
+        #type " does not fit its arena budget")
+
+/** Returns zeroed, aligned memory for a fixed-lifetime object. Never fails. */
+void* laser_tag_arena_alloc(size_t size);
+
+/** Releases everything allocated from the arena. */
+void laser_tag_arena_reset(void);
+
+size_t laser_tag_arena_get_used(void);
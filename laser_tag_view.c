@@ -1,4 +1,5 @@
 #include "laser_tag_view.h"
+#include "laser_tag_arena.h"
 #include <furi.h>
 #include <gui/elements.h>
 
@@ -6,12 +7,19 @@ struct LaserTagView {
     View* view;
 };
 
+LASER_TAG_ARENA_CHECK(LaserTagView, LASER_TAG_ARENA_VIEW_SIZE);
+
 typedef struct {
     LaserTagTeam team;
     uint8_t health;
+    uint8_t armor;
     uint16_t ammo;
+    uint16_t max_ammo;
     uint32_t game_time;
     bool game_over;
+    bool has_flag;
+    bool shooter_clash;
+    uint8_t scan_progress;
 } LaserTagViewModel;
 
 static void laser_tag_view_draw_callback(Canvas* canvas, void* model) {
@@ -28,25 +36,41 @@ static void laser_tag_view_draw_callback(Canvas* canvas, void* model) {
     canvas_draw_str_aligned(canvas, 5, 25, AlignLeft, AlignBottom, "Health:");
     canvas_draw_frame(canvas, 55, 20, 60, 10);
     canvas_draw_box(canvas, 56, 21, (58 * m->health) / 100, 8);
+    // Armor is soaked up before health, so it sits right under the health bar.
+    if(m->armor) {
+        canvas_draw_box(canvas, 55, 31, (60 * m->armor) / MAX_ARMOR, 2);
+    }
 
     canvas_draw_str_aligned(canvas, 5, 40, AlignLeft, AlignBottom, "Ammo:");
     canvas_draw_frame(canvas, 55, 35, 60, 10);
-    canvas_draw_box(canvas, 56, 36, (58 * m->ammo) / 100, 8);
+    if(m->max_ammo) {
+        canvas_draw_box(canvas, 56, 36, (58 * MIN(m->ammo, m->max_ammo)) / m->max_ammo, 8);
+    }
 
-    if(m->ammo == 0) {
+    if(m->scan_progress) {
+        canvas_draw_str_aligned(canvas, 5, 55, AlignLeft, AlignBottom, "Scan:");
+        canvas_draw_frame(canvas, 55, 48, 60, 8);
+        canvas_draw_box(canvas, 56, 49, (58 * m->scan_progress) / 100, 6);
+    } else if(m->ammo == 0) {
         canvas_draw_str_aligned(canvas, 5, 55, AlignLeft, AlignBottom, "Press 'Down' to Reload");
     }
 
-    uint32_t minutes = m->game_time / 60;
+    // Formatted on the stack, the draw path must not touch the heap.
+    char time_str[8];
+    uint32_t minutes = (m->game_time / 60) % 100;
     uint32_t seconds = m->game_time % 60;
-    FuriString* str = furi_string_alloc_printf("%02ld:%02ld", minutes, seconds);
-    canvas_draw_str_aligned(canvas, 5, 60, AlignLeft, AlignBottom, furi_string_get_cstr(str));
+    snprintf(time_str, sizeof(time_str), "%02lu:%02lu", minutes, seconds);
+    canvas_draw_str_aligned(canvas, 123, 10, AlignRight, AlignBottom, time_str);
 
-    if(m->game_over) {
-        canvas_draw_str_aligned(canvas, 5, 75, AlignLeft, AlignBottom, "GAME OVER");
+    if(m->has_flag) {
+        canvas_draw_str_aligned(canvas, 75, 10, AlignCenter, AlignBottom, "FLAG");
     }
 
-    furi_string_free(str);
+    if(m->game_over) {
+        canvas_draw_str_aligned(canvas, 64, 63, AlignCenter, AlignBottom, "GAME OVER");
+    } else if(m->shooter_clash) {
+        canvas_draw_str_aligned(canvas, 64, 63, AlignCenter, AlignBottom, "ID clash: new card");
+    }
 }
 
 static bool laser_tag_view_input_callback(InputEvent* event, void* context) {
@@ -56,14 +80,13 @@ static bool laser_tag_view_input_callback(InputEvent* event, void* context) {
 }
 
 LaserTagView* laser_tag_view_alloc() {
-    LaserTagView* laser_tag_view = malloc(sizeof(LaserTagView));
+    LaserTagView* laser_tag_view = laser_tag_arena_alloc(sizeof(LaserTagView));
     if(!laser_tag_view) {
         return NULL;
     }
 
     laser_tag_view->view = view_alloc();
     if(!laser_tag_view->view) {
-        free(laser_tag_view);
         return NULL;
     }
 
@@ -79,8 +102,8 @@ void laser_tag_view_free(LaserTagView* laser_tag_view) {
     if(!laser_tag_view) return;
     if(laser_tag_view->view) {
         view_free(laser_tag_view->view);
+        laser_tag_view->view = NULL;
     }
-    free(laser_tag_view);
 }
 
 void laser_tag_view_draw(View* view, Canvas* canvas) {
@@ -106,9 +129,29 @@ void laser_tag_view_update(LaserTagView* laser_tag_view, GameState* game_state)
         {
             model->team = game_state_get_team(game_state);
             model->health = game_state_get_health(game_state);
+            model->armor = game_state_get_armor(game_state);
             model->ammo = game_state_get_ammo(game_state);
+            model->max_ammo = game_state_get_max_ammo(game_state);
             model->game_time = game_state_get_time(game_state);
             model->game_over = game_state_is_game_over(game_state);
+            model->has_flag = game_state_has_flag(game_state);
         },
         true);
 }
+
+void laser_tag_view_set_scan_progress(LaserTagView* laser_tag_view, uint8_t percent) {
+    furi_assert(laser_tag_view);
+
+    with_view_model(
+        laser_tag_view->view,
+        LaserTagViewModel * model,
+        { model->scan_progress = MIN(percent, 100); },
+        true);
+}
+
+void laser_tag_view_set_shooter_clash(LaserTagView* laser_tag_view, bool clash) {
+    furi_assert(laser_tag_view);
+
+    with_view_model(
+        laser_tag_view->view, LaserTagViewModel * model, { model->shooter_clash = clash; }, true);
+}
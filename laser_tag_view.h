@@ -11,3 +11,5 @@ void laser_tag_view_free(LaserTagView* laser_tag_view);
 void laser_tag_view_draw(View* view, Canvas* canvas);
 View* laser_tag_view_get_view(LaserTagView* laser_tag_view);
 void laser_tag_view_update(LaserTagView* laser_tag_view, GameState* game_state);
+void laser_tag_view_set_scan_progress(LaserTagView* laser_tag_view, uint8_t percent);
+void laser_tag_view_set_shooter_clash(LaserTagView* laser_tag_view, bool clash);
@@ -1,117 +1,340 @@
 #include "lfrfid_reader.h"
-#include <lfrfid/protocols/lfrfid_protocols.h>
+#include "laser_tag_arena.h"
+#include <stdatomic.h>
 #include <toolbox/protocols/protocol_dict.h>
 #include <lib/lfrfid/lfrfid_worker.h>
 
 #define TAG "LfRfid_Reader"
 
+// Recently reported tags, open addressing over a power-of-two table. Lookups
+// and inserts touch at most LFRFID_READER_COOLDOWN_PROBES slots.
+#define LFRFID_READER_COOLDOWN_SLOTS  16
+#define LFRFID_READER_COOLDOWN_PROBES 4
+
+// Longest a pause or resume waits for the reader thread to hand the antenna
+// over. Only hit if the worker never reports the ASK read as started.
+#define LFRFID_READER_HANDOVER_TIMEOUT_MS 100
+
+// A read started while the worker is still leaving the last one is dropped by
+// it. A resume that hears nothing back within this long starts it again.
+#define LFRFID_READER_ARM_RETRY_MS 10
+
+typedef struct {
+    uint32_t id;
+    uint32_t expires;
+    bool used;
+} LFRFIDReaderCooldownSlot;
+
 typedef enum {
     LFRFIDReaderEventTagRead = (1 << 0),
     LFRFIDReaderEventStopThread = (1 << 1),
-    LFRFIDReaderEventAll = (LFRFIDReaderEventTagRead | LFRFIDReaderEventStopThread),
+    LFRFIDReaderEventArm = (1 << 2),
+    LFRFIDReaderEventAll =
+        (LFRFIDReaderEventTagRead | LFRFIDReaderEventStopThread | LFRFIDReaderEventArm),
 } LFRFIDReaderEventType;
 
 struct LFRFIDReader {
-    char* requested_protocol;
+    // The dictionary keeps a pointer to this array, and its ProtocolIds index it.
+    const ProtocolBase* protocols[LFRFID_READER_MAX_PROTOCOLS];
+    size_t protocol_count;
+    ProtocolId requested_protocol;
     ProtocolId protocol;
     ProtocolDict* dict;
     LFRFIDWorker* worker;
     FuriThread* thread;
     LFRFIDReaderTagCallback callback;
     void* callback_context;
+    uint8_t* data;
+    size_t data_size;
+    uint32_t cooldown_ticks;
+    FuriMutex* cooldown_mutex; // the reader thread looks up, the app records
+    LFRFIDReaderCooldownSlot cooldown[LFRFID_READER_COOLDOWN_SLOTS];
+    volatile bool arm_requested;
+    bool armed;
+    atomic_bool arming; // set until the worker reports the ASK read started
+    FuriSemaphore* handover; // released once a pause or resume took effect
 };
 
+LASER_TAG_ARENA_CHECK(struct LFRFIDReader, LASER_TAG_ARENA_LFRFID_READER_SIZE);
+
 static void lfrfid_cli_read_callback(LFRFIDWorkerReadResult result, ProtocolId proto, void* ctx) {
     furi_assert(ctx);
     LFRFIDReader* context = ctx;
-    if(result == LFRFIDWorkerReadDone) {
+    if(result == LFRFIDWorkerReadStartASK) {
+        // Re-arming after a tag also starts the read again, only a resume waits.
+        if(atomic_exchange(&context->arming, false)) {
+            furi_semaphore_release(context->handover);
+        }
+    } else if(result == LFRFIDWorkerReadDone) {
         context->protocol = proto;
         furi_thread_flags_set(furi_thread_get_id(context->thread), LFRFIDReaderEventTagRead);
     }
 }
 
-LFRFIDReader* lfrfid_reader_alloc() {
-    LFRFIDReader* reader = malloc(sizeof(LFRFIDReader));
+LFRFIDReader* lfrfid_reader_alloc(const LFRFIDProtocol* protocols, size_t protocol_count) {
+    furi_check(protocols);
+    furi_check(protocol_count > 0 && protocol_count <= LFRFID_READER_MAX_PROTOCOLS);
+
+    LFRFIDReader* reader = laser_tag_arena_alloc(sizeof(LFRFIDReader));
+    memset(reader, 0, sizeof(LFRFIDReader));
+    for(size_t i = 0; i < protocol_count; i++) {
+        furi_check(protocols[i] < LFRFIDProtocolMax);
+        reader->protocols[i] = lfrfid_protocols[protocols[i]];
+    }
+    reader->protocol_count = protocol_count;
+    reader->requested_protocol = PROTOCOL_NO;
     reader->protocol = PROTOCOL_NO;
-    reader->dict = protocol_dict_alloc(lfrfid_protocols, LFRFIDProtocolMax);
+    // Only the decoders we may actually be asked for get allocated and fed.
+    reader->dict = protocol_dict_alloc(reader->protocols, reader->protocol_count);
     reader->worker = lfrfid_worker_alloc(reader->dict);
+    // Decoded tags land here, so the reader thread never touches the heap.
+    reader->data_size = protocol_dict_get_max_data_size(reader->dict);
+    furi_check(reader->data_size <= LASER_TAG_ARENA_LFRFID_DATA_SIZE);
+    reader->data = laser_tag_arena_alloc(reader->data_size);
+    reader->handover = furi_semaphore_alloc(1, 0);
+    reader->cooldown_mutex = furi_mutex_alloc(FuriMutexTypeNormal);
 
     return reader;
 }
 
 void lfrfid_reader_set_tag_callback(
     LFRFIDReader* reader,
-    char* requested_protocol,
+    LFRFIDProtocol requested_protocol,
     LFRFIDReaderTagCallback callback,
     void* context) {
     furi_assert(reader);
-    furi_assert(requested_protocol);
-    reader->requested_protocol = requested_protocol;
+    reader->requested_protocol = PROTOCOL_NO;
+    for(size_t i = 0; i < reader->protocol_count; i++) {
+        if(reader->protocols[i] == lfrfid_protocols[requested_protocol]) {
+            reader->requested_protocol = i;
+        }
+    }
+    furi_check(reader->requested_protocol != PROTOCOL_NO);
     reader->callback = callback;
     reader->callback_context = context;
 }
 
-static int32_t lfrfid_reader_start_thread(void* ctx) {
-    LFRFIDReader* reader = (LFRFIDReader*)ctx;
-    furi_thread_flags_clear(LFRFIDReaderEventAll);
-    lfrfid_worker_start_thread(reader->worker);
+void lfrfid_reader_set_cooldown(LFRFIDReader* reader, uint32_t cooldown_ms) {
+    furi_assert(reader);
+    furi_mutex_acquire(reader->cooldown_mutex, FuriWaitForever);
+    reader->cooldown_ticks = furi_ms_to_ticks(cooldown_ms);
+    memset(reader->cooldown, 0, sizeof(reader->cooldown));
+    furi_mutex_release(reader->cooldown_mutex);
+}
+
+static uint32_t lfrfid_reader_tag_id(const uint8_t* data, size_t size) {
+    // FNV-1a
+    uint32_t hash = 2166136261UL;
+    for(size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 16777619UL;
+    }
+    return hash;
+}
+
+static bool lfrfid_reader_cooldown_slot_live(const LFRFIDReaderCooldownSlot* slot, uint32_t now) {
+    return slot->used && (int32_t)(slot->expires - now) > 0;
+}
+
+// Returns true if the tag was consumed within the cooldown window. Must be
+// called with the cooldown mutex held.
+static bool lfrfid_reader_cooldown_active(LFRFIDReader* reader, uint32_t id, uint32_t now) {
+    if(!reader->cooldown_ticks) {
+        return false;
+    }
+
+    for(size_t i = 0; i < LFRFID_READER_COOLDOWN_PROBES; i++) {
+        const LFRFIDReaderCooldownSlot* slot =
+            &reader->cooldown[(id + i) & (LFRFID_READER_COOLDOWN_SLOTS - 1)];
+        if(lfrfid_reader_cooldown_slot_live(slot, now) && slot->id == id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Must be called with the cooldown mutex held.
+static void lfrfid_reader_cooldown_record(LFRFIDReader* reader, uint32_t id, uint32_t now) {
+    LFRFIDReaderCooldownSlot* victim = NULL;
+    for(size_t i = 0; i < LFRFID_READER_COOLDOWN_PROBES; i++) {
+        LFRFIDReaderCooldownSlot* slot =
+            &reader->cooldown[(id + i) & (LFRFID_READER_COOLDOWN_SLOTS - 1)];
+        if(!lfrfid_reader_cooldown_slot_live(slot, now) || slot->id == id) {
+            victim = slot;
+            break;
+        } else if(!victim || (int32_t)(slot->expires - victim->expires) < 0) {
+            victim = slot;
+        }
+    }
+
+    // Evicting the entry closest to expiry keeps the table bounded.
+    victim->id = id;
+    victim->expires = now + reader->cooldown_ticks;
+    victim->used = true;
+}
+
+bool lfrfid_reader_tag_cooling_down(LFRFIDReader* reader, const uint8_t* data, size_t length) {
+    furi_assert(reader);
+    uint32_t id = lfrfid_reader_tag_id(data, length);
+    furi_mutex_acquire(reader->cooldown_mutex, FuriWaitForever);
+    bool cooling_down = lfrfid_reader_cooldown_active(reader, id, furi_get_tick());
+    furi_mutex_release(reader->cooldown_mutex);
+    return cooling_down;
+}
+
+void lfrfid_reader_tag_consumed(LFRFIDReader* reader, const uint8_t* data, size_t length) {
+    furi_assert(reader);
+    uint32_t id = lfrfid_reader_tag_id(data, length);
+    furi_mutex_acquire(reader->cooldown_mutex, FuriWaitForever);
+    if(reader->cooldown_ticks) {
+        lfrfid_reader_cooldown_record(reader, id, furi_get_tick());
+    }
+    furi_mutex_release(reader->cooldown_mutex);
+}
+
+static void lfrfid_reader_arm(LFRFIDReader* reader) {
+    reader->protocol = PROTOCOL_NO;
     lfrfid_worker_read_start(
         reader->worker, LFRFIDWorkerReadTypeASKOnly, lfrfid_cli_read_callback, reader);
+}
+
+static void lfrfid_reader_handle_tag(LFRFIDReader* reader) {
+    if(reader->protocol == PROTOCOL_NO) {
+        return;
+    }
+
+    const char* protocol_name = protocol_dict_get_name(reader->dict, reader->protocol);
+    if(reader->protocol == reader->requested_protocol) {
+        size_t size = protocol_dict_get_data_size(reader->dict, reader->protocol);
+        furi_check(size <= reader->data_size);
+        protocol_dict_get_data(reader->dict, reader->protocol, reader->data, size);
+        if(lfrfid_reader_tag_cooling_down(reader, reader->data, size)) {
+            FURI_LOG_D(TAG, "Tag %s still cooling down", protocol_name);
+        } else if(reader->callback) {
+            FURI_LOG_D(TAG, "Tag %s detected", protocol_name);
+            reader->callback(reader->data, size, reader->callback_context);
+        } else {
+            FURI_LOG_W(TAG, "No callback set for tag %s", protocol_name);
+        }
+    } else {
+        FURI_LOG_W(
+            TAG,
+            "Unsupported tag %s, expected %s",
+            protocol_name,
+            protocol_dict_get_name(reader->dict, reader->requested_protocol));
+    }
+}
+
+// The thread and the worker's thread live from lfrfid_reader_start to
+// lfrfid_reader_stop. Between scans the reader thread stays parked on its
+// thread flags and the worker idles, so resuming only arms the ASK read.
+//
+// lfrfid_worker_stop gives no sign of when the worker has left read mode, it
+// drops the antenna on the next stop check of its read loop. Pausing doesn't
+// wait for that: a resume that follows too soon is the only thing that can
+// tell, the worker drops that read, and arming is repeated until the read
+// callback reports the read started.
+static int32_t lfrfid_reader_start_thread(void* ctx) {
+    LFRFIDReader* reader = (LFRFIDReader*)ctx;
     while(true) {
-        uint32_t flags = furi_thread_flags_wait(LFRFIDReaderEventAll, FuriFlagWaitAny, 100);
-
-        if(flags != (unsigned)FuriFlagErrorTimeout) {
-            if((flags & LFRFIDReaderEventTagRead) == LFRFIDReaderEventTagRead) {
-                furi_thread_flags_clear(LFRFIDReaderEventTagRead);
-                if(reader->protocol != PROTOCOL_NO) {
-                    const char* protocol_name =
-                        protocol_dict_get_name(reader->dict, reader->protocol);
-                    if(strcmp(protocol_name, reader->requested_protocol) == 0) {
-                        size_t size = protocol_dict_get_data_size(reader->dict, reader->protocol);
-                        uint8_t* data = malloc(size);
-                        protocol_dict_get_data(reader->dict, reader->protocol, data, size);
-                        if(reader->callback) {
-                            FURI_LOG_D(TAG, "Tag %s detected", protocol_name);
-                            reader->callback(data, size, reader->callback_context);
-                        } else {
-                            FURI_LOG_W(TAG, "No callback set for tag %s", protocol_name);
-                        }
-                        free(data);
-                    } else {
-                        FURI_LOG_W(TAG, "Unsupported tag %s, expected EM4100", protocol_name);
-                    }
+        uint32_t flags =
+            furi_thread_flags_wait(LFRFIDReaderEventAll, FuriFlagWaitAny, FuriWaitForever);
+        if(flags & FuriFlagError) {
+            continue;
+        }
+
+        if(flags & LFRFIDReaderEventStopThread) {
+            break;
+        }
+
+        if(flags & LFRFIDReaderEventArm) {
+            bool arm = reader->arm_requested;
+            if(arm && (!reader->armed || reader->arming)) {
+                // The read callback releases the handover once the read runs.
+                reader->arming = true;
+                lfrfid_reader_arm(reader);
+            } else {
+                if(!arm && reader->armed) {
+                    atomic_store(&reader->arming, false);
+                    lfrfid_worker_stop(reader->worker);
                 }
-                reader->protocol = PROTOCOL_NO;
-                lfrfid_worker_read_start(
-                    reader->worker, LFRFIDWorkerReadTypeASKOnly, lfrfid_cli_read_callback, reader);
-            } else if((flags & LFRFIDReaderEventStopThread) == LFRFIDReaderEventStopThread) {
-                break;
+                furi_semaphore_release(reader->handover);
             }
+            reader->armed = arm;
+        }
+
+        if((flags & LFRFIDReaderEventTagRead) && reader->armed) {
+            lfrfid_reader_handle_tag(reader);
+            lfrfid_reader_arm(reader);
         }
     }
-    lfrfid_worker_stop(reader->worker);
-    lfrfid_worker_stop_thread(reader->worker);
+    if(reader->armed) {
+        lfrfid_worker_stop(reader->worker);
+        reader->armed = false;
+    }
     FURI_LOG_D(TAG, "LfRfidReader thread exiting");
     return 0;
 }
 
 void lfrfid_reader_start(LFRFIDReader* reader) {
+    furi_assert(reader);
+    if(reader->thread) {
+        return;
+    }
+    lfrfid_worker_start_thread(reader->worker);
     reader->thread =
         furi_thread_alloc_ex("lfrfid_reader", 2048, lfrfid_reader_start_thread, reader);
     furi_thread_start(reader->thread);
 }
 
+// Asks the reader thread to arm or disarm and waits until it did.
+static void lfrfid_reader_hand_over(LFRFIDReader* reader, bool arm) {
+    // Drop a release left over from a handover that timed out.
+    furi_semaphore_acquire(reader->handover, 0);
+    reader->arm_requested = arm;
+    for(uint32_t waited = 0; waited < LFRFID_READER_HANDOVER_TIMEOUT_MS;
+        waited += LFRFID_READER_ARM_RETRY_MS) {
+        furi_thread_flags_set(furi_thread_get_id(reader->thread), LFRFIDReaderEventArm);
+        if(furi_semaphore_acquire(
+               reader->handover, furi_ms_to_ticks(LFRFID_READER_ARM_RETRY_MS)) == FuriStatusOk) {
+            return;
+        }
+    }
+    FURI_LOG_W(TAG, "Reader thread did not %s the read in time", arm ? "arm" : "disarm");
+}
+
+void lfrfid_reader_resume(LFRFIDReader* reader) {
+    furi_assert(reader);
+    furi_check(reader->thread);
+    uint32_t start = furi_get_tick();
+    lfrfid_reader_hand_over(reader, true);
+    FURI_LOG_D(TAG, "Read armed %lu ticks after resume", furi_get_tick() - start);
+}
+
+void lfrfid_reader_pause(LFRFIDReader* reader) {
+    furi_assert(reader);
+    if(reader->thread) {
+        lfrfid_reader_hand_over(reader, false);
+    }
+}
+
 void lfrfid_reader_stop(LFRFIDReader* reader) {
     if(reader->thread) {
+        FURI_LOG_I(
+            TAG,
+            "Reader thread stack: %lu bytes never used",
+            furi_thread_get_stack_space(furi_thread_get_id(reader->thread)));
         furi_thread_flags_set(furi_thread_get_id(reader->thread), LFRFIDReaderEventStopThread);
         furi_thread_join(reader->thread);
+        furi_thread_free(reader->thread);
         reader->thread = NULL;
+        lfrfid_worker_stop_thread(reader->worker);
     }
 }
 
 void lfrfid_reader_free(LFRFIDReader* reader) {
     lfrfid_reader_stop(reader);
+    furi_semaphore_free(reader->handover);
+    furi_mutex_free(reader->cooldown_mutex);
     protocol_dict_free(reader->dict);
     lfrfid_worker_free(reader->worker);
-    free(reader);
 }
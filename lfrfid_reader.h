@@ -3,11 +3,15 @@
 /**
 * @file lfrfid_reader.h
 * @brief EM4100 tag reader, inspired by applications/main/lfrfid/lfrfid_cli.c
-* @details This file contains the declaration of the LFRFIDReader structure and its functions. You typically allocate a new LFRFIDReader, set the tag detection callback, start the reader. The tag detection callback is called each time a tag is detected. Once you are done, you stop the reader and free it.
+* @details This file contains the declaration of the LFRFIDReader structure and its functions. You typically allocate a new LFRFIDReader, set the tag detection callback, start the reader and resume it whenever you want to scan. The tag detection callback is called each time a tag is detected while the reader is resumed. Pausing keeps the reader thread parked so the next resume is cheap. Once you are done, you stop the reader and free it.
 * @author CodeAllNight (MrDerekJamison)
 */
 
 #include <furi.h>
+#include <lfrfid/protocols/lfrfid_protocols.h>
+
+/** Maximum number of protocols a reader can be asked to decode. */
+#define LFRFID_READER_MAX_PROTOCOLS 4
 
 typedef struct LFRFIDReader LFRFIDReader;
 
@@ -20,32 +24,73 @@ typedef struct LFRFIDReader LFRFIDReader;
 typedef void (*LFRFIDReaderTagCallback)(uint8_t* data, uint8_t length, void* context);
 
 /**
- * @brief Allocates a new LFRFIDReader.
+ * @brief Allocates a new LFRFIDReader that only decodes the given protocols.
+ * @param protocols Protocols to decode, e.g. {LFRFIDProtocolEM4100}.
+ * @param protocol_count Number of protocols, at most LFRFID_READER_MAX_PROTOCOLS.
  * @return LFRFIDReader* Pointer to the allocated LFRFIDReader.
  */
-LFRFIDReader* lfrfid_reader_alloc();
+LFRFIDReader* lfrfid_reader_alloc(const LFRFIDProtocol* protocols, size_t protocol_count);
 
 /**
  * @brief Sets the tag detection callback.
  * @param reader LFRFIDReader to set the callback for.
- * @param requested_protocol Requested protocol, e.g. "EM4100".
+ * @param requested_protocol Requested protocol, e.g. LFRFIDProtocolEM4100. Must be one of the protocols passed to lfrfid_reader_alloc.
  * @param callback Callback function.
  * @param context Callback context.
  */
 void lfrfid_reader_set_tag_callback(
     LFRFIDReader* reader,
-    char* requested_protocol,
+    LFRFIDProtocol requested_protocol,
     LFRFIDReaderTagCallback callback,
     void* context);
 
 /**
- * @brief Starts the LFRFIDReader.
+ * @brief Suppresses repeat reports of consumed tags.
+ * @details Once a tag has been marked consumed with lfrfid_reader_tag_consumed, further reads of it are dropped on the reader thread until cooldown_ms has passed. Tags that were reported but not consumed keep being reported. Set to 0 (the default) to report every read.
+ * @param reader LFRFIDReader to configure.
+ * @param cooldown_ms Cooldown per tag in milliseconds.
+ */
+void lfrfid_reader_set_cooldown(LFRFIDReader* reader, uint32_t cooldown_ms);
+
+/**
+ * @brief Checks whether a tag is still cooling down, e.g. before applying a report that was queued.
+ * @param reader LFRFIDReader that reported the tag.
+ * @param data Tag data as passed to the tag callback.
+ * @param length Tag data length.
+ * @return true if the tag was consumed less than the cooldown ago.
+ */
+bool lfrfid_reader_tag_cooling_down(LFRFIDReader* reader, const uint8_t* data, size_t length);
+
+/**
+ * @brief Starts the cooldown of a tag once the app has acted on it. Safe to call from any thread.
+ * @param reader LFRFIDReader that reported the tag.
+ * @param data Tag data as passed to the tag callback.
+ * @param length Tag data length.
+ */
+void lfrfid_reader_tag_consumed(LFRFIDReader* reader, const uint8_t* data, size_t length);
+
+/**
+ * @brief Starts the LFRFIDReader thread and the worker thread, parked with the antenna off.
  * @param reader LFRFIDReader to start.
  */
 void lfrfid_reader_start(LFRFIDReader* reader);
 
 /**
- * @brief Stops the LFRFIDReader.
+ * @brief Arms the ASK read so tags are reported to the callback.
+ * @details Returns once the worker reports the read as started. Pause and resume must not be called concurrently.
+ * @param reader LFRFIDReader to resume, must be started.
+ */
+void lfrfid_reader_resume(LFRFIDReader* reader);
+
+/**
+ * @brief Disarms the read and parks the reader thread.
+ * @details Returns once the worker was told to leave read mode, which it does on the next stop check of its read loop. The worker thread keeps running.
+ * @param reader LFRFIDReader to pause.
+ */
+void lfrfid_reader_pause(LFRFIDReader* reader);
+
+/**
+ * @brief Stops and frees the LFRFIDReader thread and stops the worker thread.
  * @param reader LFRFIDReader to stop.
  */
 void lfrfid_reader_stop(LFRFIDReader* reader);
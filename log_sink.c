@@ -0,0 +1,182 @@
+#include "log_sink.h"
+#include <furi.h>
+#include <storage/storage.h>
+
+#define TAG "LogSink"
+
+#define LOG_SINK_NONE       0xFF
+#define LOG_SINK_STACK_SIZE 1024
+
+typedef enum {
+    LogSinkEventStop = (1 << 0),
+    LogSinkEventFlush = (1 << 1),
+    LogSinkEventAll = (LogSinkEventStop | LogSinkEventFlush),
+} LogSinkEventType;
+
+struct LogSink {
+    Storage* storage;
+    File* file;
+    FuriThread* thread;
+    size_t record_size;
+
+    // Guarded by a critical section, which only ever covers a record copy.
+    uint8_t blocks[2][LOG_SINK_BLOCK_SIZE];
+    uint8_t active; // block producers append to
+    size_t fill; // bytes used in the active block
+    uint8_t full; // block waiting for the writer, LOG_SINK_NONE if none
+    size_t full_length;
+    LogSinkStats stats;
+    uint32_t stack_free; // set by the writer thread as it stops
+};
+
+// Runs on the writer thread.
+static void log_sink_write_block(LogSink* sink, uint8_t block, size_t length) {
+    uint32_t start = furi_get_tick();
+    bool written = storage_file_write(sink->file, sink->blocks[block], length) == length;
+    uint32_t ms = (furi_get_tick() - start) * 1000 / furi_kernel_get_tick_frequency();
+
+    FURI_CRITICAL_ENTER();
+    sink->stats.blocks++;
+    if(!written) {
+        sink->stats.write_errors++;
+    }
+    sink->stats.write_max_ms = MAX(sink->stats.write_max_ms, ms);
+    FURI_CRITICAL_EXIT();
+}
+
+// Runs on the writer thread. Writes the full block, if any.
+static void log_sink_write_full(LogSink* sink) {
+    uint8_t block;
+    size_t length;
+    FURI_CRITICAL_ENTER();
+    block = sink->full;
+    length = sink->full_length;
+    FURI_CRITICAL_EXIT();
+    if(block == LOG_SINK_NONE) {
+        return;
+    }
+
+    // Producers never touch the full block, so it is written without the lock.
+    log_sink_write_block(sink, block, length);
+
+    FURI_CRITICAL_ENTER();
+    sink->full = LOG_SINK_NONE;
+    FURI_CRITICAL_EXIT();
+}
+
+static int32_t log_sink_thread(void* context) {
+    LogSink* sink = context;
+
+    while(true) {
+        uint32_t flags =
+            furi_thread_flags_wait(LogSinkEventAll, FuriFlagWaitAny, FuriWaitForever);
+        if(flags & FuriFlagError) {
+            continue;
+        }
+        log_sink_write_full(sink);
+        if(flags & LogSinkEventStop) {
+            break;
+        }
+    }
+
+    // Producers are gone by now, the partly filled block goes out last.
+    log_sink_write_full(sink);
+    if(sink->fill) {
+        log_sink_write_block(sink, sink->active, sink->fill);
+    }
+    sink->stack_free = furi_thread_get_stack_space(furi_thread_get_current_id());
+    return 0;
+}
+
+LogSink* log_sink_alloc(const char* path, size_t record_size) {
+    furi_assert(path);
+    furi_assert(record_size && record_size <= LOG_SINK_BLOCK_SIZE);
+
+    LogSink* sink = malloc(sizeof(LogSink));
+    memset(sink, 0, sizeof(LogSink));
+    sink->record_size = record_size;
+    sink->full = LOG_SINK_NONE;
+    sink->storage = furi_record_open(RECORD_STORAGE);
+    sink->file = storage_file_alloc(sink->storage);
+
+    if(!storage_file_open(sink->file, path, FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
+        FURI_LOG_W(TAG, "Can't open %s, not logging", path);
+        storage_file_free(sink->file);
+        furi_record_close(RECORD_STORAGE);
+        free(sink);
+        return NULL;
+    }
+
+    sink->thread = furi_thread_alloc_ex("log_sink", LOG_SINK_STACK_SIZE, log_sink_thread, sink);
+    furi_thread_set_priority(sink->thread, FuriThreadPriorityLow);
+    furi_thread_start(sink->thread);
+    return sink;
+}
+
+void log_sink_free(LogSink* sink) {
+    furi_assert(sink);
+
+    furi_thread_flags_set(furi_thread_get_id(sink->thread), LogSinkEventStop);
+    furi_thread_join(sink->thread);
+    furi_thread_free(sink->thread);
+
+    storage_file_close(sink->file);
+    storage_file_free(sink->file);
+    furi_record_close(RECORD_STORAGE);
+
+    const LogSinkStats* stats = &sink->stats;
+    FURI_LOG_I(
+        TAG,
+        "%lu records logged, %lu dropped, %lu blocks, %lu write errors, slowest write %lu ms",
+        stats->appended,
+        stats->dropped,
+        stats->blocks,
+        stats->write_errors,
+        stats->write_max_ms);
+    FURI_LOG_I(
+        TAG,
+        "Writer thread stack: %lu of %d bytes never used",
+        sink->stack_free,
+        LOG_SINK_STACK_SIZE);
+    free(sink);
+}
+
+bool log_sink_append(LogSink* sink, const void* record) {
+    furi_assert(sink);
+    bool appended = true;
+    bool flush = false;
+
+    FURI_CRITICAL_ENTER();
+    if(sink->fill + sink->record_size > LOG_SINK_BLOCK_SIZE) {
+        if(sink->full == LOG_SINK_NONE) {
+            sink->full = sink->active;
+            sink->full_length = sink->fill;
+            sink->active ^= 1;
+            sink->fill = 0;
+            flush = true;
+        } else {
+            // The card hasn't finished the previous block yet.
+            appended = false;
+        }
+    }
+    if(appended) {
+        memcpy(&sink->blocks[sink->active][sink->fill], record, sink->record_size);
+        sink->fill += sink->record_size;
+        sink->stats.appended++;
+    } else {
+        sink->stats.dropped++;
+    }
+    FURI_CRITICAL_EXIT();
+
+    if(flush) {
+        furi_thread_flags_set(furi_thread_get_id(sink->thread), LogSinkEventFlush);
+    }
+    return appended;
+}
+
+void log_sink_get_stats(LogSink* sink, LogSinkStats* stats) {
+    furi_assert(sink);
+    FURI_CRITICAL_ENTER();
+    *stats = sink->stats;
+    FURI_CRITICAL_EXIT();
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Double-buffered log file on the SD card, for match logs, traces and IR
+ * captures. Producers append fixed-size records to an in-RAM block from any
+ * thread without ever waiting for the card. When the block is full it is
+ * handed to a low-priority writer thread, which writes it out in one
+ * sequential write while producers fill the other block. If the card is
+ * still busy with the previous block when the next one fills up, records are
+ * dropped and counted instead of stalling the game.
+ */
+
+#define LOG_SINK_BLOCK_SIZE 1024
+
+typedef struct LogSink LogSink;
+
+typedef struct {
+    uint32_t appended; // records accepted
+    uint32_t dropped; // records lost because both blocks were full
+    uint32_t blocks; // blocks written
+    uint32_t write_errors; // blocks the card didn't take
+    uint32_t write_max_ms; // slowest block write
+} LogSinkStats;
+
+/** Create (or truncate) the file at path. Returns NULL if it can't be opened, e.g. no SD card. */
+LogSink* log_sink_alloc(const char* path, size_t record_size);
+
+/** Write out what is still buffered, then close the file. Nothing may append anymore. */
+void log_sink_free(LogSink* sink);
+
+/** Append one record of the size given at alloc. Never blocks, returns false if it was dropped. */
+bool log_sink_append(LogSink* sink, const void* record);
+
+void log_sink_get_stats(LogSink* sink, LogSinkStats* stats);
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+/*
+ * Counters cheap enough to stay compiled in on release builds. Each counter
+ * has exactly one writer thread, so an update is a relaxed load and store
+ * (a few instructions, no exclusive-access retry loop), and any other thread
+ * can read it at any time without a lock.
+ */
+
+typedef atomic_uint PerfCounter;
+
+static inline uint32_t perf_counter_get(PerfCounter* counter) {
+    return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+/** Only call from the counter's writer thread. */
+static inline void perf_counter_inc(PerfCounter* counter) {
+    atomic_store_explicit(counter, perf_counter_get(counter) + 1, memory_order_relaxed);
+}
+
+/** Only call from the counter's writer thread. */
+static inline void perf_counter_max(PerfCounter* counter, uint32_t value) {
+    if(value > perf_counter_get(counter)) {
+        atomic_store_explicit(counter, value, memory_order_relaxed);
+    }
+}
+
+/** Only call from the counter's writer thread. */
+static inline void perf_counter_min(PerfCounter* counter, uint32_t value) {
+    if(value < perf_counter_get(counter)) {
+        atomic_store_explicit(counter, value, memory_order_relaxed);
+    }
+}
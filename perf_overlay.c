@@ -0,0 +1,116 @@
+#include "perf_overlay.h"
+#include "laser_tag_arena.h"
+#include <furi.h>
+#include <stdio.h>
+
+// The overlay only covers the bottom strip of the game view, which holds the
+// reload hint and the scan bar, so health, ammo and the clock stay visible.
+// The counters don't fit in two lines and are shown a page at a time.
+#define PERF_OVERLAY_TOP   45
+#define PERF_OVERLAY_PAGES 3
+
+struct PerfOverlay {
+    PerfSample previous;
+    uint32_t previous_tick;
+    PerfSample shown;
+    uint32_t loops_per_s;
+    uint32_t redraws_per_s;
+    uint32_t rx_per_s;
+    uint8_t page;
+};
+
+LASER_TAG_ARENA_CHECK(PerfOverlay, LASER_TAG_ARENA_PERF_OVERLAY_SIZE);
+
+PerfOverlay* perf_overlay_alloc(void) {
+    return laser_tag_arena_alloc(sizeof(PerfOverlay));
+}
+
+void perf_overlay_reset(PerfOverlay* overlay, const PerfSample* sample) {
+    furi_assert(overlay);
+    overlay->previous = *sample;
+    overlay->previous_tick = furi_get_tick();
+    overlay->shown = *sample;
+    overlay->loops_per_s = 0;
+    overlay->redraws_per_s = 0;
+    overlay->rx_per_s = 0;
+    overlay->page = 0;
+}
+
+static uint32_t perf_overlay_rate(uint32_t previous, uint32_t current, uint32_t ms) {
+    return ms ? (uint32_t)((uint64_t)(current - previous) * 1000 / ms) : 0;
+}
+
+void perf_overlay_update(PerfOverlay* overlay, const PerfSample* sample) {
+    furi_assert(overlay);
+    uint32_t now = furi_get_tick();
+    uint32_t ms = (uint32_t)((uint64_t)(now - overlay->previous_tick) * 1000 /
+                             furi_kernel_get_tick_frequency());
+
+    overlay->loops_per_s =
+        perf_overlay_rate(overlay->previous.loop_iterations, sample->loop_iterations, ms);
+    overlay->redraws_per_s = perf_overlay_rate(overlay->previous.redraws, sample->redraws, ms);
+    overlay->rx_per_s =
+        perf_overlay_rate(overlay->previous.rx_callbacks, sample->rx_callbacks, ms);
+    overlay->previous = *sample;
+    overlay->previous_tick = now;
+    overlay->shown = *sample;
+    overlay->page = (overlay->page + 1) % PERF_OVERLAY_PAGES;
+}
+
+// Runs on the GUI thread, the owner keeps updates out of the way of draws.
+void perf_overlay_draw(PerfOverlay* overlay, Canvas* canvas) {
+    furi_assert(overlay);
+    const PerfSample* s = &overlay->shown;
+    char first[32];
+    char second[32];
+
+    switch(overlay->page) {
+    case 0:
+        snprintf(
+            first, sizeof(first), "loop %lu/s max %lu us", overlay->loops_per_s, s->loop_max_us);
+        snprintf(
+            second,
+            sizeof(second),
+            "draw %lu/s queue %lu/%lu",
+            overlay->redraws_per_s,
+            s->queue_depth,
+            s->queue_size);
+        break;
+    case 1:
+        snprintf(
+            first,
+            sizeof(first),
+            "rx %lu/s lost events %lu",
+            overlay->rx_per_s,
+            s->queue_overflows);
+        snprintf(
+            second,
+            sizeof(second),
+            "dec %lu hit %lu drop %lu",
+            s->rx_decoded,
+            s->rx_accepted,
+            s->rx_dropped);
+        break;
+    default:
+        snprintf(first, sizeof(first), "heap %lu free", s->free_heap);
+        if(s->rx_stack_free == UINT32_MAX) {
+            snprintf(second, sizeof(second), "stack main %lu rx -", s->main_stack_free);
+        } else {
+            snprintf(
+                second,
+                sizeof(second),
+                "stack main %lu rx %lu",
+                s->main_stack_free,
+                s->rx_stack_free);
+        }
+        break;
+    }
+
+    canvas_set_color(canvas, ColorWhite);
+    canvas_draw_box(canvas, 0, PERF_OVERLAY_TOP, 128, 64 - PERF_OVERLAY_TOP);
+    canvas_set_color(canvas, ColorBlack);
+    canvas_draw_frame(canvas, 0, PERF_OVERLAY_TOP, 128, 64 - PERF_OVERLAY_TOP);
+    canvas_set_font(canvas, FontSecondary);
+    canvas_draw_str(canvas, 2, PERF_OVERLAY_TOP + 9, first);
+    canvas_draw_str(canvas, 2, PERF_OVERLAY_TOP + 17, second);
+}
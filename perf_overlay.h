@@ -0,0 +1,38 @@
+#pragma once
+
+#include <gui/canvas.h>
+#include <stdint.h>
+
+/*
+ * Hidden debug overlay with live counters, drawn in a strip at the bottom of
+ * the game view. The owner samples the counters about once a second, the
+ * overlay turns the totals into per-second rates and draws the last sample,
+ * two lines at a time, turning the page with every sample.
+ */
+
+typedef struct PerfOverlay PerfOverlay;
+
+typedef struct {
+    uint32_t loop_iterations; // total
+    uint32_t loop_max_us; // since the previous sample
+    uint32_t redraws; // total
+    uint32_t rx_callbacks; // total
+    uint32_t rx_decoded; // total
+    uint32_t rx_accepted; // total
+    uint32_t rx_dropped; // total
+    uint32_t queue_depth;
+    uint32_t queue_size;
+    uint32_t queue_overflows; // total
+    uint32_t free_heap;
+    uint32_t main_stack_free; // lowest seen
+    uint32_t rx_stack_free; // lowest seen, UINT32_MAX if RX never ran
+} PerfSample;
+
+PerfOverlay* perf_overlay_alloc(void);
+
+/** Start over, so the next rates don't include the time the overlay was hidden. */
+void perf_overlay_reset(PerfOverlay* overlay, const PerfSample* sample);
+
+void perf_overlay_update(PerfOverlay* overlay, const PerfSample* sample);
+
+void perf_overlay_draw(PerfOverlay* overlay, Canvas* canvas);
@@ -0,0 +1,261 @@
+#include "radio_scheduler.h"
+#include "laser_tag_arena.h"
+#include <furi.h>
+#include <furi_hal.h>
+
+#define TAG "RadioScheduler"
+
+typedef enum {
+    RadioSchedulerEventStop = (1 << 0),
+    RadioSchedulerEventUpdate = (1 << 1),
+    RadioSchedulerEventAll = (RadioSchedulerEventStop | RadioSchedulerEventUpdate),
+} RadioSchedulerEventType;
+
+typedef enum {
+    RadioSlotOff,
+    RadioSlotIr,
+    RadioSlotRfid,
+} RadioSlot;
+
+struct RadioScheduler {
+    InfraredController* ir;
+    LFRFIDReader* reader;
+    FuriThread* thread;
+    FuriMutex* mutex;
+
+    uint32_t period_ticks;
+    uint32_t rfid_ticks;
+    bool running;
+    bool hold_rfid;
+
+    RadioSlot slot;
+    uint32_t slot_started;
+
+    RadioSchedulerStats stats;
+};
+
+LASER_TAG_ARENA_CHECK(struct RadioScheduler, LASER_TAG_ARENA_RADIO_SCHEDULER_SIZE);
+
+static uint32_t radio_scheduler_cycles_to_us(uint32_t cycles) {
+    return cycles / furi_hal_cortex_instructions_per_microsecond();
+}
+
+// Must be called with the mutex held. The radio going off is stopped before
+// the other one starts, and the measured cost covers the whole hand-over. IR
+// and the RFID read start return once the hardware followed, the RFID read
+// stop once the worker was told (see lfrfid_reader_pause).
+static void radio_scheduler_switch(RadioScheduler* scheduler, RadioSlot slot) {
+    if(slot == scheduler->slot) {
+        return;
+    }
+
+    uint32_t start = DWT->CYCCNT;
+    uint32_t now = furi_get_tick();
+
+    if(scheduler->slot == RadioSlotRfid) {
+        lfrfid_reader_pause(scheduler->reader);
+        uint32_t blind = now - scheduler->slot_started;
+        scheduler->stats.ir_blind_ms += blind;
+        scheduler->stats.ir_blind_max_ms = MAX(scheduler->stats.ir_blind_max_ms, blind);
+    } else if(scheduler->slot == RadioSlotIr) {
+        infrared_controller_pause(scheduler->ir);
+    }
+
+    if(slot == RadioSlotRfid) {
+        lfrfid_reader_resume(scheduler->reader);
+        scheduler->stats.rfid_slots++;
+    } else if(slot == RadioSlotIr) {
+        infrared_controller_resume(scheduler->ir);
+    }
+
+    scheduler->slot = slot;
+    scheduler->slot_started = now;
+
+    uint32_t elapsed_us = radio_scheduler_cycles_to_us(DWT->CYCCNT - start);
+    scheduler->stats.switch_count++;
+    scheduler->stats.switch_total_us += elapsed_us;
+    scheduler->stats.switch_max_us = MAX(scheduler->stats.switch_max_us, elapsed_us);
+}
+
+// Picks the slot the radios should be in and returns how long until that
+// changes. Must be called with the mutex held.
+static uint32_t radio_scheduler_step(RadioScheduler* scheduler) {
+    if(scheduler->hold_rfid) {
+        radio_scheduler_switch(scheduler, RadioSlotRfid);
+        return FuriWaitForever;
+    }
+
+    if(!scheduler->running) {
+        radio_scheduler_switch(scheduler, RadioSlotOff);
+        return FuriWaitForever;
+    }
+
+    uint32_t elapsed = furi_get_tick() - scheduler->slot_started;
+    if(scheduler->slot == RadioSlotRfid) {
+        if(elapsed < scheduler->rfid_ticks) {
+            return scheduler->rfid_ticks - elapsed;
+        }
+        radio_scheduler_switch(scheduler, RadioSlotIr);
+        return scheduler->period_ticks - scheduler->rfid_ticks;
+    }
+
+    uint32_t ir_ticks = scheduler->period_ticks - scheduler->rfid_ticks;
+    if(scheduler->slot == RadioSlotIr && elapsed < ir_ticks) {
+        return ir_ticks - elapsed;
+    }
+    if(scheduler->slot == RadioSlotOff || !scheduler->rfid_ticks) {
+        radio_scheduler_switch(scheduler, RadioSlotIr);
+        return scheduler->rfid_ticks ? ir_ticks : FuriWaitForever;
+    }
+    radio_scheduler_switch(scheduler, RadioSlotRfid);
+    return scheduler->rfid_ticks;
+}
+
+static int32_t radio_scheduler_thread(void* context) {
+    RadioScheduler* scheduler = context;
+    uint32_t timeout = FuriWaitForever;
+
+    while(true) {
+        uint32_t flags = furi_thread_flags_wait(RadioSchedulerEventAll, FuriFlagWaitAny, timeout);
+        if(!(flags & FuriFlagError) && (flags & RadioSchedulerEventStop)) {
+            break;
+        }
+
+        furi_mutex_acquire(scheduler->mutex, FuriWaitForever);
+        timeout = radio_scheduler_step(scheduler);
+        furi_mutex_release(scheduler->mutex);
+    }
+
+    furi_mutex_acquire(scheduler->mutex, FuriWaitForever);
+    radio_scheduler_switch(scheduler, RadioSlotOff);
+    furi_mutex_release(scheduler->mutex);
+    return 0;
+}
+
+static void radio_scheduler_update(RadioScheduler* scheduler) {
+    furi_thread_flags_set(furi_thread_get_id(scheduler->thread), RadioSchedulerEventUpdate);
+}
+
+RadioScheduler* radio_scheduler_alloc(InfraredController* ir, LFRFIDReader* reader) {
+    furi_assert(ir);
+    furi_assert(reader);
+
+    RadioScheduler* scheduler = laser_tag_arena_alloc(sizeof(RadioScheduler));
+    memset(scheduler, 0, sizeof(RadioScheduler));
+    scheduler->ir = ir;
+    scheduler->reader = reader;
+    scheduler->slot = RadioSlotOff;
+    scheduler->mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    radio_scheduler_set_duty_cycle(
+        scheduler, RADIO_SCHEDULER_DEFAULT_PERIOD_MS, RADIO_SCHEDULER_DEFAULT_RFID_PERCENT);
+
+    // Both radios start off, the RFID reader thread parked.
+    infrared_controller_pause(ir);
+    lfrfid_reader_start(reader);
+
+    scheduler->thread =
+        furi_thread_alloc_ex("radio_scheduler", 1024, radio_scheduler_thread, scheduler);
+    furi_thread_start(scheduler->thread);
+
+    return scheduler;
+}
+
+void radio_scheduler_free(RadioScheduler* scheduler) {
+    furi_assert(scheduler);
+
+    furi_thread_flags_set(furi_thread_get_id(scheduler->thread), RadioSchedulerEventStop);
+    furi_thread_join(scheduler->thread);
+    furi_thread_free(scheduler->thread);
+
+    FURI_LOG_I(
+        TAG,
+        "RFID slots: %lu, IR blind: %lu ms (max %lu ms), switches: %lu (max %lu us, total %lu us)",
+        scheduler->stats.rfid_slots,
+        scheduler->stats.ir_blind_ms,
+        scheduler->stats.ir_blind_max_ms,
+        scheduler->stats.switch_count,
+        scheduler->stats.switch_max_us,
+        scheduler->stats.switch_total_us);
+
+    lfrfid_reader_free(scheduler->reader);
+    infrared_controller_free(scheduler->ir);
+    furi_mutex_free(scheduler->mutex);
+}
+
+InfraredController* radio_scheduler_get_ir_controller(RadioScheduler* scheduler) {
+    furi_assert(scheduler);
+    return scheduler->ir;
+}
+
+LFRFIDReader* radio_scheduler_get_rfid_reader(RadioScheduler* scheduler) {
+    furi_assert(scheduler);
+    return scheduler->reader;
+}
+
+void radio_scheduler_set_duty_cycle(
+    RadioScheduler* scheduler,
+    uint32_t period_ms,
+    uint8_t rfid_percent) {
+    furi_assert(scheduler);
+    furi_check(period_ms > 0 && rfid_percent < 100);
+
+    furi_mutex_acquire(scheduler->mutex, FuriWaitForever);
+    scheduler->period_ticks = furi_ms_to_ticks(period_ms);
+    scheduler->rfid_ticks = (scheduler->period_ticks * rfid_percent) / 100;
+    furi_mutex_release(scheduler->mutex);
+
+    if(scheduler->thread) {
+        radio_scheduler_update(scheduler);
+    }
+}
+
+void radio_scheduler_start(RadioScheduler* scheduler) {
+    furi_assert(scheduler);
+    furi_mutex_acquire(scheduler->mutex, FuriWaitForever);
+    scheduler->running = true;
+    furi_mutex_release(scheduler->mutex);
+    radio_scheduler_update(scheduler);
+}
+
+void radio_scheduler_stop(RadioScheduler* scheduler) {
+    furi_assert(scheduler);
+    furi_mutex_acquire(scheduler->mutex, FuriWaitForever);
+    scheduler->running = false;
+    // Switch here rather than on the scheduler thread, so that IR RX is off
+    // and its worker joined by the time this returns.
+    radio_scheduler_step(scheduler);
+    furi_mutex_release(scheduler->mutex);
+    radio_scheduler_update(scheduler);
+}
+
+void radio_scheduler_hold_rfid(RadioScheduler* scheduler, bool hold) {
+    furi_assert(scheduler);
+    furi_mutex_acquire(scheduler->mutex, FuriWaitForever);
+    scheduler->hold_rfid = hold;
+    if(!hold && scheduler->running) {
+        // Give IR a full slot after a long RFID hold.
+        radio_scheduler_switch(scheduler, RadioSlotIr);
+    }
+    furi_mutex_release(scheduler->mutex);
+    radio_scheduler_update(scheduler);
+}
+
+void radio_scheduler_send(RadioScheduler* scheduler) {
+    furi_assert(scheduler);
+    furi_mutex_acquire(scheduler->mutex, FuriWaitForever);
+    // Firing cuts an RFID slot short, shots always win.
+    if(scheduler->slot == RadioSlotRfid) {
+        radio_scheduler_switch(scheduler, RadioSlotIr);
+    }
+    infrared_controller_send(scheduler->ir);
+    furi_mutex_release(scheduler->mutex);
+    radio_scheduler_update(scheduler);
+}
+
+void radio_scheduler_get_stats(RadioScheduler* scheduler, RadioSchedulerStats* stats) {
+    furi_assert(scheduler);
+    furi_assert(stats);
+    furi_mutex_acquire(scheduler->mutex, FuriWaitForever);
+    *stats = scheduler->stats;
+    furi_mutex_release(scheduler->mutex);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "infrared_controller.h"
+#include "lfrfid_reader.h"
+
+/*
+ * IR RX and the 125 kHz RFID reader can't be active at the same time. The
+ * radio scheduler owns both and time-slices them: each period starts with a
+ * short RFID slot, and the rest of the period is spent listening for IR. Tags
+ * are picked up passively while IR blind time stays bounded by the duty cycle.
+ */
+
+#define RADIO_SCHEDULER_DEFAULT_PERIOD_MS    2500
+#define RADIO_SCHEDULER_DEFAULT_RFID_PERCENT 10
+
+typedef struct RadioScheduler RadioScheduler;
+
+typedef struct {
+    uint32_t rfid_slots; // RFID slots run, including held ones
+    uint32_t ir_blind_ms; // total time IR RX was off for RFID
+    uint32_t ir_blind_max_ms; // longest single stretch IR RX was off
+    uint32_t switch_count; // radio hand-overs
+    uint32_t switch_max_us; // slowest hand-over
+    uint32_t switch_total_us; // sum of all hand-overs
+} RadioSchedulerStats;
+
+/** Takes ownership of both radios, they are freed with the scheduler. */
+RadioScheduler* radio_scheduler_alloc(InfraredController* ir, LFRFIDReader* reader);
+void radio_scheduler_free(RadioScheduler* scheduler);
+
+InfraredController* radio_scheduler_get_ir_controller(RadioScheduler* scheduler);
+LFRFIDReader* radio_scheduler_get_rfid_reader(RadioScheduler* scheduler);
+
+void radio_scheduler_set_duty_cycle(
+    RadioScheduler* scheduler,
+    uint32_t period_ms,
+    uint8_t rfid_percent);
+
+/** Start time-slicing IR and RFID. */
+void radio_scheduler_start(RadioScheduler* scheduler);
+/**
+ * Stop time-slicing. IR RX is off when this returns and no RX callback is
+ * running anymore. RFID stays on only while held.
+ */
+void radio_scheduler_stop(RadioScheduler* scheduler);
+
+/** Keep the RFID reader on (and IR RX off) until released, e.g. for a manual scan. */
+void radio_scheduler_hold_rfid(RadioScheduler* scheduler, bool hold);
+
+/** Transmit a shot, taking the radios back from RFID if needed. */
+void radio_scheduler_send(RadioScheduler* scheduler);
+
+void radio_scheduler_get_stats(RadioScheduler* scheduler, RadioSchedulerStats* stats);
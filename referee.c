@@ -0,0 +1,117 @@
+#include "referee.h"
+#include "laser_tag_arena.h"
+#include "log_sink.h"
+#include "perf_counter.h"
+#include <furi.h>
+#include <storage/storage.h>
+
+#define TAG "Referee"
+
+#define REFEREE_LOG_PATH APP_DATA_PATH("referee.log")
+
+// One record per shot heard.
+typedef struct {
+    uint32_t tick;
+    uint8_t team;
+    uint8_t shooter; // 0xFF in open play
+    uint16_t reserved;
+} RefereeLogRecord;
+
+// The counters are written by the IR worker thread only, and read by the GUI
+// thread for the scoreboard.
+struct Referee {
+    LogSink* log;
+    PerfCounter team_shots[2];
+    PerfCounter player_shots[REFEREE_MAX_PLAYERS];
+    atomic_uchar player_team[REFEREE_MAX_PLAYERS];
+};
+
+LASER_TAG_ARENA_CHECK(Referee, LASER_TAG_ARENA_REFEREE_SIZE);
+
+Referee* referee_alloc(void) {
+    return laser_tag_arena_alloc(sizeof(Referee));
+}
+
+void referee_free(Referee* referee) {
+    furi_assert(referee);
+    referee_stop(referee);
+}
+
+void referee_start(Referee* referee) {
+    furi_assert(referee);
+    referee_stop(referee);
+
+    for(size_t i = 0; i < COUNT_OF(referee->team_shots); i++) {
+        atomic_store(&referee->team_shots[i], 0);
+    }
+    for(size_t i = 0; i < REFEREE_MAX_PLAYERS; i++) {
+        atomic_store(&referee->player_shots[i], 0);
+    }
+    referee->log = log_sink_alloc(REFEREE_LOG_PATH, sizeof(RefereeLogRecord));
+    FURI_LOG_I(TAG, "Referee mode on");
+}
+
+void referee_stop(Referee* referee) {
+    furi_assert(referee);
+    if(referee->log) {
+        FURI_LOG_I(
+            TAG,
+            "Referee mode off, Red %lu shots, Blue %lu shots",
+            referee_get_team_shots(referee, TeamRed),
+            referee_get_team_shots(referee, TeamBlue));
+        log_sink_free(referee->log);
+        referee->log = NULL;
+    }
+}
+
+void referee_record_shot(Referee* referee, LaserTagTeam team, uint32_t shooter) {
+    perf_counter_inc(&referee->team_shots[team == TeamBlue]);
+    if(shooter < REFEREE_MAX_PLAYERS) {
+        atomic_store_explicit(&referee->player_team[shooter], team, memory_order_relaxed);
+        perf_counter_inc(&referee->player_shots[shooter]);
+    }
+
+    if(referee->log) {
+        RefereeLogRecord record = {
+            .tick = furi_get_tick(),
+            .team = team,
+            .shooter = (shooter < REFEREE_MAX_PLAYERS) ? shooter : 0xFF,
+        };
+        log_sink_append(referee->log, &record);
+    }
+}
+
+uint32_t referee_get_team_shots(Referee* referee, LaserTagTeam team) {
+    furi_assert(referee);
+    return perf_counter_get(&referee->team_shots[team == TeamBlue]);
+}
+
+size_t referee_get_top_players(Referee* referee, RefereePlayer* players, size_t count) {
+    furi_assert(referee);
+    size_t found = 0;
+
+    // Insertion into a short sorted list, the table is only scanned once.
+    for(size_t id = 0; id < REFEREE_MAX_PLAYERS; id++) {
+        uint32_t shots = perf_counter_get(&referee->player_shots[id]);
+        if(!shots) {
+            continue;
+        }
+
+        size_t i = MIN(found, count);
+        while(i > 0 && players[i - 1].shots < shots) {
+            if(i < count) {
+                players[i] = players[i - 1];
+            }
+            i--;
+        }
+        if(i < count) {
+            players[i] = (RefereePlayer){
+                .id = id,
+                .team = atomic_load_explicit(&referee->player_team[id], memory_order_relaxed),
+                .shots = shots,
+            };
+            found = MIN(found + 1, count);
+        }
+    }
+    return found;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "game_state.h"
+
+/*
+ * Referee mode: a Flipper that never fires and never takes damage, it only
+ * listens and keeps score of every shot it hears, from both teams.
+ *
+ * Shots are recorded from the IR worker thread into fixed tables, one slot
+ * per shooter id, and appended to referee.log on the SD card through a log
+ * sink. Neither allocates or blocks, so back-to-back frames are all counted.
+ * Shooters can only be told apart in tournament mode, open play shots only
+ * count for their team.
+ */
+
+#define REFEREE_MAX_PLAYERS 128 // shooter ids, see shot_auth.h
+#define REFEREE_NO_SHOOTER  UINT32_MAX
+
+typedef struct Referee Referee;
+
+typedef struct {
+    uint8_t id;
+    LaserTagTeam team;
+    uint32_t shots;
+} RefereePlayer;
+
+Referee* referee_alloc(void);
+void referee_free(Referee* referee);
+
+/** Clear the tally and start logging. */
+void referee_start(Referee* referee);
+/** Stop logging. Shots must not be recorded anymore. */
+void referee_stop(Referee* referee);
+
+/** Called from the IR worker thread. shooter is REFEREE_NO_SHOOTER in open play. */
+void referee_record_shot(Referee* referee, LaserTagTeam team, uint32_t shooter);
+
+uint32_t referee_get_team_shots(Referee* referee, LaserTagTeam team);
+
+/** Fill players with the most active shooters, most shots first. @returns how many. */
+size_t referee_get_top_players(Referee* referee, RefereePlayer* players, size_t count);
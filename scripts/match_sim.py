@@ -0,0 +1,405 @@
+#!/usr/bin/env python3
+"""
+Simulate thousands of seeded matches and report aggregate game stats:
+time-to-kill, ammo starvation and hits lost on the receiving end.
+
+Each match has N players split into two teams who move around a field, fire
+at the nearest enemy at a scripted rate and now and then walk to an RFID
+station to scan an ammo tag.
+
+The game itself is the app's: every player is a GameState from game_state.c
+and every shot is encoded and decoded by shot_protocol.c, optionally with
+bit errors on the air. Both are built for the host with the rest of the app
+into tests/host/build/sim/libmatchsim.so (make -C tests/host sim, run on
+every start) and loaded with ctypes, see tests/host/match_sim.c. The
+constants are read from the same build. What is left here is the timing
+around the game, after the app:
+
+- a hit blocks the victim's IR RX while the hit feedback plays, and shots
+  that arrive in the meantime are dropped (infrared_rx_callback);
+- the victim can't fire during that time either (laser_tag_app_fire);
+- IR RX is off during the RFID slot at the start of every radio scheduler
+  period, and during a manual tag scan (radio_scheduler.h);
+- frames that overlap in the air at the same receiver are both lost, so the
+  shot protocol's air time matters, and tournament mode's longer frames
+  (--tournament) do too;
+- reloading is Down on an empty gun, and a tag that was just used is cooling
+  down and doesn't scan.
+
+Matches are independent and are handed out one at a time to a process per
+core, so idle workers keep taking the next match until none are left.
+Every match draws from its own generator, seeded from the run seed and the
+match number, and results are aggregated in match order. The same seed
+therefore gives the same report on any machine and with any number of jobs,
+so a regression can be bisected:
+
+    python3 scripts/match_sim.py --matches 2000 --players 8 --seed 42
+"""
+
+import argparse
+import ctypes
+import math
+import multiprocessing
+import os
+import random
+import subprocess
+
+HOST_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "tests", "host")
+LIBRARY = os.path.join(HOST_DIR, "build", "sim", "libmatchsim.so")
+
+# Functions of the library, as (result, arguments).
+SIGNATURES = {
+    "match_sim_begin": (None, []),
+    "match_sim_constant": (ctypes.c_bool, [ctypes.c_char_p, ctypes.POINTER(ctypes.c_uint32)]),
+    "match_sim_protocol": (ctypes.c_bool, [ctypes.c_size_t, ctypes.POINTER(ctypes.c_int)]),
+    "match_sim_protocol_name": (ctypes.c_char_p, [ctypes.c_int]),
+    "match_sim_protocol_air_time_ms": (ctypes.c_uint8, [ctypes.c_int, ctypes.c_bool]),
+    "match_sim_protocol_frame_bits": (ctypes.c_uint8, [ctypes.c_int]),
+    "match_sim_shot": (
+        ctypes.c_bool,
+        [ctypes.c_int, ctypes.c_int, ctypes.c_uint32, ctypes.POINTER(ctypes.c_int)],
+    ),
+    "match_sim_scan_tag": (ctypes.c_bool, [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_size_t]),
+    "shot_protocol_get_data_bits": (ctypes.c_uint8, [ctypes.c_int]),
+    "host_clock_set": (None, [ctypes.c_uint32]),
+    "game_state_alloc": (ctypes.c_void_p, []),
+    "game_state_set_team": (None, [ctypes.c_void_p, ctypes.c_int]),
+    "game_state_decrease_health": (None, [ctypes.c_void_p, ctypes.c_uint8]),
+    "game_state_decrease_ammo": (None, [ctypes.c_void_p, ctypes.c_uint16]),
+    "game_state_increase_ammo": (None, [ctypes.c_void_p, ctypes.c_uint16]),
+    "game_state_get_ammo": (ctypes.c_uint16, [ctypes.c_void_p]),
+    "game_state_get_max_ammo": (ctypes.c_uint16, [ctypes.c_void_p]),
+    "game_state_is_game_over": (ctypes.c_bool, [ctypes.c_void_p]),
+    "game_state_get_time_ms": (ctypes.c_uint32, [ctypes.c_void_p]),
+}
+
+STEP_MS = 100
+FIELD_M = 25.0
+HISTOGRAM_BUCKETS = 12
+HISTOGRAM_WIDTH = 40
+
+
+class App:
+    """The library, its constants and shot protocols."""
+
+    def __init__(self):
+        self.lib = ctypes.CDLL(LIBRARY)
+        for name, (result, arguments) in SIGNATURES.items():
+            function = getattr(self.lib, name)
+            function.restype = result
+            function.argtypes = arguments
+
+        for name in (
+            "MATCH_SIM_MAX_PLAYERS",
+            "LASER_TAG_HIT_DAMAGE",
+            "LASER_TAG_SCAN_TIMEOUT_MS",
+            "LASER_TAG_TAG_COOLDOWN_MS",
+            "RADIO_SCHEDULER_DEFAULT_PERIOD_MS",
+            "RADIO_SCHEDULER_DEFAULT_RFID_PERCENT",
+            "SHOT_AUTH_DATA_BITS",
+            "HIT_FEEDBACK_MS",
+            "TeamRed",
+            "TeamBlue",
+        ):
+            setattr(self, name, self.constant(name))
+        # The universal ammo refill tag in the README.
+        self.ammo_tag = bytes(
+            self.constant(name)
+            for name in ("TAG_MAGIC_0", "TAG_MAGIC_1", "TAG_TEAM_ANY", "TagOpcodeAmmo")
+        ) + bytes([0x0A])
+
+        self.protocols = {}
+        protocol = ctypes.c_int()
+        while self.lib.match_sim_protocol(len(self.protocols), ctypes.byref(protocol)):
+            name = self.lib.match_sim_protocol_name(protocol.value).decode()
+            self.protocols[name] = protocol.value
+
+    def constant(self, name):
+        value = ctypes.c_uint32()
+        if not self.lib.match_sim_constant(name.encode(), ctypes.byref(value)):
+            raise KeyError(f"{name} is not exported by tests/host/match_sim.c")
+        return value.value
+
+
+APP = None
+
+
+def app():
+    # Loaded once per worker process.
+    global APP
+    if APP is None:
+        APP = App()
+    return APP
+
+
+class Player:
+    def __init__(self, index, rng, app):
+        self.index = index
+        self.team = app.TeamBlue if index % 2 else app.TeamRed
+        self.state = app.lib.game_state_alloc()
+        app.lib.game_state_set_team(self.state, self.team)
+        self.x = rng.uniform(0, FIELD_M)
+        self.y = rng.uniform(0, FIELD_M)
+        self.heading = rng.uniform(0, 2 * math.pi)
+        self.busy_until = 0  # hit feedback, RX off and can't fire
+        self.scan_until = 0  # manual tag scan, RX off and can't fire
+        self.tag_ready_at = 0  # the station's tag is cooling down until then
+        self.reload_at = None
+        self.radio_phase = rng.randrange(app.RADIO_SCHEDULER_DEFAULT_PERIOD_MS)
+        self.last_frame_end = -1
+        self.death_ms = None
+        self.starved_ms = 0
+
+    @property
+    def alive(self):
+        return self.death_ms is None
+
+    def rx_blind(self, now, app):
+        period = app.RADIO_SCHEDULER_DEFAULT_PERIOD_MS
+        rfid_ms = period * app.RADIO_SCHEDULER_DEFAULT_RFID_PERCENT // 100
+        return now < self.scan_until or (now + self.radio_phase) % period < rfid_ms
+
+    def take_hit(self, now, app):
+        app.lib.host_clock_set(int(now))
+        app.lib.game_state_decrease_health(self.state, app.LASER_TAG_HIT_DAMAGE)
+        self.busy_until = now + app.HIT_FEEDBACK_MS
+        if app.lib.game_state_is_game_over(self.state):
+            # The match clock stops at game over.
+            self.death_ms = app.lib.game_state_get_time_ms(self.state)
+
+
+def move(player, rng, args):
+    player.heading += rng.gauss(0, 0.6)
+    step = args.speed * STEP_MS / 1000
+    player.x = min(max(player.x + step * math.cos(player.heading), 0), FIELD_M)
+    player.y = min(max(player.y + step * math.sin(player.heading), 0), FIELD_M)
+
+
+def hit_probability(shooter, target, args):
+    distance = math.hypot(shooter.x - target.x, shooter.y - target.y)
+    if distance >= args.range:
+        return 0.0
+    # Moving targets are harder to hit, more so further away.
+    return args.accuracy * (1 - distance / args.range) / (1 + args.speed / 4)
+
+
+def error_mask(rng, bits, rate):
+    if not rate:
+        return 0
+    return sum(1 << bit for bit in range(bits) if rng.random() < rate)
+
+
+def run_match(task):
+    index, args = task
+    sim = app()
+    lib = sim.lib
+    rng = random.Random(f"{args.seed}:{index}")
+    lib.match_sim_begin()
+    players = [Player(i, rng, sim) for i in range(args.players)]
+    protocol = sim.protocols[args.protocol]
+    air_ms = lib.match_sim_protocol_air_time_ms(protocol, args.tournament)
+    frame_bits = lib.match_sim_protocol_frame_bits(protocol)
+    received = ctypes.c_int()
+    stats = {
+        "shots": 0,
+        "hits": 0,
+        "busy": 0,
+        "blind": 0,
+        "collided": 0,
+        "corrupted": 0,
+        "misread": 0,
+    }
+
+    now = 0
+    while now < args.match_s * 1000:
+        teams_alive = {p.team for p in players if p.alive}
+        if len(teams_alive) < 2:
+            break
+        lib.host_clock_set(now)
+
+        frames = []
+        for player in players:
+            if not player.alive:
+                continue
+            move(player, rng, args)
+
+            if lib.game_state_get_ammo(player.state) == 0:
+                player.starved_ms += STEP_MS
+                if player.reload_at is None:
+                    player.reload_at = now + rng.expovariate(1 / args.reload_ms)
+                if now >= player.reload_at:
+                    lib.game_state_increase_ammo(
+                        player.state, lib.game_state_get_max_ammo(player.state)
+                    )
+                    player.reload_at = None
+                continue
+
+            if now >= player.scan_until and rng.random() < args.station_rate * STEP_MS / 60000:
+                if now >= player.tag_ready_at and lib.match_sim_scan_tag(
+                    player.state, sim.ammo_tag, len(sim.ammo_tag)
+                ):
+                    player.scan_until = now + rng.uniform(1000, sim.LASER_TAG_SCAN_TIMEOUT_MS)
+                    player.tag_ready_at = now + sim.LASER_TAG_TAG_COOLDOWN_MS
+                else:
+                    player.scan_until = now + sim.LASER_TAG_SCAN_TIMEOUT_MS
+                continue
+
+            if now < player.busy_until or now < player.scan_until:
+                continue
+            if rng.random() >= args.fire_rate * STEP_MS / 1000:
+                continue
+
+            lib.game_state_decrease_ammo(player.state, 1)
+            stats["shots"] += 1
+            enemies = [p for p in players if p.alive and p.team != player.team]
+            target = min(enemies, key=lambda p: math.hypot(player.x - p.x, player.y - p.y))
+            if rng.random() < hit_probability(player, target, args):
+                frames.append((now + rng.uniform(0, STEP_MS), player, target))
+
+        # Frames that overlap at the same receiver are both lost.
+        frames.sort(key=lambda frame: (frame[0], frame[2].index, frame[1].index))
+        collided = set()
+        last_at = {}
+        for i, (start, _, target) in enumerate(frames):
+            previous = last_at.get(target.index)
+            if previous is not None and start < frames[previous][0] + air_ms:
+                collided.update((previous, i))
+            elif start < target.last_frame_end:
+                collided.add(i)
+            last_at[target.index] = i
+
+        for i, (start, shooter, target) in enumerate(frames):
+            end = start + air_ms
+            target.last_frame_end = max(target.last_frame_end, end)
+            if not target.alive:
+                continue
+            if i in collided:
+                stats["collided"] += 1
+            elif target.rx_blind(end, sim):
+                stats["blind"] += 1
+            elif end < target.busy_until:
+                stats["busy"] += 1
+            elif (mask := error_mask(rng, frame_bits, args.bit_error_rate)) and args.no_correction:
+                stats["corrupted"] += 1
+            elif not lib.match_sim_shot(protocol, shooter.team, mask, ctypes.byref(received)):
+                stats["corrupted"] += 1
+            elif received.value == target.team:
+                # Friendly fire is ignored, see infrared_controller_is_hit.
+                stats["misread"] += 1
+            else:
+                stats["hits"] += 1
+                target.take_hit(end, sim)
+
+        now += STEP_MS
+
+    return {
+        "index": index,
+        "duration_ms": now,
+        "ttk_ms": [p.death_ms for p in players if p.death_ms is not None],
+        "starved_ms": sum(p.starved_ms for p in players),
+        "player_ms": sum((p.death_ms if p.death_ms is not None else now) for p in players),
+        **stats,
+    }
+
+
+def histogram(name, values, unit):
+    if not values:
+        print(f"{name}: no samples")
+        return
+    values = sorted(values)
+    count = len(values)
+    print(f"{name}: {count} samples")
+    print(
+        f"  min {values[0]:.1f} {unit}, median {values[count // 2]:.1f} {unit}, "
+        f"p95 {values[min(count - 1, count * 95 // 100)]:.1f} {unit}, max {values[-1]:.1f} {unit}"
+    )
+    low = values[0]
+    width = max((values[-1] - low) / HISTOGRAM_BUCKETS, 1e-9)
+    buckets = [0] * HISTOGRAM_BUCKETS
+    for value in values:
+        buckets[min(int((value - low) / width), HISTOGRAM_BUCKETS - 1)] += 1
+    peak = max(buckets)
+    for i, bucket in enumerate(buckets):
+        bar = "#" * (bucket * HISTOGRAM_WIDTH // peak)
+        print(f"  {low + i * width:>8.1f} {unit} |{bar:<{HISTOGRAM_WIDTH}}| {bucket}")
+    print()
+
+
+def main():
+    # Rebuilt on every run, so the simulator always plays the current rules.
+    subprocess.run(["make", "-s", "-C", HOST_DIR, "sim"], check=True)
+    sim = app()
+
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--matches", type=int, default=1000)
+    parser.add_argument("--players", type=int, default=8)
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--jobs", type=int, default=multiprocessing.cpu_count())
+    parser.add_argument("--protocol", choices=list(sim.protocols), default="NEC")
+    parser.add_argument("--match-s", type=int, default=600, help="time limit per match")
+    parser.add_argument("--fire-rate", type=float, default=1.5, help="shots/s while able")
+    parser.add_argument("--accuracy", type=float, default=0.6, help="hit chance point blank")
+    parser.add_argument("--range", type=float, default=15.0, help="IR range in meters")
+    parser.add_argument("--speed", type=float, default=1.5, help="movement in m/s")
+    parser.add_argument("--reload-ms", type=float, default=1500, help="mean reaction time")
+    parser.add_argument("--station-rate", type=float, default=0.5, help="tag scans/min")
+    parser.add_argument(
+        "--bit-error-rate", type=float, default=0.0, help="chance of each frame bit flipping"
+    )
+    parser.add_argument(
+        "--no-correction",
+        action="store_true",
+        help="drop every frame with a bit error, for comparison with the SECDED code",
+    )
+    parser.add_argument(
+        "--tournament",
+        action="store_true",
+        help="time frames as authenticated shots, which can be longer",
+    )
+    args = parser.parse_args()
+    if not 2 <= args.players <= sim.MATCH_SIM_MAX_PLAYERS:
+        parser.error(f"need 2 to {sim.MATCH_SIM_MAX_PLAYERS} players")
+    protocol = sim.protocols[args.protocol]
+    if args.tournament and sim.lib.shot_protocol_get_data_bits(protocol) < sim.SHOT_AUTH_DATA_BITS:
+        parser.error(f"{args.protocol} is too short for tournament mode")
+
+    tasks = [(i, args) for i in range(args.matches)]
+    if args.jobs > 1:
+        with multiprocessing.Pool(args.jobs) as pool:
+            results = list(pool.imap_unordered(run_match, tasks, chunksize=1))
+    else:
+        results = [run_match(task) for task in tasks]
+    results.sort(key=lambda result: result["index"])
+
+    keys = ("shots", "hits", "busy", "blind", "collided", "corrupted", "misread")
+    totals = {key: sum(r[key] for r in results) for key in keys}
+    arrived = sum(totals[key] for key in keys if key != "shots")
+    player_ms = sum(r["player_ms"] for r in results)
+
+    mode = "tournament" if args.tournament else "open"
+    print(
+        f"{args.matches} matches, {args.players} players, {args.protocol} {mode}, "
+        f"seed {args.seed}"
+    )
+    correction = "no correction" if args.no_correction else "SECDED"
+    print(f"Bit error rate {args.bit_error_rate}, {correction}\n")
+    histogram("Match length", [r["duration_ms"] / 1000 for r in results], "s")
+    histogram("Time to kill", [ms / 1000 for r in results for ms in r["ttk_ms"]], "s")
+    print(f"Shots fired: {totals['shots']}, on target: {arrived}")
+    if arrived:
+        for key, label in (
+            ("hits", "counted as hits"),
+            ("busy", "dropped, victim still in hit feedback"),
+            ("blind", "dropped, victim's IR off for RFID"),
+            ("collided", "lost to frame collisions"),
+            ("corrupted", "rejected for bit errors"),
+            ("misread", "ignored, decoded as the victim's own team"),
+        ):
+            print(f"  {totals[key]:>8} {100 * totals[key] / arrived:5.1f}% {label}")
+    if player_ms:
+        starved = sum(r["starved_ms"] for r in results)
+        print(f"Ammo starvation: {100 * starved / player_ms:.2f}% of time alive spent empty")
+
+
+if __name__ == "__main__":
+    main()
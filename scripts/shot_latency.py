@@ -0,0 +1,175 @@
+#!/usr/bin/env python3
+"""
+Merge the shot traces of two or more devices into per-stage latency
+histograms.
+
+The app records a trace point at every stage a shot goes through (see
+shot_trace.h) and dumps them to the log when it exits. Capture the log of
+every device, for example with `log` in the qFlipper or ufbt CLI, then run:
+
+    python3 scripts/shot_latency.py shooter.log victim.log
+
+Stages on one device are paired in order: each stage is matched with the most
+recent unmatched record of the stage before it. Deltas under a minute use the
+cycle counter, longer ones the tick.
+
+The flight from the shooter's TX end to the victim's RX can only be paired
+in tournament mode, where the shot carries the shooter id and counter. The
+devices' clocks are not synced, so that stage is reported relative to the
+fastest shot seen, which shows the spread but not the absolute air time.
+"""
+
+import re
+import sys
+
+LINE = re.compile(r"\[ShotTrace\]\s+(.*)$")
+BEGIN = re.compile(r"begin (\d+) records, (\d+) cycles/us, (\d+) ticks/s")
+
+# (from, to) pairs on one device, in the order a shot goes through them.
+LOCAL_STAGES = [
+    ("input", "fire"),
+    ("fire", "tx_start"),
+    ("tx_start", "tx_end"),
+    ("rx", "hit_dequeue"),
+    ("hit_dequeue", "health"),
+    ("health", "redraw"),
+]
+
+CYCLES_LIMIT_MS = 60000
+HISTOGRAM_BUCKETS = 10
+HISTOGRAM_WIDTH = 40
+
+
+class Dump:
+    def __init__(self, source, cycles_per_us, ticks_per_s):
+        self.source = source
+        self.cycles_per_us = cycles_per_us
+        self.ticks_per_s = ticks_per_s
+        self.records = []
+
+    def tick_us(self, record):
+        return record["tick"] * 1000000 / self.ticks_per_s
+
+    def delta_us(self, first, second):
+        ticks = (second["tick"] - first["tick"]) & 0xFFFFFFFF
+        if ticks * 1000 / self.ticks_per_s < CYCLES_LIMIT_MS:
+            cycles = (second["cycles"] - first["cycles"]) & 0xFFFFFFFF
+            return cycles / self.cycles_per_us
+        return ticks * 1000000 / self.ticks_per_s
+
+
+def parse(path):
+    dumps = []
+    dump = None
+    with open(path, errors="replace") as f:
+        for line in f:
+            match = LINE.search(line.rstrip())
+            if not match:
+                continue
+            text = match.group(1)
+            begin = BEGIN.match(text)
+            if begin:
+                dump = Dump(path, int(begin.group(2)), int(begin.group(3)))
+                dumps.append(dump)
+            elif text == "end":
+                dump = None
+            elif dump is not None:
+                fields = text.split()
+                if len(fields) != 4:
+                    continue
+                stage, shot, tick, cycles = fields
+                dump.records.append(
+                    {
+                        "stage": stage,
+                        "shot": None if shot == "-1" else int(shot),
+                        "tick": int(tick),
+                        "cycles": int(cycles),
+                    }
+                )
+    return dumps
+
+
+def local_latencies(dump, samples):
+    previous = {second: first for first, second in LOCAL_STAGES}
+    pending = {}
+    for record in dump.records:
+        stage = record["stage"]
+        first = previous.get(stage)
+        if first is not None and first in pending:
+            samples.setdefault((first, stage), []).append(
+                dump.delta_us(pending.pop(first), record)
+            )
+        pending[stage] = record
+
+
+def flight_latencies(dumps):
+    sent = {}
+    for dump in dumps:
+        for record in dump.records:
+            if record["stage"] == "tx_end" and record["shot"] is not None:
+                sent[record["shot"]] = (dump, record)
+
+    raw = []
+    for dump in dumps:
+        for record in dump.records:
+            if record["stage"] != "rx" or record["shot"] not in sent:
+                continue
+            shooter, tx_end = sent[record["shot"]]
+            if shooter.source == dump.source:
+                continue
+            raw.append(dump.tick_us(record) - shooter.tick_us(tx_end))
+    if not raw:
+        return []
+    fastest = min(raw)
+    return [value - fastest for value in raw]
+
+
+def histogram(name, values):
+    values = sorted(values)
+    count = len(values)
+    print(f"{name}: {count} samples")
+    print(
+        f"  min {values[0]:.0f} us, median {values[count // 2]:.0f} us, "
+        f"p95 {values[min(count - 1, count * 95 // 100)]:.0f} us, max {values[-1]:.0f} us"
+    )
+    low = values[0]
+    width = max((values[-1] - low) / HISTOGRAM_BUCKETS, 1)
+    buckets = [0] * HISTOGRAM_BUCKETS
+    for value in values:
+        buckets[min(int((value - low) / width), HISTOGRAM_BUCKETS - 1)] += 1
+    peak = max(buckets)
+    for i, bucket in enumerate(buckets):
+        bar = "#" * (bucket * HISTOGRAM_WIDTH // peak)
+        print(f"  {low + i * width:>10.0f} us |{bar:<{HISTOGRAM_WIDTH}}| {bucket}")
+    print()
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(f"Usage: {sys.argv[0]} DEVICE_LOG...", file=sys.stderr)
+        return 1
+
+    dumps = []
+    for path in sys.argv[1:]:
+        dumps.extend(parse(path))
+    if not dumps:
+        print("No shot traces found", file=sys.stderr)
+        return 1
+
+    samples = {}
+    for dump in dumps:
+        local_latencies(dump, samples)
+    for first, second in LOCAL_STAGES:
+        if (first, second) in samples:
+            histogram(f"{first} -> {second}", samples[(first, second)])
+
+    flight = flight_latencies(dumps)
+    if flight:
+        histogram("tx_end -> rx (relative to the fastest shot)", flight)
+    else:
+        print("tx_end -> rx: no shots to pair, play in tournament mode to correlate devices")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
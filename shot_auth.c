@@ -0,0 +1,189 @@
+#include "shot_auth.h"
+#include "laser_tag_arena.h"
+#include <furi.h>
+#include <furi_hal_version.h>
+
+#define TAG "ShotAuth"
+
+#define SHOT_AUTH_SHOOTERS     (1 << SHOT_AUTH_SHOOTER_BITS)
+#define SHOT_AUTH_COUNTER_MASK ((1UL << SHOT_AUTH_COUNTER_BITS) - 1)
+#define SHOT_AUTH_PAYLOAD_BITS (1 + SHOT_AUTH_SHOOTER_BITS + SHOT_AUTH_COUNTER_BITS)
+
+typedef struct {
+    uint32_t top; // highest counter seen, bit 0 of the bitmap
+    uint32_t bitmap; // bit n set: counter top - n was seen, 0 if nothing was yet
+} ShotAuthWindow;
+
+struct ShotAuth {
+    uint32_t key;
+    uint32_t counter;
+    uint8_t shooter;
+    ShotAuthWindow windows[SHOT_AUTH_SHOOTERS];
+};
+
+LASER_TAG_ARENA_CHECK(struct ShotAuth, LASER_TAG_ARENA_SHOT_AUTH_SIZE);
+
+// murmur3 finalizer
+static uint32_t shot_auth_mix(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x85EBCA6BUL;
+    x ^= x >> 13;
+    x *= 0xC2B2AE35UL;
+    x ^= x >> 16;
+    return x;
+}
+
+static uint32_t shot_auth_tag(uint32_t key, uint32_t payload, uint32_t epoch) {
+    uint32_t mixed = shot_auth_mix(shot_auth_mix(key ^ payload) ^ (key + epoch * 0x9E3779B9UL));
+    return mixed >> (32 - SHOT_AUTH_TAG_BITS);
+}
+
+uint32_t shot_auth_shooter_for_key(uint32_t key) {
+    const uint8_t* uid = furi_hal_version_uid();
+    uint32_t hash = 2166136261UL;
+    for(size_t i = 0; i < furi_hal_version_uid_size(); i++) {
+        hash = (hash ^ uid[i]) * 16777619UL;
+    }
+    return shot_auth_mix(hash ^ key) & (SHOT_AUTH_SHOOTERS - 1);
+}
+
+ShotAuth* shot_auth_alloc() {
+    return laser_tag_arena_alloc(sizeof(ShotAuth));
+}
+
+void shot_auth_set_key(ShotAuth* auth, uint32_t key) {
+    furi_assert(auth);
+    if(key == auth->key) {
+        return;
+    }
+
+    auth->key = key;
+    auth->counter = 0;
+    memset(auth->windows, 0, sizeof(auth->windows));
+    if(key) {
+        auth->shooter = shot_auth_shooter_for_key(key);
+        FURI_LOG_I(TAG, "Tournament mode, shooter id %u", auth->shooter);
+    }
+}
+
+uint32_t shot_auth_get_key(ShotAuth* auth) {
+    furi_assert(auth);
+    return auth->key;
+}
+
+uint32_t shot_auth_get_counter(ShotAuth* auth) {
+    furi_assert(auth);
+    return auth->counter;
+}
+
+void shot_auth_set_counter(ShotAuth* auth, uint32_t counter) {
+    furi_assert(auth);
+    auth->counter = counter;
+}
+
+uint32_t shot_auth_get_shooter(uint32_t data) {
+    return (data >> 1) & ((1UL << SHOT_AUTH_SHOOTER_BITS) - 1);
+}
+
+uint32_t shot_auth_get_shot_id(uint32_t data) {
+    return (data >> 1) & ((1UL << (SHOT_AUTH_SHOOTER_BITS + SHOT_AUTH_COUNTER_BITS)) - 1);
+}
+
+uint32_t shot_auth_next(ShotAuth* auth, LaserTagTeam team) {
+    furi_assert(auth);
+    uint32_t payload = (team == TeamBlue) | (auth->shooter << 1) |
+                       ((auth->counter & SHOT_AUTH_COUNTER_MASK) << (1 + SHOT_AUTH_SHOOTER_BITS));
+    uint32_t tag = shot_auth_tag(auth->key, payload, auth->counter >> SHOT_AUTH_COUNTER_BITS);
+    auth->counter++;
+    return payload | (tag << SHOT_AUTH_PAYLOAD_BITS);
+}
+
+bool shot_auth_verify(ShotAuth* auth, uint32_t data, LaserTagTeam team) {
+    furi_assert(auth);
+
+    uint32_t payload = data & ((1UL << SHOT_AUTH_PAYLOAD_BITS) - 1);
+    uint32_t tag = (data >> SHOT_AUTH_PAYLOAD_BITS) & ((1UL << SHOT_AUTH_TAG_BITS) - 1);
+    if((LaserTagTeam)(payload & 1) != team) {
+        return false;
+    }
+
+    ShotAuthWindow* window = &auth->windows[(payload >> 1) & (SHOT_AUTH_SHOOTERS - 1)];
+
+    // Only the low bits of the counter are sent. As with IPsec extended
+    // sequence numbers, the high bits (the epoch) are inferred from the window
+    // and covered by the tag, so a shot recorded a full counter span ago
+    // doesn't verify again. If the shooter fired more than a span since the
+    // last shot seen here, the next epoch is tried as well. A shot that is
+    // still in the window but was sent just before the epoch rolled over gets
+    // the previous epoch first.
+    uint32_t span = SHOT_AUTH_COUNTER_MASK + 1;
+    uint32_t counter = (window->top & ~SHOT_AUTH_COUNTER_MASK) |
+                       ((payload >> (1 + SHOT_AUTH_SHOOTER_BITS)) & SHOT_AUTH_COUNTER_MASK);
+    if(counter > window->top && window->top >= span &&
+       counter - span + SHOT_AUTH_WINDOW_SIZE > window->top) {
+        counter -= span;
+    } else if(counter + SHOT_AUTH_WINDOW_SIZE <= window->top) {
+        counter += span;
+    }
+    if(tag != shot_auth_tag(auth->key, payload, counter >> SHOT_AUTH_COUNTER_BITS)) {
+        counter += span;
+        if(tag != shot_auth_tag(auth->key, payload, counter >> SHOT_AUTH_COUNTER_BITS)) {
+            return false;
+        }
+    }
+
+    if(!window->bitmap || counter > window->top) {
+        uint32_t ahead = counter - window->top;
+        if(!window->bitmap || ahead >= SHOT_AUTH_WINDOW_SIZE) {
+            window->bitmap = 1;
+        } else {
+            window->bitmap = (window->bitmap << ahead) | 1;
+        }
+        window->top = counter;
+        return true;
+    }
+
+    uint32_t behind = window->top - counter;
+    if(behind >= SHOT_AUTH_WINDOW_SIZE || (window->bitmap & (1UL << behind))) {
+        return false;
+    }
+    window->bitmap |= 1UL << behind;
+    return true;
+}
+
+bool shot_auth_is_clash(ShotAuth* auth, uint32_t data, LaserTagTeam team) {
+    furi_assert(auth);
+
+    if(shot_auth_get_shooter(data) != auth->shooter) {
+        return false;
+    }
+    uint32_t payload = data & ((1UL << SHOT_AUTH_PAYLOAD_BITS) - 1);
+    uint32_t tag = (data >> SHOT_AUTH_PAYLOAD_BITS) & ((1UL << SHOT_AUTH_TAG_BITS) - 1);
+
+    // Our own shots bounce back off walls and other players. They carry our
+    // team and one of the last counters we sent.
+    uint32_t sent = (auth->counter & ~SHOT_AUTH_COUNTER_MASK) |
+                    ((payload >> (1 + SHOT_AUTH_SHOOTER_BITS)) & SHOT_AUTH_COUNTER_MASK);
+    bool recent = true;
+    if(sent >= auth->counter) {
+        // Sent in the previous epoch, if there was one.
+        recent = auth->counter > SHOT_AUTH_COUNTER_MASK;
+        sent -= SHOT_AUTH_COUNTER_MASK + 1;
+    }
+    recent = recent && auth->counter - sent <= SHOT_AUTH_WINDOW_SIZE;
+    if(recent && (LaserTagTeam)(payload & 1) == team &&
+       tag == shot_auth_tag(auth->key, payload, sent >> SHOT_AUTH_COUNTER_BITS)) {
+        return false;
+    }
+
+    // Anything else with our id that authenticates was sent by another player
+    // who shares it. Players who started the match together have counters in
+    // about the same epoch.
+    uint32_t epoch = auth->counter >> SHOT_AUTH_COUNTER_BITS;
+    for(uint32_t e = epoch ? epoch - 1 : 0; e <= epoch + 1; e++) {
+        if(tag == shot_auth_tag(auth->key, payload, e)) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "game_state.h"
+
+/*
+ * Tournament mode. Every shot carries the shooter's id, a rolling counter and
+ * a tag keyed to the match key, in place of the fixed magic of open play:
+ *
+ *   bit  0      team
+ *   bits 1-7    shooter id, derived from the device UID and the match key
+ *   bits 8-17   counter, incremented on every shot
+ *   bits 18-25  tag over bits 0-17
+ *
+ * The receiver keeps a sliding window per shooter id, as IPsec does for
+ * sequence numbers, and counts each counter value at most once. The counter
+ * epoch isn't sent but is covered by the tag, so a recorded shot is worthless
+ * once it has been seen or has fallen out of the window.
+ *
+ * The tag is a keyed mix, not a cryptographic MAC, and only 8 bits long: a
+ * replayed or forged frame still gets through about once in 128 tries. It
+ * stops casual replays, not a determined attacker. The 26 data bits only fit
+ * in an NEC frame, which takes up to 87 ms on air.
+ *
+ * With 7 bits, two of ten players share a shooter id about one match in
+ * three. Their shots then share a replay window and some are rejected as
+ * replays. The id is shown before the match so players can compare, and a
+ * clash is detected as soon as a shot with our own id turns up that we
+ * didn't send. A different match card gives everyone a new id.
+ */
+
+#define SHOT_AUTH_SHOOTER_BITS 7
+#define SHOT_AUTH_COUNTER_BITS 10
+#define SHOT_AUTH_TAG_BITS     8
+#define SHOT_AUTH_WINDOW_SIZE  32
+#define SHOT_AUTH_DATA_BITS \
+    (1 + SHOT_AUTH_SHOOTER_BITS + SHOT_AUTH_COUNTER_BITS + SHOT_AUTH_TAG_BITS)
+
+typedef struct ShotAuth ShotAuth;
+
+ShotAuth* shot_auth_alloc();
+
+/**
+ * Start authenticating shots with a match key, 0 turns tournament mode off.
+ * Counters and windows are kept if the key didn't change, so shots recorded
+ * in an earlier match with the same key don't become valid again.
+ */
+void shot_auth_set_key(ShotAuth* auth, uint32_t key);
+uint32_t shot_auth_get_key(ShotAuth* auth);
+
+/**
+ * The counter survives an app restart through the match checkpoint. Victims
+ * still remember the counters this player used before, so it has to move on
+ * from there rather than start over.
+ */
+uint32_t shot_auth_get_counter(ShotAuth* auth);
+void shot_auth_set_counter(ShotAuth* auth, uint32_t counter);
+
+/** @returns the shooter id this device uses with the given match key. */
+uint32_t shot_auth_shooter_for_key(uint32_t key);
+
+/** @returns the shooter id carried by a data word. */
+uint32_t shot_auth_get_shooter(uint32_t data);
+
+/** @returns the shooter id and counter bits, the same on the shooter and the victim. */
+uint32_t shot_auth_get_shot_id(uint32_t data);
+
+/** @returns the data word for the next shot of this player. */
+uint32_t shot_auth_next(ShotAuth* auth, LaserTagTeam team);
+
+/**
+ * Check a received data word. Runs in constant time and never allocates, it is
+ * called from the IR worker thread.
+ *
+ * @returns true if it is a valid shot from the given team that wasn't seen before.
+ */
+bool shot_auth_verify(ShotAuth* auth, uint32_t data, LaserTagTeam team);
+
+/**
+ * Check a received data word for a shot from another player who has the same
+ * shooter id as this one. Echoes of our own recent shots don't count. Same
+ * constraints as shot_auth_verify.
+ *
+ * @returns true if the shot carries our id, authenticates and isn't ours.
+ */
+bool shot_auth_is_clash(ShotAuth* auth, uint32_t data, LaserTagTeam team);
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <infrared.h>
+#include "game_state.h"
+
+/*
+ * A shot is a data word holding the shooter's team and a fixed magic value,
+ * protected by an extended Hamming code (SECDED) that spans every payload bit
+ * of the frame: the address bits first, then the command bits. The receiver
+ * corrects any single flipped bit and rejects frames with two, so a frame hit
+ * by noise either still counts or is dropped, but never turns into the wrong
+ * team.
+ *
+ * Both sides must use the same protocol: frames of any other protocol are
+ * ignored.
+ */
+
+#define SHOT_MAGIC 0x42
+
+typedef struct {
+    InfraredProtocol protocol; // what the rules store and the UI shows
+    InfraredProtocol frame; // what goes on air, with as little decoder validation as possible
+    const char* name;
+    uint8_t air_time_ms; // longest open play shot, from the protocol timings
+    uint8_t tournament_air_time_ms; // longest frame of any data word, tournament shots can be
+} ShotProtocol;
+
+/** @returns the shot protocol entry, or NULL if shots can't be sent with it. */
+const ShotProtocol* shot_protocol_get(InfraredProtocol protocol);
+
+/** @returns the supported protocol after the given one, wrapping around. */
+InfraredProtocol shot_protocol_next(InfraredProtocol protocol);
+
+/** @returns the supported protocol before the given one, wrapping around. */
+InfraredProtocol shot_protocol_prev(InfraredProtocol protocol);
+
+/** @returns how many data bits a shot frame of this protocol carries. */
+uint8_t shot_protocol_get_data_bits(InfraredProtocol protocol);
+
+/** Encode a raw data word, see shot_auth.h. Bits above the data bits are dropped. */
+void shot_protocol_encode_data(
+    InfraredProtocol protocol,
+    uint32_t data,
+    InfraredMessage* message);
+
+/** Decode a raw data word, correcting a single bit error if there is one. */
+bool shot_protocol_decode_data(
+    InfraredProtocol protocol,
+    const InfraredMessage* message,
+    uint32_t* data);
+
+void shot_protocol_encode(InfraredProtocol protocol, LaserTagTeam team, InfraredMessage* message);
+
+/**
+ * Check a received frame against the shot protocol in use, correcting a single
+ * bit error if there is one.
+ *
+ * @returns true if it is a shot, with the shooter's team stored in team.
+ */
+bool shot_protocol_decode(
+    InfraredProtocol protocol,
+    const InfraredMessage* message,
+    LaserTagTeam* team);
@@ -0,0 +1,65 @@
+#include "shot_trace.h"
+#include <furi.h>
+#include <furi_hal.h>
+#include <stdatomic.h>
+
+#define TAG "ShotTrace"
+
+// The tick orders records and covers long gaps, the cycle counter gives
+// microsecond resolution between records less than a minute apart.
+typedef struct {
+    uint32_t tick;
+    uint32_t cycles;
+    uint32_t shot;
+    uint8_t stage;
+} ShotTraceRecord;
+
+static const char* const shot_trace_stage_names[ShotTraceStageCount] = {
+    [ShotTraceInput] = "input",
+    [ShotTraceFire] = "fire",
+    [ShotTraceTxStart] = "tx_start",
+    [ShotTraceTxEnd] = "tx_end",
+    [ShotTraceRx] = "rx",
+    [ShotTraceHitDequeue] = "hit_dequeue",
+    [ShotTraceHealth] = "health",
+    [ShotTraceRedraw] = "redraw",
+};
+
+static ShotTraceRecord shot_trace_records[SHOT_TRACE_SIZE];
+static atomic_uint shot_trace_next;
+
+void shot_trace(ShotTraceStage stage, uint32_t shot) {
+    uint32_t cycles = DWT->CYCCNT;
+    unsigned index = atomic_fetch_add_explicit(&shot_trace_next, 1, memory_order_relaxed);
+    ShotTraceRecord* record = &shot_trace_records[index % SHOT_TRACE_SIZE];
+    record->tick = furi_get_tick();
+    record->cycles = cycles;
+    record->shot = shot;
+    record->stage = stage;
+}
+
+void shot_trace_dump(void) {
+    unsigned count = atomic_load(&shot_trace_next);
+    if(!count) {
+        return;
+    }
+
+    FURI_LOG_I(
+        TAG,
+        "begin %u records, %lu cycles/us, %lu ticks/s",
+        MIN(count, SHOT_TRACE_SIZE),
+        furi_hal_cortex_instructions_per_microsecond(),
+        furi_kernel_get_tick_frequency());
+    for(unsigned i = (count > SHOT_TRACE_SIZE) ? count - SHOT_TRACE_SIZE : 0; i < count; i++) {
+        const ShotTraceRecord* record = &shot_trace_records[i % SHOT_TRACE_SIZE];
+        FURI_LOG_I(
+            TAG,
+            "%s %ld %lu %lu",
+            shot_trace_stage_names[record->stage],
+            (record->shot == SHOT_TRACE_NO_ID) ? -1L : (long)record->shot,
+            record->tick,
+            record->cycles);
+    }
+    FURI_LOG_I(TAG, "end");
+    atomic_store(&shot_trace_next, 0);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Timestamped trace points along the path of a shot, from the shooter's OK
+ * press to the victim's HUD redraw. Recording one costs a few instructions and
+ * never blocks, so it can be called from any thread. The last
+ * SHOT_TRACE_SIZE records are kept and logged at exit, where
+ * scripts/shot_latency.py picks them up from the logs of both devices.
+ *
+ * In tournament mode the shot id (shooter id and counter) is the same on the
+ * shooter and the victim, which is what ties the two logs together.
+ */
+
+#define SHOT_TRACE_SIZE  128
+#define SHOT_TRACE_NO_ID UINT32_MAX
+
+typedef enum {
+    ShotTraceInput, // OK pressed, input thread
+    ShotTraceFire, // laser_tag_app_fire entry
+    ShotTraceTxStart, // infrared_controller_send, before the frame goes out
+    ShotTraceTxEnd, // after it went out
+    ShotTraceRx, // hit decoded in the IR worker callback
+    ShotTraceHitDequeue, // hit event taken off the queue by the main loop
+    ShotTraceHealth, // health decreased
+    ShotTraceRedraw, // view_port_update after the hit
+    ShotTraceStageCount,
+} ShotTraceStage;
+
+void shot_trace(ShotTraceStage stage, uint32_t shot);
+
+/** Log every record, oldest first. Only call once the other threads are stopped. */
+void shot_trace_dump(void);
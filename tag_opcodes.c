@@ -0,0 +1,160 @@
+#include "tag_opcodes.h"
+#include <furi.h>
+
+#define TAG "TagOpcodes"
+
+typedef enum {
+    TagTeamRuleMatching, // TAG_TEAM_ANY or the player's team
+    TagTeamRuleOwn, // exactly the player's team
+    TagTeamRuleEnemy, // exactly the other team
+} TagTeamRule;
+
+typedef bool (*TagOpcodeHandler)(GameState* state, uint8_t argument, GameCommand* command);
+
+typedef struct {
+    TagOpcodeHandler handler;
+    TagTeamRule team_rule;
+    bool after_game_over; // also offered to a player who is out
+} TagOpcodeEntry;
+
+static bool tag_opcode_ammo(GameState* state, uint8_t argument, GameCommand* command) {
+    uint16_t ammo = game_state_get_ammo(state);
+    uint16_t max_ammo = game_state_get_max_ammo(state);
+    if(!argument || ammo >= max_ammo) {
+        return false;
+    }
+    command->type = GameCommandAddAmmo;
+    command->value = MIN(argument, max_ammo - ammo);
+    return true;
+}
+
+static bool tag_opcode_health_pack(GameState* state, uint8_t argument, GameCommand* command) {
+    if(!argument || game_state_get_health(state) >= MAX_HEALTH) {
+        return false;
+    }
+    command->type = GameCommandAddHealth;
+    command->value = argument;
+    return true;
+}
+
+static bool tag_opcode_armor(GameState* state, uint8_t argument, GameCommand* command) {
+    if(!argument || game_state_get_armor(state) >= MAX_ARMOR) {
+        return false;
+    }
+    command->type = GameCommandAddArmor;
+    command->value = argument;
+    return true;
+}
+
+static bool tag_opcode_weapon_upgrade(GameState* state, uint8_t argument, GameCommand* command) {
+    if(!argument || game_state_get_max_ammo(state) >= MAX_AMMO) {
+        return false;
+    }
+    command->type = GameCommandAddMaxAmmo;
+    command->value = argument;
+    return true;
+}
+
+static bool tag_opcode_team_switch(GameState* state, uint8_t argument, GameCommand* command) {
+    UNUSED(state);
+    UNUSED(argument);
+    command->type = GameCommandSwitchTeam;
+    command->value = 0;
+    return true;
+}
+
+static bool tag_opcode_flag_pickup(GameState* state, uint8_t argument, GameCommand* command) {
+    if(game_state_has_flag(state)) {
+        return false;
+    }
+    command->type = GameCommandPickupFlag;
+    command->value = argument;
+    return true;
+}
+
+static bool tag_opcode_flag_capture(GameState* state, uint8_t argument, GameCommand* command) {
+    if(!game_state_has_flag(state)) {
+        return false;
+    }
+    command->type = GameCommandCaptureFlag;
+    command->value = argument;
+    return true;
+}
+
+// Brings a player who is out back into the match at their base, or tops a
+// living one up there.
+static bool tag_opcode_respawn_point(GameState* state, uint8_t argument, GameCommand* command) {
+    UNUSED(argument);
+    if(!game_state_is_game_over(state) && game_state_get_health(state) >= MAX_HEALTH &&
+       game_state_get_ammo(state) >= game_state_get_max_ammo(state)) {
+        return false;
+    }
+    command->type = GameCommandRespawn;
+    command->value = 0;
+    return true;
+}
+
+// Indexed by opcode. Unlisted opcodes have no handler and are rejected.
+static const TagOpcodeEntry tag_opcodes[256] = {
+    [TagOpcodeAmmo] = {tag_opcode_ammo, TagTeamRuleMatching},
+    [TagOpcodeHealthPack] = {tag_opcode_health_pack, TagTeamRuleMatching},
+    [TagOpcodeArmor] = {tag_opcode_armor, TagTeamRuleMatching},
+    [TagOpcodeWeaponUpgrade] = {tag_opcode_weapon_upgrade, TagTeamRuleMatching},
+    [TagOpcodeTeamSwitch] = {tag_opcode_team_switch, TagTeamRuleMatching},
+    [TagOpcodeFlagPickup] = {tag_opcode_flag_pickup, TagTeamRuleEnemy},
+    [TagOpcodeFlagCapture] = {tag_opcode_flag_capture, TagTeamRuleOwn},
+    [TagOpcodeRespawnPoint] = {tag_opcode_respawn_point, TagTeamRuleOwn, true},
+};
+
+static bool tag_opcode_team_allowed(GameState* state, TagTeamRule rule, uint8_t team) {
+    uint8_t own = (game_state_get_team(state) == TeamRed) ? TAG_TEAM_RED : TAG_TEAM_BLUE;
+    uint8_t enemy = (own == TAG_TEAM_RED) ? TAG_TEAM_BLUE : TAG_TEAM_RED;
+
+    switch(rule) {
+    case TagTeamRuleMatching:
+        return team == TAG_TEAM_ANY || team == own;
+    case TagTeamRuleOwn:
+        return team == own;
+    case TagTeamRuleEnemy:
+        return team == enemy;
+    }
+    return false;
+}
+
+bool tag_opcode_decode(
+    GameState* state,
+    const uint8_t* data,
+    size_t length,
+    GameCommand* command) {
+    furi_assert(state);
+    furi_assert(data);
+    furi_assert(command);
+
+    if(length != TAG_PAYLOAD_SIZE || data[0] != TAG_MAGIC_0 || data[1] != TAG_MAGIC_1) {
+        FURI_LOG_D(TAG, "Tag is not for game");
+        return false;
+    }
+
+    const TagOpcodeEntry* entry = &tag_opcodes[data[3]];
+    if(!entry->handler) {
+        FURI_LOG_W(TAG, "Tag action unknown: %02x %02x", data[3], data[4]);
+        return false;
+    }
+
+    if(game_state_is_game_over(state) && !entry->after_game_over) {
+        FURI_LOG_I(TAG, "Tag %02x does nothing for a player who is out", data[3]);
+        return false;
+    }
+
+    if(!tag_opcode_team_allowed(state, entry->team_rule, data[2])) {
+        FURI_LOG_I(TAG, "Tag not for team: %02x", data[2]);
+        return false;
+    }
+
+    if(!entry->handler(state, data[4], command)) {
+        FURI_LOG_I(TAG, "Tag %02x has no effect right now", data[3]);
+        return false;
+    }
+
+    return true;
+}
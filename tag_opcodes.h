@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "game_state.h"
+
+/*
+ * Game tags are EM4100 tags with a 5 byte payload:
+ *
+ *   13 37 <team> <opcode> <argument>
+ *
+ * <team> is 00 for any team, A1 for red or B2 for blue. What it means depends
+ * on the opcode: most stations only serve the given team, flags belong to it.
+ * Only a respawn point does anything for a player who is out.
+ */
+
+#define TAG_MAGIC_0 0x13
+#define TAG_MAGIC_1 0x37
+
+#define TAG_TEAM_ANY  0x00
+#define TAG_TEAM_RED  0xA1
+#define TAG_TEAM_BLUE 0xB2
+
+#define TAG_PAYLOAD_SIZE 5
+
+typedef enum {
+    TagOpcodeRespawnPoint = 0xF6,
+    TagOpcodeFlagCapture = 0xF7,
+    TagOpcodeFlagPickup = 0xF8,
+    TagOpcodeTeamSwitch = 0xF9,
+    TagOpcodeWeaponUpgrade = 0xFA,
+    TagOpcodeArmor = 0xFB,
+    TagOpcodeHealthPack = 0xFC,
+    TagOpcodeAmmo = 0xFD,
+} TagOpcode;
+
+typedef enum {
+    GameCommandAddAmmo,
+    GameCommandAddHealth,
+    GameCommandAddArmor,
+    GameCommandAddMaxAmmo,
+    GameCommandSwitchTeam,
+    GameCommandPickupFlag,
+    GameCommandCaptureFlag,
+    GameCommandRespawn,
+} GameCommandType;
+
+typedef struct {
+    GameCommandType type;
+    uint16_t value;
+} GameCommand;
+
+/**
+ * Decode a tag payload into the game command it triggers for this player.
+ * Runs in constant time: the opcode indexes a 256 entry table.
+ *
+ * @returns true if the tag is a valid game tag that applies to this player.
+ */
+bool tag_opcode_decode(
+    GameState* state,
+    const uint8_t* data,
+    size_t length,
+    GameCommand* command);
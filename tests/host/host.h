@@ -0,0 +1,91 @@
+#pragma once
+
+/*
+ * Test side of the host harness. The shims under shim/ stand in for the
+ * firmware headers the app includes, src/ implements them on top of pthreads
+ * and stdio, and this is what the tests use to drive them: a clock that can
+ * be stopped, a canvas that can be read back, a GUI thread, and the IR and
+ * RFID frames that the fake workers receive.
+ */
+
+#include <furi.h>
+#include <gui/canvas.h>
+#include <gui/view_port.h>
+#include <input/input.h>
+#include <infrared.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define HOST_CANVAS_WIDTH  128
+#define HOST_CANVAS_HEIGHT 64
+
+/* Clock */
+
+/** Stops the tick at its current value, it only moves with host_clock_advance. */
+void host_clock_set_manual(bool manual);
+void host_clock_set(uint32_t tick);
+void host_clock_advance(uint32_t ticks);
+
+/* Canvas */
+
+typedef struct {
+    uint32_t calls; // canvas_* drawing calls
+    uint32_t pixels; // pixel writes, clipped ones included
+    uint32_t off_screen; // drawing calls that reached outside the frame
+    int32_t off_screen_x; // the first of them
+    int32_t off_screen_y;
+} HostCanvasStats;
+
+Canvas* host_canvas_alloc(void);
+void host_canvas_free(Canvas* canvas);
+/** What the GUI does before each draw: clear, black, FontSecondary. */
+void host_canvas_reset(Canvas* canvas);
+bool host_canvas_get_pixel(const Canvas* canvas, int32_t x, int32_t y);
+const HostCanvasStats* host_canvas_get_stats(const Canvas* canvas);
+void host_canvas_reset_stats(Canvas* canvas);
+
+/* GUI */
+
+/**
+ * Starts a GUI thread that draws the view port on every view_port_update and
+ * delivers injected input, like the firmware GUI service. Without it, input
+ * goes straight to the view port callback and nothing is drawn.
+ */
+void host_gui_start(void);
+void host_gui_stop(void);
+/** Delivers a key event to the view port on the GUI layer. */
+void host_gui_send_input(InputKey key, InputType type);
+/** Frames drawn by the GUI thread so far. */
+uint32_t host_gui_get_frames(void);
+/** Off-screen drawing calls seen by the GUI thread so far. */
+uint32_t host_gui_get_off_screen(void);
+
+/* Radios */
+
+/** Queues a decoded frame for the IR worker that is receiving, if any. */
+bool host_infrared_inject(const InfraredMessage* message);
+/** Whether furi_hal_infrared_detect_tx_output finds the external board. */
+void host_infrared_set_board(bool connected);
+/** Frames passed to infrared_signal_transmit so far. */
+uint32_t host_infrared_get_sent(void);
+/** Hands a tag to the RFID worker that is reading, if any. */
+bool host_lfrfid_inject(const uint8_t* data, size_t size);
+
+/* Allocations, in tests linked with src/alloc_count.c */
+
+/** Starts counting the calling thread's heap allocations from 0, or stops. */
+void host_alloc_count_enable(bool enable);
+uint32_t host_alloc_count_get(void);
+/** Heap bytes in use by all threads, as glibc rounds them. */
+size_t host_alloc_get_live_bytes(void);
+
+/* Threads */
+
+/** Threads started with furi_thread_start so far, by any thread. */
+uint32_t host_thread_get_started(void);
+
+/* Logging */
+
+/** Log lines the calling thread passed to FURI_LOG_*, printed or not. */
+uint32_t host_log_count_get(void);
@@ -0,0 +1,159 @@
+#include "../../laser_tag_app.c"
+#include "host.h"
+
+/*
+ * The app side of scripts/match_sim.py, built into build/sim/libmatchsim.so by
+ * make sim and loaded with ctypes. Every simulated player is a real GameState
+ * and every shot goes through the real shot protocol, so the simulator plays
+ * by the same rules as the app. The script calls the game_state_* and
+ * shot_protocol_* functions directly, this adds what it can't reach from
+ * Python: the app's constants, bit errors on the air and the tag stations.
+ *
+ * The game clock is the host's manual clock, set with host_clock_set.
+ */
+
+#define MATCH_SIM_MAX_PLAYERS 256
+
+#define MATCH_SIM_CONSTANT(name) {#name, name}
+
+typedef struct {
+    const char* name;
+    uint32_t value;
+} MatchSimConstant;
+
+extern const NotificationSequence sequence_hit;
+
+static const MatchSimConstant match_sim_constants[] = {
+    MATCH_SIM_CONSTANT(MATCH_SIM_MAX_PLAYERS),
+    MATCH_SIM_CONSTANT(INITIAL_HEALTH),
+    MATCH_SIM_CONSTANT(INITIAL_AMMO),
+    MATCH_SIM_CONSTANT(MAX_AMMO),
+    MATCH_SIM_CONSTANT(LASER_TAG_HIT_DAMAGE),
+    MATCH_SIM_CONSTANT(LASER_TAG_SCAN_TIMEOUT_MS),
+    MATCH_SIM_CONSTANT(LASER_TAG_TAG_COOLDOWN_MS),
+    MATCH_SIM_CONSTANT(RADIO_SCHEDULER_DEFAULT_PERIOD_MS),
+    MATCH_SIM_CONSTANT(RADIO_SCHEDULER_DEFAULT_RFID_PERCENT),
+    MATCH_SIM_CONSTANT(SHOT_AUTH_DATA_BITS),
+    MATCH_SIM_CONSTANT(TAG_MAGIC_0),
+    MATCH_SIM_CONSTANT(TAG_MAGIC_1),
+    MATCH_SIM_CONSTANT(TAG_TEAM_ANY),
+    MATCH_SIM_CONSTANT(TagOpcodeAmmo),
+    MATCH_SIM_CONSTANT(TeamRed),
+    MATCH_SIM_CONSTANT(TeamBlue),
+};
+
+// Stands in for laser_tag_arena.c, with room for a GameState per player.
+static uint8_t match_sim_arena[MATCH_SIM_MAX_PLAYERS * LASER_TAG_ARENA_GAME_STATE_SIZE]
+    __attribute__((aligned(LASER_TAG_ARENA_ALIGN)));
+static size_t match_sim_arena_used;
+
+void* laser_tag_arena_alloc(size_t size) {
+    size = (size + LASER_TAG_ARENA_ALIGN - 1) & ~(size_t)(LASER_TAG_ARENA_ALIGN - 1);
+    furi_check(match_sim_arena_used + size <= sizeof(match_sim_arena));
+    void* block = &match_sim_arena[match_sim_arena_used];
+    match_sim_arena_used += size;
+    return block;
+}
+
+void laser_tag_arena_reset(void) {
+    memset(match_sim_arena, 0, match_sim_arena_used);
+    match_sim_arena_used = 0;
+}
+
+size_t laser_tag_arena_get_used(void) {
+    return match_sim_arena_used;
+}
+
+/** Starts a match: no players yet and the clock stopped at 0. */
+void match_sim_begin(void) {
+    laser_tag_arena_reset();
+    host_clock_set_manual(true);
+    host_clock_set(0);
+}
+
+/** @returns the value of an app constant by its name in the source. */
+bool match_sim_constant(const char* name, uint32_t* value) {
+    if(!strcmp(name, "HIT_FEEDBACK_MS")) {
+        // RX stays off while the hit sequence plays, see infrared_rx_callback.
+        *value = 0;
+        for(const NotificationMessage* const* message = sequence_hit; *message; message++) {
+            if((*message)->type == NotificationMessageTypeDelay) {
+                *value += (*message)->length;
+            }
+        }
+        return true;
+    }
+    for(size_t i = 0; i < COUNT_OF(match_sim_constants); i++) {
+        if(!strcmp(name, match_sim_constants[i].name)) {
+            *value = match_sim_constants[i].value;
+            return true;
+        }
+    }
+    return false;
+}
+
+/** The shot protocols in the order the team select screen offers them. */
+bool match_sim_protocol(size_t index, InfraredProtocol* protocol) {
+    InfraredProtocol current = InfraredProtocolNEC;
+    for(size_t i = 0; i < index; i++) {
+        current = shot_protocol_next(current);
+        if(current == InfraredProtocolNEC) {
+            return false;
+        }
+    }
+    *protocol = current;
+    return true;
+}
+
+const char* match_sim_protocol_name(InfraredProtocol protocol) {
+    return shot_protocol_get(protocol)->name;
+}
+
+/** @returns the longest shot frame, authenticated ones in tournament mode. */
+uint8_t match_sim_protocol_air_time_ms(InfraredProtocol protocol, bool tournament) {
+    const ShotProtocol* shot_protocol = shot_protocol_get(protocol);
+    return tournament ? shot_protocol->tournament_air_time_ms : shot_protocol->air_time_ms;
+}
+
+/** @returns how many payload bits a shot frame has on the air. */
+uint8_t match_sim_protocol_frame_bits(InfraredProtocol protocol) {
+    InfraredProtocol frame = shot_protocol_get(protocol)->frame;
+    return infrared_get_protocol_address_length(frame) +
+           infrared_get_protocol_command_length(frame);
+}
+
+/**
+ * Sends a shot through the air: encodes it, flips the payload bits set in
+ * error_mask, address bits first, and decodes what arrives.
+ *
+ * @returns true if the receiver takes it for a shot, from the team stored in
+ * received.
+ */
+bool match_sim_shot(
+    InfraredProtocol protocol,
+    LaserTagTeam team,
+    uint32_t error_mask,
+    LaserTagTeam* received) {
+    InfraredMessage message;
+    shot_protocol_encode(protocol, team, &message);
+    uint8_t address_length = infrared_get_protocol_address_length(message.protocol);
+    message.address ^= error_mask & ((1UL << address_length) - 1);
+    message.command ^= error_mask >> address_length;
+    return shot_protocol_decode(protocol, &message, received);
+}
+
+/**
+ * Scans a tag the way the app does in a match. Team switches are left out,
+ * they need the IR controller.
+ *
+ * @returns true if the tag applied to the player.
+ */
+bool match_sim_scan_tag(GameState* state, const uint8_t* data, size_t length) {
+    GameCommand command;
+    if(!tag_opcode_decode(state, data, length, &command) ||
+       command.type == GameCommandSwitchTeam) {
+        return false;
+    }
+    LaserTagApp app = {.game_state = state};
+    return laser_tag_app_apply_command(&app, &command);
+}
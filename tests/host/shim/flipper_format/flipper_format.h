@@ -0,0 +1,6 @@
+#pragma once
+
+// Only declared for the prototypes in infrared_signal.h.
+#include <furi.h>
+
+typedef struct FlipperFormat FlipperFormat;
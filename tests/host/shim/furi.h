@@ -0,0 +1,201 @@
+#pragma once
+
+/*
+ * Host stand-in for the parts of the furi core the app uses. Threads, thread
+ * flags, mutexes, semaphores and message queues are backed by pthreads, timers
+ * run on one daemon thread like the FreeRTOS timer service, and a tick is a
+ * millisecond. See src/furi.c and src/furi_timer.c.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#define UNUSED(x) (void)(x)
+
+#ifndef COUNT_OF
+#define COUNT_OF(x) (sizeof(x) / sizeof(x[0]))
+#endif
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+#define FuriWaitForever 0xFFFFFFFFU
+
+typedef enum {
+    FuriStatusOk = 0,
+    FuriStatusError = -1,
+    FuriStatusErrorTimeout = -2,
+    FuriStatusErrorResource = -3,
+    FuriStatusErrorParameter = -4,
+    FuriStatusErrorNoMemory = -5,
+    FuriStatusErrorISR = -6,
+} FuriStatus;
+
+typedef enum {
+    FuriFlagWaitAny = 0x00000000U,
+    FuriFlagWaitAll = 0x00000001U,
+    FuriFlagNoClear = 0x00000002U,
+    FuriFlagError = 0x80000000U,
+    FuriFlagErrorUnknown = 0xFFFFFFFFU,
+    FuriFlagErrorTimeout = 0xFFFFFFFEU,
+    FuriFlagErrorResource = 0xFFFFFFFDU,
+    FuriFlagErrorParameter = 0xFFFFFFFCU,
+    FuriFlagErrorISR = 0xFFFFFFFAU,
+} FuriFlag;
+
+/* Checks and logging */
+
+void furi_crash_host(const char* file, int line, const char* expression)
+    __attribute__((noreturn));
+
+#define furi_check(x)                                \
+    do {                                             \
+        if(!(x)) {                                   \
+            furi_crash_host(__FILE__, __LINE__, #x); \
+        }                                            \
+    } while(0)
+
+#define furi_assert(x) furi_check(x)
+
+// Like the device, every message that passes the log level is formatted into
+// a heap buffer, so the allocation tests see what a FuriString would cost.
+void furi_log_print_format_host(char level, const char* tag, const char* format, ...);
+
+#define FURI_LOG_E(tag, format, ...) furi_log_print_format_host('E', tag, format, ##__VA_ARGS__)
+#define FURI_LOG_W(tag, format, ...) furi_log_print_format_host('W', tag, format, ##__VA_ARGS__)
+#define FURI_LOG_I(tag, format, ...) furi_log_print_format_host('I', tag, format, ##__VA_ARGS__)
+#define FURI_LOG_D(tag, format, ...) furi_log_print_format_host('D', tag, format, ##__VA_ARGS__)
+#define FURI_LOG_T(tag, format, ...) furi_log_print_format_host('T', tag, format, ##__VA_ARGS__)
+
+// uint32_t is unsigned long on the device and the app prints it with %lu. On
+// x86-64 it is unsigned int, so the app's formatting goes through here, which
+// drops the l length modifier. Arguments cast to unsigned long still print
+// right: every integer vararg takes a 64-bit slot and the app's fit 32 bits.
+int furi_host_snprintf(char* str, size_t size, const char* format, ...);
+
+#define snprintf furi_host_snprintf
+
+// One global recursive lock stands in for masking interrupts.
+void furi_critical_enter_host(void);
+void furi_critical_exit_host(void);
+
+#define FURI_CRITICAL_ENTER() furi_critical_enter_host()
+#define FURI_CRITICAL_EXIT()  furi_critical_exit_host()
+
+/* Kernel */
+
+uint32_t furi_get_tick(void);
+uint32_t furi_kernel_get_tick_frequency(void);
+uint32_t furi_ms_to_ticks(uint32_t milliseconds);
+void furi_delay_ms(uint32_t milliseconds);
+void furi_delay_tick(uint32_t ticks);
+
+/* Threads */
+
+typedef struct FuriThread FuriThread;
+typedef void* FuriThreadId;
+typedef int32_t (*FuriThreadCallback)(void* context);
+
+typedef enum {
+    FuriThreadPriorityNone = 0,
+    FuriThreadPriorityIdle = 1,
+    FuriThreadPriorityLowest = 14,
+    FuriThreadPriorityLow = 15,
+    FuriThreadPriorityNormal = 16,
+    FuriThreadPriorityHigh = 17,
+    FuriThreadPriorityHighest = 18,
+} FuriThreadPriority;
+
+FuriThread* furi_thread_alloc_ex(
+    const char* name,
+    uint32_t stack_size,
+    FuriThreadCallback callback,
+    void* context);
+void furi_thread_free(FuriThread* thread);
+void furi_thread_start(FuriThread* thread);
+bool furi_thread_join(FuriThread* thread);
+int32_t furi_thread_get_return_code(FuriThread* thread);
+void furi_thread_set_priority(FuriThread* thread, FuriThreadPriority priority);
+FuriThreadId furi_thread_get_id(FuriThread* thread);
+FuriThreadId furi_thread_get_current_id(void);
+uint32_t furi_thread_get_stack_space(FuriThreadId thread_id);
+
+uint32_t furi_thread_flags_set(FuriThreadId thread_id, uint32_t flags);
+uint32_t furi_thread_flags_clear(uint32_t flags);
+uint32_t furi_thread_flags_get(void);
+uint32_t furi_thread_flags_wait(uint32_t flags, uint32_t options, uint32_t timeout);
+
+/* Mutexes and semaphores */
+
+typedef enum {
+    FuriMutexTypeNormal,
+    FuriMutexTypeRecursive,
+} FuriMutexType;
+
+typedef struct FuriMutex FuriMutex;
+
+FuriMutex* furi_mutex_alloc(FuriMutexType type);
+void furi_mutex_free(FuriMutex* instance);
+FuriStatus furi_mutex_acquire(FuriMutex* instance, uint32_t timeout);
+FuriStatus furi_mutex_release(FuriMutex* instance);
+
+typedef struct FuriSemaphore FuriSemaphore;
+
+FuriSemaphore* furi_semaphore_alloc(uint32_t max_count, uint32_t initial_count);
+void furi_semaphore_free(FuriSemaphore* instance);
+FuriStatus furi_semaphore_acquire(FuriSemaphore* instance, uint32_t timeout);
+FuriStatus furi_semaphore_release(FuriSemaphore* instance);
+uint32_t furi_semaphore_get_count(FuriSemaphore* instance);
+
+/* Message queues */
+
+typedef struct FuriMessageQueue FuriMessageQueue;
+
+FuriMessageQueue* furi_message_queue_alloc(uint32_t msg_count, uint32_t msg_size);
+void furi_message_queue_free(FuriMessageQueue* instance);
+FuriStatus
+    furi_message_queue_put(FuriMessageQueue* instance, const void* msg_ptr, uint32_t timeout);
+FuriStatus furi_message_queue_get(FuriMessageQueue* instance, void* msg_ptr, uint32_t timeout);
+uint32_t furi_message_queue_get_capacity(FuriMessageQueue* instance);
+uint32_t furi_message_queue_get_count(FuriMessageQueue* instance);
+
+/* Timers */
+
+typedef void (*FuriTimerCallback)(void* context);
+typedef void (*FuriTimerPendigCallback)(void* context, uint32_t arg);
+
+typedef enum {
+    FuriTimerTypeOnce = 0,
+    FuriTimerTypePeriodic = 1,
+} FuriTimerType;
+
+typedef struct FuriTimer FuriTimer;
+
+FuriTimer* furi_timer_alloc(FuriTimerCallback func, FuriTimerType type, void* context);
+void furi_timer_free(FuriTimer* instance);
+FuriStatus furi_timer_start(FuriTimer* instance, uint32_t ticks);
+FuriStatus furi_timer_restart(FuriTimer* instance, uint32_t ticks);
+FuriStatus furi_timer_stop(FuriTimer* instance);
+uint32_t furi_timer_is_running(FuriTimer* instance);
+void furi_timer_pending_callback(FuriTimerPendigCallback callback, void* context, uint32_t arg);
+
+/* Strings, only declared for the prototypes in infrared_signal.h */
+
+typedef struct FuriString FuriString;
+
+/* Records and memory */
+
+void* furi_record_open(const char* name);
+void furi_record_close(const char* name);
+
+size_t memmgr_get_free_heap(void);
+size_t memmgr_get_minimum_free_heap(void);
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <furi_hal_gpio.h>
+#include <furi_hal_infrared.h>
+#include <furi_hal_power.h>
+#include <furi_hal_version.h>
+#include <stdint.h>
+
+/*
+ * The cycle counter runs at the device's 64 MHz from the host's monotonic
+ * clock. Each thread reads its own copy, so reading it is never a data race.
+ */
+typedef struct {
+    volatile uint32_t CYCCNT;
+} DWT_Type;
+
+DWT_Type* furi_hal_cortex_dwt_host(void);
+
+#define DWT (furi_hal_cortex_dwt_host())
+
+uint32_t furi_hal_cortex_instructions_per_microsecond(void);
@@ -0,0 +1,29 @@
+#pragma once
+
+typedef struct {
+    const char* name;
+} GpioPin;
+
+typedef enum {
+    GpioModeInput,
+    GpioModeOutputPushPull,
+    GpioModeOutputOpenDrain,
+    GpioModeAnalog,
+} GpioMode;
+
+typedef enum {
+    GpioPullNo,
+    GpioPullUp,
+    GpioPullDown,
+} GpioPull;
+
+typedef enum {
+    GpioSpeedLow,
+    GpioSpeedMedium,
+    GpioSpeedHigh,
+    GpioSpeedVeryHigh,
+} GpioSpeed;
+
+extern const GpioPin gpio_ext_pa7;
+
+void furi_hal_gpio_init(const GpioPin* gpio, GpioMode mode, GpioPull pull, GpioSpeed speed);
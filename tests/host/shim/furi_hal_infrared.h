@@ -0,0 +1,11 @@
+#pragma once
+
+typedef enum {
+    FuriHalInfraredTxPinInternal,
+    FuriHalInfraredTxPinExtPA7,
+    FuriHalInfraredTxPinMax,
+} FuriHalInfraredTxPin;
+
+/** The result is set by the test, see host_infrared_set_board. */
+FuriHalInfraredTxPin furi_hal_infrared_detect_tx_output(void);
+void furi_hal_infrared_set_tx_output(FuriHalInfraredTxPin tx_pin);
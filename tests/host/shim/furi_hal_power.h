@@ -0,0 +1,4 @@
+#pragma once
+
+void furi_hal_power_enable_otg(void);
+void furi_hal_power_disable_otg(void);
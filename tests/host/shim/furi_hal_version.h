@@ -0,0 +1,7 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+const uint8_t* furi_hal_version_uid(void);
+size_t furi_hal_version_uid_size(void);
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Canvas stand-in that rasterizes into a 128x64 bitmap, see src/canvas.c.
+ * Only the calls the app makes are provided.
+ */
+
+typedef struct Canvas Canvas;
+
+typedef enum {
+    ColorWhite = 0x00,
+    ColorBlack = 0x01,
+    ColorXOR = 0x02,
+} Color;
+
+typedef enum {
+    FontPrimary,
+    FontSecondary,
+    FontKeyboard,
+    FontBigNumbers,
+    FontTotalNumber,
+} Font;
+
+typedef enum {
+    AlignLeft,
+    AlignRight,
+    AlignTop,
+    AlignBottom,
+    AlignCenter,
+} Align;
+
+size_t canvas_width(const Canvas* canvas);
+size_t canvas_height(const Canvas* canvas);
+void canvas_clear(Canvas* canvas);
+void canvas_set_color(Canvas* canvas, Color color);
+void canvas_set_font(Canvas* canvas, Font font);
+uint16_t canvas_string_width(Canvas* canvas, const char* str);
+void canvas_draw_str(Canvas* canvas, int32_t x, int32_t y, const char* str);
+void canvas_draw_str_aligned(
+    Canvas* canvas,
+    int32_t x,
+    int32_t y,
+    Align horizontal,
+    Align vertical,
+    const char* str);
+void canvas_draw_dot(Canvas* canvas, int32_t x, int32_t y);
+void canvas_draw_box(Canvas* canvas, int32_t x, int32_t y, size_t width, size_t height);
+void canvas_draw_frame(Canvas* canvas, int32_t x, int32_t y, size_t width, size_t height);
+void canvas_draw_line(Canvas* canvas, int32_t x1, int32_t y1, int32_t x2, int32_t y2);
+void canvas_draw_circle(Canvas* canvas, int32_t x, int32_t y, size_t radius);
+void canvas_draw_disc(Canvas* canvas, int32_t x, int32_t y, size_t radius);
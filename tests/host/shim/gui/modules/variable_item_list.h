@@ -0,0 +1,3 @@
+#pragma once
+
+// Included by laser_tag_app.h, nothing from it is used.
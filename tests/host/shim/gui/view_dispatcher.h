@@ -0,0 +1,4 @@
+#pragma once
+
+// Included by laser_tag_app.h for View, nothing else from it is used.
+#include <gui/view.h>
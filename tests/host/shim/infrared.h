@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Same order as the firmware, shot_protocols[] and the checkpoints store it.
+typedef enum {
+    InfraredProtocolUnknown = -1,
+    InfraredProtocolNEC = 0,
+    InfraredProtocolNECext,
+    InfraredProtocolNEC42,
+    InfraredProtocolNEC42ext,
+    InfraredProtocolSamsung32,
+    InfraredProtocolRC6,
+    InfraredProtocolRC5,
+    InfraredProtocolRC5X,
+    InfraredProtocolSIRC,
+    InfraredProtocolSIRC15,
+    InfraredProtocolSIRC20,
+    InfraredProtocolKaseikyo,
+    InfraredProtocolRCA,
+    InfraredProtocolPioneer,
+    InfraredProtocolMAX,
+} InfraredProtocol;
+
+typedef struct {
+    InfraredProtocol protocol;
+    uint32_t address;
+    uint32_t command;
+    bool repeat;
+} InfraredMessage;
+
+uint8_t infrared_get_protocol_address_length(InfraredProtocol protocol);
+uint8_t infrared_get_protocol_command_length(InfraredProtocol protocol);
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <infrared.h>
+
+/*
+ * Fake IR receiver. While RX is started, a worker thread delivers the frames
+ * handed to host_infrared_inject to the callback, like the real worker does
+ * from its own thread.
+ */
+
+typedef struct InfraredWorker InfraredWorker;
+typedef struct InfraredWorkerSignal InfraredWorkerSignal;
+
+typedef void (*InfraredWorkerReceivedSignalCallback)(
+    void* context,
+    InfraredWorkerSignal* received_signal);
+
+InfraredWorker* infrared_worker_alloc(void);
+void infrared_worker_free(InfraredWorker* instance);
+void infrared_worker_rx_start(InfraredWorker* instance);
+void infrared_worker_rx_stop(InfraredWorker* instance);
+void infrared_worker_rx_set_received_signal_callback(
+    InfraredWorker* instance,
+    InfraredWorkerReceivedSignalCallback callback,
+    void* context);
+bool infrared_worker_signal_is_decoded(const InfraredWorkerSignal* signal);
+const InfraredMessage* infrared_worker_get_decoded_signal(const InfraredWorkerSignal* signal);
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <toolbox/protocols/protocol.h>
+
+typedef enum {
+    LFRFIDProtocolEM4100,
+    LFRFIDProtocolEM4100_32,
+    LFRFIDProtocolEM4100_16,
+    LFRFIDProtocolH10301,
+    LFRFIDProtocolIndala26,
+    LFRFIDProtocolMax,
+} LFRFIDProtocol;
+
+extern const ProtocolBase* lfrfid_protocols[];
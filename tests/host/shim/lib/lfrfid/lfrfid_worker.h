@@ -0,0 +1,42 @@
+#pragma once
+
+#include <toolbox/protocols/protocol_dict.h>
+
+/*
+ * Fake 125 kHz worker. Its thread reports the ASK read as started when read
+ * mode is entered, and a tag handed to host_lfrfid_inject as read.
+ */
+
+typedef enum {
+    LFRFIDWorkerReadTypeAuto,
+    LFRFIDWorkerReadTypeASKOnly,
+    LFRFIDWorkerReadTypePSKOnly,
+} LFRFIDWorkerReadType;
+
+typedef enum {
+    LFRFIDWorkerReadSenseStart,
+    LFRFIDWorkerReadSenseEnd,
+    LFRFIDWorkerReadSenseCardStart,
+    LFRFIDWorkerReadSenseCardEnd,
+    LFRFIDWorkerReadStartASK,
+    LFRFIDWorkerReadStartPSK,
+    LFRFIDWorkerReadDone,
+} LFRFIDWorkerReadResult;
+
+typedef void (*LFRFIDWorkerReadCallback)(
+    LFRFIDWorkerReadResult result,
+    ProtocolId protocol,
+    void* context);
+
+typedef struct LFRFIDWorker LFRFIDWorker;
+
+LFRFIDWorker* lfrfid_worker_alloc(ProtocolDict* dict);
+void lfrfid_worker_free(LFRFIDWorker* worker);
+void lfrfid_worker_start_thread(LFRFIDWorker* worker);
+void lfrfid_worker_stop_thread(LFRFIDWorker* worker);
+void lfrfid_worker_read_start(
+    LFRFIDWorker* worker,
+    LFRFIDWorkerReadType type,
+    LFRFIDWorkerReadCallback callback,
+    void* context);
+void lfrfid_worker_stop(LFRFIDWorker* worker);
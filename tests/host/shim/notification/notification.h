@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+
+#define RECORD_NOTIFICATION "notification"
+
+typedef struct NotificationApp NotificationApp;
+
+typedef enum {
+    NotificationMessageTypeVibro,
+    NotificationMessageTypeSoundOn,
+    NotificationMessageTypeSoundOff,
+    NotificationMessageTypeLed,
+    NotificationMessageTypeDelay,
+} NotificationMessageType;
+
+typedef struct {
+    NotificationMessageType type;
+    uint32_t length; // ms, delays only
+} NotificationMessage;
+
+typedef const NotificationMessage* NotificationSequence[];
+
+/** Queued and played by the notification service on the device, dropped here. */
+void notification_message(NotificationApp* app, const NotificationSequence* sequence);
+
+/**
+ * Returns once the sequence played. Sleeps for its delays, scaled down by
+ * HOST_NOTIFICATION_SPEEDUP so that the tests keep the blocking behaviour
+ * without taking seconds per hit.
+ */
+void notification_message_block(NotificationApp* app, const NotificationSequence* sequence);
+
+#define HOST_NOTIFICATION_SPEEDUP 10
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <notification/notification.h>
+
+extern const NotificationMessage message_vibro_on;
+extern const NotificationMessage message_vibro_off;
+extern const NotificationMessage message_note_c4;
+extern const NotificationMessage message_note_d4;
+extern const NotificationMessage message_note_g3;
+extern const NotificationMessage message_sound_off;
+extern const NotificationMessage message_red_255;
+extern const NotificationMessage message_green_255;
+extern const NotificationMessage message_blue_255;
+extern const NotificationMessage message_delay_10;
+extern const NotificationMessage message_delay_50;
+extern const NotificationMessage message_delay_100;
+extern const NotificationMessage message_delay_1000;
+
+extern const NotificationSequence sequence_blink_red_100;
+extern const NotificationSequence sequence_blink_blue_100;
+extern const NotificationSequence sequence_success;
+extern const NotificationSequence sequence_error;
+extern const NotificationSequence sequence_single_vibro;
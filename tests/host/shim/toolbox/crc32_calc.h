@@ -0,0 +1,6 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+uint32_t crc32_calc_buffer(uint32_t crc, const void* buffer, size_t size);
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int32_t ProtocolId;
+
+#define PROTOCOL_NO (-1)
+
+typedef struct {
+    const char* name;
+    size_t data_size;
+} ProtocolBase;
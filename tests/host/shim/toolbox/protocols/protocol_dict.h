@@ -0,0 +1,21 @@
+#pragma once
+
+#include <toolbox/protocols/protocol.h>
+
+typedef struct ProtocolDict ProtocolDict;
+
+ProtocolDict* protocol_dict_alloc(const ProtocolBase** protocols, size_t protocol_count);
+void protocol_dict_free(ProtocolDict* dict);
+size_t protocol_dict_get_max_data_size(ProtocolDict* dict);
+const char* protocol_dict_get_name(ProtocolDict* dict, size_t protocol_index);
+size_t protocol_dict_get_data_size(ProtocolDict* dict, size_t protocol_index);
+void protocol_dict_get_data(
+    ProtocolDict* dict,
+    size_t protocol_index,
+    uint8_t* data,
+    size_t data_size);
+void protocol_dict_set_data(
+    ProtocolDict* dict,
+    size_t protocol_index,
+    const uint8_t* data,
+    size_t data_size);
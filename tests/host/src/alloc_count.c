@@ -0,0 +1,82 @@
+#include "../host.h"
+#include <errno.h>
+#include <malloc.h>
+#include <stdatomic.h>
+
+/*
+ * Counts the heap allocations made on a thread while it has the counter
+ * enabled, and the bytes in use by all threads. Linked into a test, these
+ * replace the allocator entry points, and forward to glibc's under the names
+ * it keeps for that. Not part of the TSan build, which brings its own
+ * allocator.
+ */
+
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void* __libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void* ptr);
+
+static __thread bool alloc_count_enabled;
+static __thread uint32_t alloc_count;
+static atomic_size_t alloc_live_bytes;
+
+static void* alloc_count_add(void* block) {
+    if(alloc_count_enabled) {
+        alloc_count++;
+    }
+    atomic_fetch_add(&alloc_live_bytes, malloc_usable_size(block));
+    return block;
+}
+
+void* malloc(size_t size) {
+    return alloc_count_add(__libc_malloc(size));
+}
+
+void* calloc(size_t count, size_t size) {
+    return alloc_count_add(__libc_calloc(count, size));
+}
+
+void* realloc(void* ptr, size_t size) {
+    size_t old = malloc_usable_size(ptr);
+    void* block = __libc_realloc(ptr, size);
+    if(block || !size) {
+        atomic_fetch_sub(&alloc_live_bytes, old);
+    }
+    return alloc_count_add(block);
+}
+
+void* memalign(size_t alignment, size_t size) {
+    return alloc_count_add(__libc_memalign(alignment, size));
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size) {
+    void* block = memalign(alignment, size);
+    if(!block) {
+        return ENOMEM;
+    }
+    *ptr = block;
+    return 0;
+}
+
+void free(void* ptr) {
+    atomic_fetch_sub(&alloc_live_bytes, malloc_usable_size(ptr));
+    __libc_free(ptr);
+}
+
+void host_alloc_count_enable(bool enable) {
+    alloc_count_enabled = enable;
+    alloc_count = 0;
+}
+
+uint32_t host_alloc_count_get(void) {
+    return alloc_count;
+}
+
+size_t host_alloc_get_live_bytes(void) {
+    return atomic_load(&alloc_live_bytes);
+}
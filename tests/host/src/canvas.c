@@ -0,0 +1,324 @@
+#include "../host.h"
+#include <gui/canvas.h>
+
+/*
+ * Rasterizes into a 128x64 bitmap. Boxes, frames, lines, circles and discs
+ * follow u8g2, so those are pixel exact.
+ *
+ * Text is not: the firmware fonts aren't available to the host, so every
+ * glyph is a 3x5 stand-in. FontSecondary advances 5 pixels per character and
+ * FontPrimary, drawn bold and 4 wide, advances 6, which is about what the
+ * firmware fonts average. That is close enough to tell whether text lands on
+ * screen, is aligned where it should be and doesn't run into its neighbours,
+ * and to notice when a string changes.
+ */
+
+#define CANVAS_FONT_ASCENT 5
+#define CANVAS_FONT_GAP    2
+
+struct Canvas {
+    uint8_t pixels[HOST_CANVAS_HEIGHT][HOST_CANVAS_WIDTH];
+    Color color;
+    Font font;
+    HostCanvasStats stats;
+};
+
+// ASCII 32 to 126, one row per value from the top, 4 is the left column.
+static const uint8_t canvas_font_glyphs[][CANVAS_FONT_ASCENT] = {
+    {0, 0, 0, 0, 0}, {2, 2, 2, 0, 2}, {5, 5, 0, 0, 0}, {5, 7, 5, 7, 5}, // space ! " #
+    {3, 6, 2, 3, 6}, {5, 1, 2, 4, 5}, {2, 5, 2, 5, 3}, {2, 2, 0, 0, 0}, // $ % & '
+    {1, 2, 2, 2, 1}, {4, 2, 2, 2, 4}, {0, 5, 2, 5, 0}, {0, 2, 7, 2, 0}, // ( ) * +
+    {0, 0, 0, 2, 4}, {0, 0, 7, 0, 0}, {0, 0, 0, 0, 2}, {1, 1, 2, 4, 4}, // , - . /
+    {7, 5, 5, 5, 7}, {2, 6, 2, 2, 7}, {7, 1, 7, 4, 7}, {7, 1, 3, 1, 7}, // 0 1 2 3
+    {5, 5, 7, 1, 1}, {7, 4, 7, 1, 7}, {7, 4, 7, 5, 7}, {7, 1, 1, 2, 2}, // 4 5 6 7
+    {7, 5, 7, 5, 7}, {7, 5, 7, 1, 7}, {0, 2, 0, 2, 0}, {0, 2, 0, 2, 4}, // 8 9 : ;
+    {1, 2, 4, 2, 1}, {0, 7, 0, 7, 0}, {4, 2, 1, 2, 4}, {7, 1, 3, 0, 2}, // < = > ?
+    {7, 5, 7, 4, 7}, {2, 5, 7, 5, 5}, {6, 5, 6, 5, 6}, {3, 4, 4, 4, 3}, // @ A B C
+    {6, 5, 5, 5, 6}, {7, 4, 6, 4, 7}, {7, 4, 6, 4, 4}, {3, 4, 5, 5, 3}, // D E F G
+    {5, 5, 7, 5, 5}, {7, 2, 2, 2, 7}, {1, 1, 1, 5, 2}, {5, 5, 6, 5, 5}, // H I J K
+    {4, 4, 4, 4, 7}, {5, 7, 7, 5, 5}, {6, 5, 5, 5, 5}, {2, 5, 5, 5, 2}, // L M N O
+    {6, 5, 6, 4, 4}, {2, 5, 5, 6, 3}, {6, 5, 6, 5, 5}, {3, 4, 2, 1, 6}, // P Q R S
+    {7, 2, 2, 2, 2}, {5, 5, 5, 5, 7}, {5, 5, 5, 5, 2}, {5, 5, 7, 7, 5}, // T U V W
+    {5, 5, 2, 5, 5}, {5, 5, 2, 2, 2}, {7, 1, 2, 4, 7}, {6, 4, 4, 4, 6}, // X Y Z [
+    {4, 4, 2, 1, 1}, {3, 1, 1, 1, 3}, {2, 5, 0, 0, 0}, {0, 0, 0, 0, 7}, // \ ] ^ _
+    {4, 2, 0, 0, 0}, {0, 3, 5, 5, 3}, {4, 6, 5, 5, 6}, {0, 3, 4, 4, 3}, // ` a b c
+    {1, 3, 5, 5, 3}, {0, 2, 5, 6, 3}, {1, 2, 7, 2, 2}, {0, 3, 5, 3, 6}, // d e f g
+    {4, 6, 5, 5, 5}, {2, 0, 2, 2, 2}, {1, 0, 1, 5, 2}, {4, 5, 6, 6, 5}, // h i j k
+    {6, 2, 2, 2, 7}, {0, 7, 7, 5, 5}, {0, 6, 5, 5, 5}, {0, 2, 5, 5, 2}, // l m n o
+    {0, 6, 5, 6, 4}, {0, 3, 5, 3, 1}, {0, 3, 4, 4, 4}, {0, 3, 6, 3, 6}, // p q r s
+    {2, 7, 2, 2, 1}, {0, 5, 5, 5, 3}, {0, 5, 5, 5, 2}, {0, 5, 5, 7, 7}, // t u v w
+    {0, 5, 2, 2, 5}, {0, 5, 5, 2, 4}, {0, 7, 1, 2, 7}, {3, 2, 6, 2, 3}, // x y z {
+    {2, 2, 2, 2, 2}, {6, 2, 3, 2, 6}, {0, 3, 6, 0, 0}, // | } ~
+};
+
+Canvas* host_canvas_alloc(void) {
+    Canvas* canvas = calloc(1, sizeof(Canvas));
+    furi_check(canvas);
+    host_canvas_reset(canvas);
+    return canvas;
+}
+
+void host_canvas_free(Canvas* canvas) {
+    free(canvas);
+}
+
+void host_canvas_reset(Canvas* canvas) {
+    canvas_clear(canvas);
+    canvas->color = ColorBlack;
+    canvas->font = FontSecondary;
+}
+
+bool host_canvas_get_pixel(const Canvas* canvas, int32_t x, int32_t y) {
+    furi_check(x >= 0 && x < HOST_CANVAS_WIDTH && y >= 0 && y < HOST_CANVAS_HEIGHT);
+    return canvas->pixels[y][x];
+}
+
+const HostCanvasStats* host_canvas_get_stats(const Canvas* canvas) {
+    return &canvas->stats;
+}
+
+void host_canvas_reset_stats(Canvas* canvas) {
+    memset(&canvas->stats, 0, sizeof(canvas->stats));
+}
+
+// Every drawing call goes through here with the area it covers.
+static void canvas_account(Canvas* canvas, int32_t x, int32_t y, int32_t width, int32_t height) {
+    canvas->stats.calls++;
+    if(width <= 0 || height <= 0) {
+        return;
+    }
+    if(x < 0 || y < 0 || x + width > HOST_CANVAS_WIDTH || y + height > HOST_CANVAS_HEIGHT) {
+        if(!canvas->stats.off_screen++) {
+            canvas->stats.off_screen_x = x;
+            canvas->stats.off_screen_y = y;
+        }
+    }
+}
+
+static void canvas_pixel(Canvas* canvas, int32_t x, int32_t y) {
+    canvas->stats.pixels++;
+    if(x < 0 || x >= HOST_CANVAS_WIDTH || y < 0 || y >= HOST_CANVAS_HEIGHT) {
+        return;
+    }
+    if(canvas->color == ColorXOR) {
+        canvas->pixels[y][x] ^= 1;
+    } else {
+        canvas->pixels[y][x] = canvas->color == ColorBlack;
+    }
+}
+
+size_t canvas_width(const Canvas* canvas) {
+    UNUSED(canvas);
+    return HOST_CANVAS_WIDTH;
+}
+
+size_t canvas_height(const Canvas* canvas) {
+    UNUSED(canvas);
+    return HOST_CANVAS_HEIGHT;
+}
+
+// Clears to white and leaves the color alone, like the firmware.
+void canvas_clear(Canvas* canvas) {
+    furi_check(canvas);
+    memset(canvas->pixels, 0, sizeof(canvas->pixels));
+}
+
+void canvas_set_color(Canvas* canvas, Color color) {
+    furi_check(canvas);
+    canvas->color = color;
+}
+
+void canvas_set_font(Canvas* canvas, Font font) {
+    furi_check(canvas);
+    furi_check(font < FontTotalNumber);
+    canvas->font = font;
+}
+
+static int32_t canvas_font_advance(const Canvas* canvas) {
+    return canvas->font == FontPrimary ? 6 : 5;
+}
+
+uint16_t canvas_string_width(Canvas* canvas, const char* str) {
+    furi_check(canvas && str);
+    size_t length = strlen(str);
+    return length ? length * canvas_font_advance(canvas) - CANVAS_FONT_GAP : 0;
+}
+
+void canvas_draw_str(Canvas* canvas, int32_t x, int32_t y, const char* str) {
+    furi_check(canvas && str);
+    canvas_account(
+        canvas, x, y - CANVAS_FONT_ASCENT, canvas_string_width(canvas, str), CANVAS_FONT_ASCENT);
+
+    bool bold = canvas->font == FontPrimary;
+    for(; *str; str++, x += canvas_font_advance(canvas)) {
+        uint8_t c = *str;
+        if(c < ' ' || c > '~') {
+            c = '?';
+        }
+        const uint8_t* glyph = canvas_font_glyphs[c - ' '];
+        for(int32_t row = 0; row < CANVAS_FONT_ASCENT; row++) {
+            for(int32_t column = 0; column < 3; column++) {
+                if(glyph[row] & (4 >> column)) {
+                    int32_t py = y - CANVAS_FONT_ASCENT + row;
+                    canvas_pixel(canvas, x + column, py);
+                    if(bold) {
+                        canvas_pixel(canvas, x + column + 1, py);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void canvas_draw_str_aligned(
+    Canvas* canvas,
+    int32_t x,
+    int32_t y,
+    Align horizontal,
+    Align vertical,
+    const char* str) {
+    furi_check(canvas && str);
+    switch(horizontal) {
+    case AlignRight:
+        x -= canvas_string_width(canvas, str);
+        break;
+    case AlignCenter:
+        x -= canvas_string_width(canvas, str) / 2;
+        break;
+    default:
+        break;
+    }
+    switch(vertical) {
+    case AlignTop:
+        y += CANVAS_FONT_ASCENT;
+        break;
+    case AlignCenter:
+        y += CANVAS_FONT_ASCENT / 2;
+        break;
+    default:
+        break;
+    }
+    canvas_draw_str(canvas, x, y, str);
+}
+
+void canvas_draw_dot(Canvas* canvas, int32_t x, int32_t y) {
+    furi_check(canvas);
+    canvas_account(canvas, x, y, 1, 1);
+    canvas_pixel(canvas, x, y);
+}
+
+void canvas_draw_box(Canvas* canvas, int32_t x, int32_t y, size_t width, size_t height) {
+    furi_check(canvas);
+    canvas_account(canvas, x, y, width, height);
+    for(size_t row = 0; row < height; row++) {
+        for(size_t column = 0; column < width; column++) {
+            canvas_pixel(canvas, x + column, y + row);
+        }
+    }
+}
+
+void canvas_draw_frame(Canvas* canvas, int32_t x, int32_t y, size_t width, size_t height) {
+    furi_check(canvas);
+    canvas_account(canvas, x, y, width, height);
+    if(!width || !height) {
+        return;
+    }
+    for(size_t column = 0; column < width; column++) {
+        canvas_pixel(canvas, x + column, y);
+        if(height > 1) {
+            canvas_pixel(canvas, x + column, y + height - 1);
+        }
+    }
+    for(size_t row = 1; row + 1 < height; row++) {
+        canvas_pixel(canvas, x, y + row);
+        if(width > 1) {
+            canvas_pixel(canvas, x + width - 1, y + row);
+        }
+    }
+}
+
+// u8g2_DrawLine
+void canvas_draw_line(Canvas* canvas, int32_t x1, int32_t y1, int32_t x2, int32_t y2) {
+    furi_check(canvas);
+    canvas_account(canvas, MIN(x1, x2), MIN(y1, y2), abs(x2 - x1) + 1, abs(y2 - y1) + 1);
+
+    int32_t dx = abs(x2 - x1);
+    int32_t dy = abs(y2 - y1);
+    bool swapxy = dy > dx;
+    int32_t swap;
+    if(swapxy) {
+        swap = dx, dx = dy, dy = swap;
+        swap = x1, x1 = y1, y1 = swap;
+        swap = x2, x2 = y2, y2 = swap;
+    }
+    if(x1 > x2) {
+        swap = x1, x1 = x2, x2 = swap;
+        swap = y1, y1 = y2, y2 = swap;
+    }
+    int32_t err = dx >> 1;
+    int32_t ystep = y2 > y1 ? 1 : -1;
+    int32_t y = y1;
+    for(int32_t x = x1; x <= x2; x++) {
+        if(swapxy) {
+            canvas_pixel(canvas, y, x);
+        } else {
+            canvas_pixel(canvas, x, y);
+        }
+        err -= dy;
+        if(err < 0) {
+            y += ystep;
+            err += dx;
+        }
+    }
+}
+
+// u8g2_DrawCircle and u8g2_DrawDisc, one octant walk for both.
+static void canvas_draw_round(Canvas* canvas, int32_t x0, int32_t y0, int32_t radius, bool fill) {
+    int32_t f = 1 - radius;
+    int32_t ddf_x = 1;
+    int32_t ddf_y = -2 * radius;
+    int32_t x = 0;
+    int32_t y = radius;
+    for(;;) {
+        for(int32_t swap = 0; swap < 2; swap++) {
+            int32_t sx = swap ? y : x;
+            int32_t sy = swap ? x : y;
+            if(fill) {
+                for(int32_t i = 0; i <= sy; i++) {
+                    canvas_pixel(canvas, x0 + sx, y0 - sy + i);
+                    canvas_pixel(canvas, x0 - sx, y0 - sy + i);
+                    canvas_pixel(canvas, x0 + sx, y0 + i);
+                    canvas_pixel(canvas, x0 - sx, y0 + i);
+                }
+            } else {
+                canvas_pixel(canvas, x0 + sx, y0 - sy);
+                canvas_pixel(canvas, x0 - sx, y0 - sy);
+                canvas_pixel(canvas, x0 + sx, y0 + sy);
+                canvas_pixel(canvas, x0 - sx, y0 + sy);
+            }
+        }
+        if(x >= y) {
+            break;
+        }
+        if(f >= 0) {
+            y--;
+            ddf_y += 2;
+            f += ddf_y;
+        }
+        x++;
+        ddf_x += 2;
+        f += ddf_x;
+    }
+}
+
+void canvas_draw_circle(Canvas* canvas, int32_t x, int32_t y, size_t radius) {
+    furi_check(canvas);
+    canvas_account(canvas, x - radius, y - radius, 2 * radius + 1, 2 * radius + 1);
+    canvas_draw_round(canvas, x, y, radius, false);
+}
+
+void canvas_draw_disc(Canvas* canvas, int32_t x, int32_t y, size_t radius) {
+    furi_check(canvas);
+    canvas_account(canvas, x - radius, y - radius, 2 * radius + 1, 2 * radius + 1);
+    canvas_draw_round(canvas, x, y, radius, true);
+}
@@ -0,0 +1,678 @@
+// For PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP
+#define _GNU_SOURCE
+
+#include "../host.h"
+#include <furi.h>
+#include <alloca.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <time.h>
+
+/*
+ * Threads, flags, mutexes, semaphores and queues on top of pthreads. Waits
+ * always use real time. The tick is a millisecond since start, unless a test
+ * stopped the clock with host_clock_set_manual.
+ */
+
+// Threads started through furi_thread_* paint the stack below their callback
+// before calling it, a little more than the size they were given, and report
+// how much of that size was never touched. Host code is bigger than the
+// firmware's and glibc is hungrier, so this errs on the side of too little
+// free. Other threads aren't measured, they report as much free as the app's
+// main thread has.
+#define HOST_FOREIGN_THREAD_STACK 2048
+#define HOST_STACK_PAINT_EXTRA    (16 * 1024)
+#define HOST_STACK_PAINT          0xA5
+
+#define HOST_FREE_HEAP (128 * 1024)
+
+#define HOST_FORMAT_SIZE 256
+
+struct FuriThread {
+    char name[32];
+    uint32_t stack_size;
+    FuriThreadCallback callback;
+    void* context;
+    pthread_t pthread;
+    uint8_t* stack_floor; // lowest painted byte, set by the thread
+    uint8_t* stack_entry; // where the callback started, set by the thread
+    bool started;
+    int32_t return_code;
+
+    pthread_mutex_t flags_lock;
+    pthread_cond_t flags_cond;
+    uint32_t flags;
+};
+
+struct FuriMutex {
+    pthread_mutex_t mutex;
+};
+
+struct FuriSemaphore {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t count;
+    uint32_t max_count;
+};
+
+struct FuriMessageQueue {
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    uint32_t msg_count;
+    uint32_t msg_size;
+    uint32_t head;
+    uint32_t count;
+    uint8_t* buffer;
+};
+
+static __thread FuriThread* furi_thread_current;
+static __thread uint32_t furi_log_lines;
+
+static pthread_once_t furi_host_once = PTHREAD_ONCE_INIT;
+static uint64_t furi_host_start_ms;
+static int furi_host_log_level; // 0 silent, 1 info, 2 debug
+
+static atomic_bool furi_clock_manual;
+static atomic_uint furi_clock_tick;
+static atomic_uint furi_threads_started;
+
+static pthread_mutex_t furi_critical_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+static void furi_host_init(void) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    furi_host_start_ms = (uint64_t)start.tv_sec * 1000 + start.tv_nsec / 1000000;
+    const char* level = getenv("HOST_LOG");
+    if(level) {
+        furi_host_log_level = strcmp(level, "debug") ? 1 : 2;
+    }
+}
+
+static void furi_cond_init(pthread_cond_t* cond) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+static void furi_deadline(uint32_t timeout_ms, struct timespec* deadline) {
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += timeout_ms / 1000;
+    deadline->tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if(deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
+
+// Waits on cond until the deadline. Returns false once it has passed.
+static bool furi_cond_wait(
+    pthread_cond_t* cond,
+    pthread_mutex_t* lock,
+    uint32_t timeout,
+    const struct timespec* deadline) {
+    if(timeout == FuriWaitForever) {
+        pthread_cond_wait(cond, lock);
+        return true;
+    }
+    return pthread_cond_timedwait(cond, lock, deadline) != ETIMEDOUT;
+}
+
+/* Checks and logging */
+
+static void furi_host_format(const char* format, char* host_format) {
+    size_t length = 0;
+    bool conversion = false;
+    for(const char* c = format; *c; c++) {
+        if(*c == '%') {
+            conversion = !conversion;
+        } else if(conversion && *c == 'l' && c[1] != 'l' && c[-1] != 'l') {
+            continue;
+        } else if(conversion && strchr("diouxXcsp", *c)) {
+            conversion = false;
+        }
+        furi_check(length + 1 < HOST_FORMAT_SIZE);
+        host_format[length++] = *c;
+    }
+    host_format[length] = '\0';
+}
+
+#undef snprintf
+
+int furi_host_snprintf(char* str, size_t size, const char* format, ...) {
+    char host_format[HOST_FORMAT_SIZE];
+    furi_host_format(format, host_format);
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(str, size, host_format, args);
+    va_end(args);
+    return length;
+}
+
+void furi_crash_host(const char* file, int line, const char* expression) {
+    fprintf(stderr, "furi_check failed: %s:%d: %s\n", file, line, expression);
+    abort();
+}
+
+// Like furi_log_print_format: whatever passes the level is formatted into one
+// heap buffer, the device's FuriString, printed or not.
+void furi_log_print_format_host(char level, const char* tag, const char* format, ...) {
+    pthread_once(&furi_host_once, furi_host_init);
+    if((level == 'D' || level == 'T') && furi_host_log_level < 2) {
+        return;
+    }
+
+    char host_format[HOST_FORMAT_SIZE];
+    furi_host_format(format, host_format);
+    va_list args;
+    va_start(args, format);
+    int size = vsnprintf(NULL, 0, host_format, args);
+    va_end(args);
+
+    char* message = malloc(size + 1);
+    furi_check(message);
+    va_start(args, format);
+    vsnprintf(message, size + 1, host_format, args);
+    va_end(args);
+
+    furi_log_lines++;
+    if(furi_host_log_level) {
+        // Not fprintf: on unbuffered stderr glibc formats into an 8 KiB buffer
+        // on the stack, which would swamp what the thread itself uses.
+        char prefix[48];
+        snprintf(prefix, sizeof(prefix), "%lu [%c]", (unsigned long)furi_get_tick(), level);
+        flockfile(stderr);
+        fputs(prefix, stderr);
+        fputc('[', stderr);
+        fputs(tag, stderr);
+        fputs("] ", stderr);
+        fputs(message, stderr);
+        fputc('\n', stderr);
+        funlockfile(stderr);
+    }
+    free(message);
+}
+
+uint32_t host_log_count_get(void) {
+    return furi_log_lines;
+}
+
+void furi_critical_enter_host(void) {
+    pthread_mutex_lock(&furi_critical_lock);
+}
+
+void furi_critical_exit_host(void) {
+    pthread_mutex_unlock(&furi_critical_lock);
+}
+
+/* Kernel */
+
+uint32_t furi_get_tick(void) {
+    pthread_once(&furi_host_once, furi_host_init);
+    if(atomic_load(&furi_clock_manual)) {
+        return atomic_load(&furi_clock_tick);
+    }
+    // Whole milliseconds of the clock the timer service runs on, so a timer
+    // never fires before the tick it was started for.
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)((uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000 - furi_host_start_ms);
+}
+
+void host_clock_set_manual(bool manual) {
+    if(manual) {
+        atomic_store(&furi_clock_tick, furi_get_tick());
+    }
+    atomic_store(&furi_clock_manual, manual);
+}
+
+void host_clock_set(uint32_t tick) {
+    atomic_store(&furi_clock_tick, tick);
+}
+
+void host_clock_advance(uint32_t ticks) {
+    atomic_fetch_add(&furi_clock_tick, ticks);
+}
+
+uint32_t furi_kernel_get_tick_frequency(void) {
+    return 1000;
+}
+
+uint32_t furi_ms_to_ticks(uint32_t milliseconds) {
+    return milliseconds;
+}
+
+void furi_delay_ms(uint32_t milliseconds) {
+    struct timespec delay = {
+        .tv_sec = milliseconds / 1000,
+        .tv_nsec = (long)(milliseconds % 1000) * 1000000L,
+    };
+    while(nanosleep(&delay, &delay) && errno == EINTR) {
+    }
+}
+
+void furi_delay_tick(uint32_t ticks) {
+    furi_delay_ms(ticks);
+}
+
+/* Threads */
+
+static FuriThread* furi_thread_record(const char* name, uint32_t stack_size) {
+    FuriThread* thread = calloc(1, sizeof(FuriThread));
+    furi_check(thread);
+    snprintf(thread->name, sizeof(thread->name), "%s", name);
+    thread->stack_size = stack_size;
+    pthread_mutex_init(&thread->flags_lock, NULL);
+    furi_cond_init(&thread->flags_cond);
+    return thread;
+}
+
+static FuriThread* furi_thread_self(void) {
+    if(!furi_thread_current) {
+        furi_thread_current = furi_thread_record("foreign", HOST_FOREIGN_THREAD_STACK);
+    }
+    return furi_thread_current;
+}
+
+// Paints a stretch of stack that the callback will reuse once this returns.
+static __attribute__((noinline)) uintptr_t furi_thread_paint(size_t length) {
+    uint8_t* area = alloca(length);
+    memset(area, HOST_STACK_PAINT, length);
+    __asm__ volatile("" : : "r"(area) : "memory");
+    return (uintptr_t)area;
+}
+
+static void* furi_thread_body(void* context) {
+    FuriThread* thread = context;
+    uint8_t entry;
+    thread->stack_floor = (uint8_t*)furi_thread_paint(thread->stack_size + HOST_STACK_PAINT_EXTRA);
+    __atomic_store_n(&thread->stack_entry, &entry, __ATOMIC_RELEASE);
+    furi_thread_current = thread;
+    thread->return_code = thread->callback(thread->context);
+    return NULL;
+}
+
+FuriThread* furi_thread_alloc_ex(
+    const char* name,
+    uint32_t stack_size,
+    FuriThreadCallback callback,
+    void* context) {
+    FuriThread* thread = furi_thread_record(name, stack_size);
+    thread->callback = callback;
+    thread->context = context;
+    return thread;
+}
+
+uint32_t host_thread_get_started(void) {
+    return atomic_load(&furi_threads_started);
+}
+
+void furi_thread_free(FuriThread* thread) {
+    furi_check(thread);
+    furi_check(!thread->started);
+    pthread_cond_destroy(&thread->flags_cond);
+    pthread_mutex_destroy(&thread->flags_lock);
+    free(thread);
+}
+
+void furi_thread_start(FuriThread* thread) {
+    furi_check(thread);
+    furi_check(!thread->started);
+    thread->started = true;
+    atomic_fetch_add(&furi_threads_started, 1);
+    thread->stack_entry = NULL;
+    furi_check(pthread_create(&thread->pthread, NULL, furi_thread_body, thread) == 0);
+}
+
+bool furi_thread_join(FuriThread* thread) {
+    furi_check(thread);
+    furi_check(thread != furi_thread_current);
+    if(thread->started) {
+        pthread_join(thread->pthread, NULL);
+        thread->started = false;
+        thread->stack_entry = NULL; // the stack is gone
+    }
+    return true;
+}
+
+int32_t furi_thread_get_return_code(FuriThread* thread) {
+    return thread->return_code;
+}
+
+void furi_thread_set_priority(FuriThread* thread, FuriThreadPriority priority) {
+    UNUSED(thread);
+    UNUSED(priority);
+}
+
+FuriThreadId furi_thread_get_id(FuriThread* thread) {
+    return thread;
+}
+
+FuriThreadId furi_thread_get_current_id(void) {
+    return furi_thread_self();
+}
+
+// Reads the stack of a thread that may be running, the same as the firmware's
+// high water mark does. Only the paint is looked at, TSan needn't see it.
+__attribute__((no_sanitize_thread)) uint32_t furi_thread_get_stack_space(FuriThreadId thread_id) {
+    FuriThread* thread = thread_id;
+    if(!thread) {
+        return 0;
+    }
+    uint8_t* entry = __atomic_load_n(&thread->stack_entry, __ATOMIC_ACQUIRE);
+    if(!entry) {
+        return thread->stack_size;
+    }
+    uint8_t* lowest = thread->stack_floor;
+    while(lowest < entry && *lowest == HOST_STACK_PAINT) {
+        lowest++;
+    }
+    size_t used = entry - lowest;
+    return used < thread->stack_size ? thread->stack_size - used : 0;
+}
+
+uint32_t furi_thread_flags_set(FuriThreadId thread_id, uint32_t flags) {
+    FuriThread* thread = thread_id;
+    if(!thread || (flags & FuriFlagError)) {
+        return FuriFlagErrorParameter;
+    }
+    pthread_mutex_lock(&thread->flags_lock);
+    thread->flags |= flags;
+    uint32_t result = thread->flags;
+    pthread_cond_broadcast(&thread->flags_cond);
+    pthread_mutex_unlock(&thread->flags_lock);
+    return result;
+}
+
+uint32_t furi_thread_flags_clear(uint32_t flags) {
+    FuriThread* thread = furi_thread_self();
+    pthread_mutex_lock(&thread->flags_lock);
+    uint32_t result = thread->flags;
+    thread->flags &= ~flags;
+    pthread_mutex_unlock(&thread->flags_lock);
+    return result;
+}
+
+uint32_t furi_thread_flags_get(void) {
+    FuriThread* thread = furi_thread_self();
+    pthread_mutex_lock(&thread->flags_lock);
+    uint32_t result = thread->flags;
+    pthread_mutex_unlock(&thread->flags_lock);
+    return result;
+}
+
+uint32_t furi_thread_flags_wait(uint32_t flags, uint32_t options, uint32_t timeout) {
+    if(flags & FuriFlagError) {
+        return FuriFlagErrorParameter;
+    }
+
+    FuriThread* thread = furi_thread_self();
+    struct timespec deadline;
+    furi_deadline(timeout, &deadline);
+
+    pthread_mutex_lock(&thread->flags_lock);
+    uint32_t result;
+    for(;;) {
+        uint32_t set = thread->flags & flags;
+        if((options & FuriFlagWaitAll) ? set == flags : set != 0) {
+            // Like the firmware, everything set so far is returned and only
+            // the flags waited for are cleared.
+            result = thread->flags;
+            if(!(options & FuriFlagNoClear)) {
+                thread->flags &= ~flags;
+            }
+            break;
+        }
+        if(timeout == 0) {
+            result = FuriFlagErrorResource;
+            break;
+        }
+        if(!furi_cond_wait(&thread->flags_cond, &thread->flags_lock, timeout, &deadline)) {
+            result = FuriFlagErrorTimeout;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&thread->flags_lock);
+    return result;
+}
+
+/* Mutexes */
+
+FuriMutex* furi_mutex_alloc(FuriMutexType type) {
+    FuriMutex* instance = malloc(sizeof(FuriMutex));
+    furi_check(instance);
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(
+        &attr,
+        type == FuriMutexTypeRecursive ? PTHREAD_MUTEX_RECURSIVE : PTHREAD_MUTEX_ERRORCHECK);
+    pthread_mutex_init(&instance->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    return instance;
+}
+
+void furi_mutex_free(FuriMutex* instance) {
+    furi_check(instance);
+    furi_check(pthread_mutex_destroy(&instance->mutex) == 0);
+    free(instance);
+}
+
+FuriStatus furi_mutex_acquire(FuriMutex* instance, uint32_t timeout) {
+    furi_check(instance);
+    int error;
+    if(timeout == FuriWaitForever) {
+        error = pthread_mutex_lock(&instance->mutex);
+    } else if(timeout == 0) {
+        error = pthread_mutex_trylock(&instance->mutex);
+    } else {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += timeout / 1000;
+        deadline.tv_nsec += (long)(timeout % 1000) * 1000000L;
+        if(deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        error = pthread_mutex_timedlock(&instance->mutex, &deadline);
+    }
+    // A non-recursive mutex taken twice by the same thread deadlocks on the
+    // device, so it is a test failure here.
+    furi_check(error != EDEADLK);
+    if(error) {
+        return timeout == 0 ? FuriStatusErrorResource : FuriStatusErrorTimeout;
+    }
+    return FuriStatusOk;
+}
+
+FuriStatus furi_mutex_release(FuriMutex* instance) {
+    furi_check(instance);
+    furi_check(pthread_mutex_unlock(&instance->mutex) == 0);
+    return FuriStatusOk;
+}
+
+/* Semaphores */
+
+FuriSemaphore* furi_semaphore_alloc(uint32_t max_count, uint32_t initial_count) {
+    furi_check(max_count && initial_count <= max_count);
+    FuriSemaphore* instance = malloc(sizeof(FuriSemaphore));
+    furi_check(instance);
+    pthread_mutex_init(&instance->lock, NULL);
+    furi_cond_init(&instance->cond);
+    instance->count = initial_count;
+    instance->max_count = max_count;
+    return instance;
+}
+
+void furi_semaphore_free(FuriSemaphore* instance) {
+    furi_check(instance);
+    pthread_cond_destroy(&instance->cond);
+    pthread_mutex_destroy(&instance->lock);
+    free(instance);
+}
+
+FuriStatus furi_semaphore_acquire(FuriSemaphore* instance, uint32_t timeout) {
+    furi_check(instance);
+    struct timespec deadline;
+    furi_deadline(timeout, &deadline);
+
+    FuriStatus status = FuriStatusOk;
+    pthread_mutex_lock(&instance->lock);
+    while(!instance->count) {
+        if(timeout == 0) {
+            status = FuriStatusErrorResource;
+            break;
+        }
+        if(!furi_cond_wait(&instance->cond, &instance->lock, timeout, &deadline)) {
+            status = FuriStatusErrorTimeout;
+            break;
+        }
+    }
+    if(status == FuriStatusOk) {
+        instance->count--;
+    }
+    pthread_mutex_unlock(&instance->lock);
+    return status;
+}
+
+FuriStatus furi_semaphore_release(FuriSemaphore* instance) {
+    furi_check(instance);
+    FuriStatus status = FuriStatusOk;
+    pthread_mutex_lock(&instance->lock);
+    if(instance->count < instance->max_count) {
+        instance->count++;
+        pthread_cond_signal(&instance->cond);
+    } else {
+        status = FuriStatusErrorResource;
+    }
+    pthread_mutex_unlock(&instance->lock);
+    return status;
+}
+
+uint32_t furi_semaphore_get_count(FuriSemaphore* instance) {
+    furi_check(instance);
+    pthread_mutex_lock(&instance->lock);
+    uint32_t count = instance->count;
+    pthread_mutex_unlock(&instance->lock);
+    return count;
+}
+
+/* Message queues */
+
+FuriMessageQueue* furi_message_queue_alloc(uint32_t msg_count, uint32_t msg_size) {
+    furi_check(msg_count && msg_size);
+    FuriMessageQueue* instance = calloc(1, sizeof(FuriMessageQueue));
+    furi_check(instance);
+    instance->buffer = malloc(msg_count * msg_size);
+    furi_check(instance->buffer);
+    instance->msg_count = msg_count;
+    instance->msg_size = msg_size;
+    pthread_mutex_init(&instance->lock, NULL);
+    furi_cond_init(&instance->not_empty);
+    furi_cond_init(&instance->not_full);
+    return instance;
+}
+
+void furi_message_queue_free(FuriMessageQueue* instance) {
+    furi_check(instance);
+    pthread_cond_destroy(&instance->not_full);
+    pthread_cond_destroy(&instance->not_empty);
+    pthread_mutex_destroy(&instance->lock);
+    free(instance->buffer);
+    free(instance);
+}
+
+FuriStatus
+    furi_message_queue_put(FuriMessageQueue* instance, const void* msg_ptr, uint32_t timeout) {
+    furi_check(instance && msg_ptr);
+    struct timespec deadline;
+    furi_deadline(timeout, &deadline);
+
+    FuriStatus status = FuriStatusOk;
+    pthread_mutex_lock(&instance->lock);
+    while(instance->count == instance->msg_count) {
+        if(timeout == 0) {
+            status = FuriStatusErrorResource;
+            break;
+        }
+        if(!furi_cond_wait(&instance->not_full, &instance->lock, timeout, &deadline)) {
+            status = FuriStatusErrorTimeout;
+            break;
+        }
+    }
+    if(status == FuriStatusOk) {
+        uint32_t tail = (instance->head + instance->count) % instance->msg_count;
+        memcpy(instance->buffer + tail * instance->msg_size, msg_ptr, instance->msg_size);
+        instance->count++;
+        pthread_cond_signal(&instance->not_empty);
+    }
+    pthread_mutex_unlock(&instance->lock);
+    return status;
+}
+
+FuriStatus furi_message_queue_get(FuriMessageQueue* instance, void* msg_ptr, uint32_t timeout) {
+    furi_check(instance && msg_ptr);
+    struct timespec deadline;
+    furi_deadline(timeout, &deadline);
+
+    FuriStatus status = FuriStatusOk;
+    pthread_mutex_lock(&instance->lock);
+    while(!instance->count) {
+        if(timeout == 0) {
+            status = FuriStatusErrorResource;
+            break;
+        }
+        if(!furi_cond_wait(&instance->not_empty, &instance->lock, timeout, &deadline)) {
+            status = FuriStatusErrorTimeout;
+            break;
+        }
+    }
+    if(status == FuriStatusOk) {
+        memcpy(
+            msg_ptr, instance->buffer + instance->head * instance->msg_size, instance->msg_size);
+        instance->head = (instance->head + 1) % instance->msg_count;
+        instance->count--;
+        pthread_cond_signal(&instance->not_full);
+    }
+    pthread_mutex_unlock(&instance->lock);
+    return status;
+}
+
+uint32_t furi_message_queue_get_capacity(FuriMessageQueue* instance) {
+    furi_check(instance);
+    return instance->msg_count;
+}
+
+uint32_t furi_message_queue_get_count(FuriMessageQueue* instance) {
+    furi_check(instance);
+    pthread_mutex_lock(&instance->lock);
+    uint32_t count = instance->count;
+    pthread_mutex_unlock(&instance->lock);
+    return count;
+}
+
+/* Records and memory */
+
+// Every record is owned by one of the host modules, which keep their state in
+// globals, so the handle only has to be non-NULL.
+static char furi_record_handle;
+
+void* furi_record_open(const char* name) {
+    UNUSED(name);
+    return &furi_record_handle;
+}
+
+void furi_record_close(const char* name) {
+    UNUSED(name);
+}
+
+size_t memmgr_get_free_heap(void) {
+    return HOST_FREE_HEAP;
+}
+
+size_t memmgr_get_minimum_free_heap(void) {
+    return HOST_FREE_HEAP;
+}
@@ -0,0 +1,62 @@
+#include "../host.h"
+#include <furi_hal.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#define HOST_CORTEX_MHZ 64
+
+const GpioPin gpio_ext_pa7 = {.name = "PA7"};
+
+static atomic_bool furi_hal_infrared_board;
+
+static const uint8_t furi_hal_version_host_uid[] =
+    {0x48, 0x4f, 0x53, 0x54, 0x00, 0x00, 0x00, 0x01};
+
+static __thread DWT_Type furi_hal_cortex_dwt;
+
+void furi_hal_gpio_init(const GpioPin* gpio, GpioMode mode, GpioPull pull, GpioSpeed speed) {
+    UNUSED(gpio);
+    UNUSED(mode);
+    UNUSED(pull);
+    UNUSED(speed);
+}
+
+FuriHalInfraredTxPin furi_hal_infrared_detect_tx_output(void) {
+    return atomic_load(&furi_hal_infrared_board) ? FuriHalInfraredTxPinExtPA7 :
+                                                   FuriHalInfraredTxPinInternal;
+}
+
+void furi_hal_infrared_set_tx_output(FuriHalInfraredTxPin tx_pin) {
+    furi_check(tx_pin < FuriHalInfraredTxPinMax);
+}
+
+void host_infrared_set_board(bool connected) {
+    atomic_store(&furi_hal_infrared_board, connected);
+}
+
+void furi_hal_power_enable_otg(void) {
+}
+
+void furi_hal_power_disable_otg(void) {
+}
+
+const uint8_t* furi_hal_version_uid(void) {
+    return furi_hal_version_host_uid;
+}
+
+size_t furi_hal_version_uid_size(void) {
+    return sizeof(furi_hal_version_host_uid);
+}
+
+DWT_Type* furi_hal_cortex_dwt_host(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    furi_hal_cortex_dwt.CYCCNT =
+        (uint32_t)((uint64_t)now.tv_sec * HOST_CORTEX_MHZ * 1000000 +
+                   (uint64_t)now.tv_nsec * HOST_CORTEX_MHZ / 1000);
+    return &furi_hal_cortex_dwt;
+}
+
+uint32_t furi_hal_cortex_instructions_per_microsecond(void) {
+    return HOST_CORTEX_MHZ;
+}
@@ -0,0 +1,220 @@
+#include <furi.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+
+/*
+ * Timers and pending callbacks all run on one daemon thread, in the order
+ * they come due, like the FreeRTOS timer service task. Stopping or freeing a
+ * timer from another thread waits for its callback to return, the firmware
+ * gets the same from handing the command to the daemon.
+ */
+
+#define FURI_TIMER_PENDING_SIZE 32
+
+struct FuriTimer {
+    FuriTimerCallback callback;
+    FuriTimerType type;
+    void* context;
+    bool running;
+    uint32_t period;
+    uint64_t due_ms;
+    FuriTimer* next;
+};
+
+typedef struct {
+    FuriTimerPendigCallback callback;
+    void* context;
+    uint32_t arg;
+} FuriTimerPending;
+
+static pthread_once_t furi_timer_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t furi_timer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t furi_timer_wake;
+static pthread_cond_t furi_timer_done;
+static FuriThread* furi_timer_thread;
+static FuriTimer* furi_timer_active;
+static FuriTimer* furi_timer_in_callback;
+static FuriTimerPending furi_timer_pending[FURI_TIMER_PENDING_SIZE];
+static uint32_t furi_timer_pending_head;
+static uint32_t furi_timer_pending_count;
+
+static uint64_t furi_timer_now_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static void furi_timer_unlink(FuriTimer* instance) {
+    for(FuriTimer** link = &furi_timer_active; *link; link = &(*link)->next) {
+        if(*link == instance) {
+            *link = instance->next;
+            break;
+        }
+    }
+    instance->next = NULL;
+}
+
+// Called with the lock held, drops it while a callback runs.
+static void furi_timer_run_due(void) {
+    while(furi_timer_pending_count) {
+        FuriTimerPending pending = furi_timer_pending[furi_timer_pending_head];
+        furi_timer_pending_head = (furi_timer_pending_head + 1) % FURI_TIMER_PENDING_SIZE;
+        furi_timer_pending_count--;
+        pthread_cond_broadcast(&furi_timer_done);
+        pthread_mutex_unlock(&furi_timer_lock);
+        pending.callback(pending.context, pending.arg);
+        pthread_mutex_lock(&furi_timer_lock);
+    }
+
+    uint64_t now = furi_timer_now_ms();
+    FuriTimer* due = NULL;
+    for(FuriTimer* timer = furi_timer_active; timer; timer = timer->next) {
+        if(timer->due_ms <= now && (!due || timer->due_ms < due->due_ms)) {
+            due = timer;
+        }
+    }
+    if(!due) {
+        return;
+    }
+
+    if(due->type == FuriTimerTypePeriodic) {
+        due->due_ms += due->period;
+    } else {
+        due->running = false;
+        furi_timer_unlink(due);
+    }
+    furi_timer_in_callback = due;
+    pthread_mutex_unlock(&furi_timer_lock);
+    due->callback(due->context);
+    pthread_mutex_lock(&furi_timer_lock);
+    furi_timer_in_callback = NULL;
+    pthread_cond_broadcast(&furi_timer_done);
+}
+
+static int32_t furi_timer_service(void* context) {
+    UNUSED(context);
+    pthread_mutex_lock(&furi_timer_lock);
+    for(;;) {
+        furi_timer_run_due();
+        if(furi_timer_pending_count) {
+            continue;
+        }
+
+        uint64_t next = UINT64_MAX;
+        for(FuriTimer* timer = furi_timer_active; timer; timer = timer->next) {
+            next = MIN(next, timer->due_ms);
+        }
+        if(next == UINT64_MAX) {
+            pthread_cond_wait(&furi_timer_wake, &furi_timer_lock);
+        } else if(next > furi_timer_now_ms()) {
+            struct timespec deadline = {
+                .tv_sec = next / 1000,
+                .tv_nsec = (long)(next % 1000) * 1000000L,
+            };
+            pthread_cond_timedwait(&furi_timer_wake, &furi_timer_lock, &deadline);
+        }
+    }
+    return 0;
+}
+
+static void furi_timer_init(void) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&furi_timer_wake, &attr);
+    pthread_cond_init(&furi_timer_done, &attr);
+    pthread_condattr_destroy(&attr);
+
+    furi_timer_thread = furi_thread_alloc_ex("TimerSvc", 1024, furi_timer_service, NULL);
+    furi_thread_start(furi_timer_thread);
+}
+
+static bool furi_timer_on_daemon(void) {
+    return furi_thread_get_current_id() == furi_thread_get_id(furi_timer_thread);
+}
+
+// Called with the lock held.
+static void furi_timer_wait_callback(FuriTimer* instance) {
+    if(furi_timer_on_daemon()) {
+        return;
+    }
+    while(furi_timer_in_callback == instance) {
+        pthread_cond_wait(&furi_timer_done, &furi_timer_lock);
+    }
+}
+
+FuriTimer* furi_timer_alloc(FuriTimerCallback func, FuriTimerType type, void* context) {
+    furi_check(func);
+    pthread_once(&furi_timer_once, furi_timer_init);
+    FuriTimer* instance = calloc(1, sizeof(FuriTimer));
+    furi_check(instance);
+    instance->callback = func;
+    instance->type = type;
+    instance->context = context;
+    return instance;
+}
+
+void furi_timer_free(FuriTimer* instance) {
+    furi_check(instance);
+    pthread_mutex_lock(&furi_timer_lock);
+    instance->running = false;
+    furi_timer_unlink(instance);
+    furi_timer_wait_callback(instance);
+    pthread_mutex_unlock(&furi_timer_lock);
+    free(instance);
+}
+
+FuriStatus furi_timer_start(FuriTimer* instance, uint32_t ticks) {
+    furi_check(instance);
+    furi_check(ticks < INT32_MAX);
+    pthread_mutex_lock(&furi_timer_lock);
+    if(!instance->running) {
+        instance->running = true;
+        instance->next = furi_timer_active;
+        furi_timer_active = instance;
+    }
+    instance->period = ticks;
+    instance->due_ms = furi_timer_now_ms() + ticks;
+    pthread_cond_signal(&furi_timer_wake);
+    pthread_mutex_unlock(&furi_timer_lock);
+    return FuriStatusOk;
+}
+
+FuriStatus furi_timer_restart(FuriTimer* instance, uint32_t ticks) {
+    return furi_timer_start(instance, ticks);
+}
+
+FuriStatus furi_timer_stop(FuriTimer* instance) {
+    furi_check(instance);
+    pthread_mutex_lock(&furi_timer_lock);
+    instance->running = false;
+    furi_timer_unlink(instance);
+    furi_timer_wait_callback(instance);
+    pthread_mutex_unlock(&furi_timer_lock);
+    return FuriStatusOk;
+}
+
+uint32_t furi_timer_is_running(FuriTimer* instance) {
+    furi_check(instance);
+    pthread_mutex_lock(&furi_timer_lock);
+    bool running = instance->running;
+    pthread_mutex_unlock(&furi_timer_lock);
+    return running;
+}
+
+void furi_timer_pending_callback(FuriTimerPendigCallback callback, void* context, uint32_t arg) {
+    furi_check(callback);
+    pthread_once(&furi_timer_once, furi_timer_init);
+    pthread_mutex_lock(&furi_timer_lock);
+    // Like a full timer command queue, this blocks until the daemon catches up.
+    while(furi_timer_pending_count == FURI_TIMER_PENDING_SIZE) {
+        pthread_cond_wait(&furi_timer_done, &furi_timer_lock);
+    }
+    uint32_t tail =
+        (furi_timer_pending_head + furi_timer_pending_count) % FURI_TIMER_PENDING_SIZE;
+    furi_timer_pending[tail] = (FuriTimerPending){callback, context, arg};
+    furi_timer_pending_count++;
+    pthread_cond_signal(&furi_timer_wake);
+    pthread_mutex_unlock(&furi_timer_lock);
+}
@@ -0,0 +1,305 @@
+#include "../host.h"
+#include <gui/gui.h>
+#include <gui/view.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+/*
+ * One view port at a time, which is all the app uses. Like the GUI service,
+ * the GUI thread draws it under its mutex after view_port_update and calls
+ * its input callback under the same mutex. gui_remove_view_port waits for a
+ * draw in progress. view_port_update takes no lock, so it can be called with
+ * any lock held that the draw callback also takes.
+ */
+
+#define GUI_THREAD_FLAG_DRAW  (1 << 0)
+#define GUI_THREAD_FLAG_INPUT (1 << 1)
+#define GUI_THREAD_FLAG_EXIT  (1 << 2)
+#define GUI_THREAD_FLAG_ALL   0x7
+
+#define GUI_INPUT_QUEUE_SIZE 16
+
+struct ViewPort {
+    pthread_mutex_t mutex;
+    bool enabled;
+    ViewPortDrawCallback draw_callback;
+    void* draw_callback_context;
+    ViewPortInputCallback input_callback;
+    void* input_callback_context;
+};
+
+struct View {
+    ViewDrawCallback draw_callback;
+    ViewInputCallback input_callback;
+    void* context;
+    ViewModelType model_type;
+    pthread_mutex_t model_mutex;
+    void* model;
+};
+
+static pthread_mutex_t gui_lock = PTHREAD_MUTEX_INITIALIZER;
+static ViewPort* _Atomic gui_view_port;
+static FuriThread* _Atomic gui_thread;
+static FuriMessageQueue* gui_input_queue;
+static Canvas* gui_canvas;
+static uint32_t gui_frames;
+static uint32_t gui_off_screen;
+static uint32_t gui_input_sequence;
+
+/* ViewPort */
+
+ViewPort* view_port_alloc(void) {
+    ViewPort* view_port = calloc(1, sizeof(ViewPort));
+    furi_check(view_port);
+    pthread_mutex_init(&view_port->mutex, NULL);
+    view_port->enabled = true;
+    return view_port;
+}
+
+void view_port_free(ViewPort* view_port) {
+    furi_check(view_port);
+    pthread_mutex_lock(&gui_lock);
+    furi_check(gui_view_port != view_port);
+    pthread_mutex_unlock(&gui_lock);
+    pthread_mutex_destroy(&view_port->mutex);
+    free(view_port);
+}
+
+void view_port_enabled_set(ViewPort* view_port, bool enabled) {
+    furi_check(view_port);
+    pthread_mutex_lock(&view_port->mutex);
+    view_port->enabled = enabled;
+    pthread_mutex_unlock(&view_port->mutex);
+    view_port_update(view_port);
+}
+
+bool view_port_is_enabled(const ViewPort* view_port) {
+    furi_check(view_port);
+    pthread_mutex_lock((pthread_mutex_t*)&view_port->mutex);
+    bool enabled = view_port->enabled;
+    pthread_mutex_unlock((pthread_mutex_t*)&view_port->mutex);
+    return enabled;
+}
+
+void view_port_draw_callback_set(
+    ViewPort* view_port,
+    ViewPortDrawCallback callback,
+    void* context) {
+    furi_check(view_port);
+    pthread_mutex_lock(&view_port->mutex);
+    view_port->draw_callback = callback;
+    view_port->draw_callback_context = context;
+    pthread_mutex_unlock(&view_port->mutex);
+}
+
+void view_port_input_callback_set(
+    ViewPort* view_port,
+    ViewPortInputCallback callback,
+    void* context) {
+    furi_check(view_port);
+    pthread_mutex_lock(&view_port->mutex);
+    view_port->input_callback = callback;
+    view_port->input_callback_context = context;
+    pthread_mutex_unlock(&view_port->mutex);
+}
+
+void view_port_update(ViewPort* view_port) {
+    furi_check(view_port);
+    FuriThread* thread = atomic_load(&gui_thread);
+    if(thread && atomic_load(&gui_view_port) == view_port) {
+        furi_thread_flags_set(furi_thread_get_id(thread), GUI_THREAD_FLAG_DRAW);
+    }
+}
+
+static void view_port_input(ViewPort* view_port, InputEvent* event) {
+    pthread_mutex_lock(&view_port->mutex);
+    if(view_port->enabled && view_port->input_callback) {
+        view_port->input_callback(event, view_port->input_callback_context);
+    }
+    pthread_mutex_unlock(&view_port->mutex);
+}
+
+/* Gui */
+
+void gui_add_view_port(Gui* gui, ViewPort* view_port, GuiLayer layer) {
+    UNUSED(gui);
+    furi_check(view_port);
+    furi_check(layer < GuiLayerMAX);
+    pthread_mutex_lock(&gui_lock);
+    furi_check(!gui_view_port);
+    gui_view_port = view_port;
+    pthread_mutex_unlock(&gui_lock);
+    view_port_update(view_port);
+}
+
+void gui_remove_view_port(Gui* gui, ViewPort* view_port) {
+    UNUSED(gui);
+    furi_check(view_port);
+    // The GUI thread holds the lock while it draws.
+    pthread_mutex_lock(&gui_lock);
+    furi_check(gui_view_port == view_port);
+    gui_view_port = NULL;
+    pthread_mutex_unlock(&gui_lock);
+}
+
+static void gui_draw(void) {
+    pthread_mutex_lock(&gui_lock);
+    ViewPort* view_port = gui_view_port;
+    if(view_port) {
+        pthread_mutex_lock(&view_port->mutex);
+        if(view_port->enabled && view_port->draw_callback) {
+            host_canvas_reset(gui_canvas);
+            host_canvas_reset_stats(gui_canvas);
+            view_port->draw_callback(gui_canvas, view_port->draw_callback_context);
+            gui_frames++;
+            gui_off_screen += host_canvas_get_stats(gui_canvas)->off_screen;
+        }
+        pthread_mutex_unlock(&view_port->mutex);
+    }
+    pthread_mutex_unlock(&gui_lock);
+}
+
+static int32_t gui_thread_body(void* context) {
+    UNUSED(context);
+    for(;;) {
+        uint32_t flags =
+            furi_thread_flags_wait(GUI_THREAD_FLAG_ALL, FuriFlagWaitAny, FuriWaitForever);
+        if(flags & GUI_THREAD_FLAG_INPUT) {
+            InputEvent event;
+            while(furi_message_queue_get(gui_input_queue, &event, 0) == FuriStatusOk) {
+                pthread_mutex_lock(&gui_lock);
+                if(gui_view_port) {
+                    view_port_input(gui_view_port, &event);
+                }
+                pthread_mutex_unlock(&gui_lock);
+            }
+        }
+        if(flags & GUI_THREAD_FLAG_DRAW) {
+            gui_draw();
+        }
+        if(flags & GUI_THREAD_FLAG_EXIT) {
+            break;
+        }
+    }
+    return 0;
+}
+
+void host_gui_start(void) {
+    furi_check(!gui_thread);
+    gui_canvas = host_canvas_alloc();
+    gui_input_queue = furi_message_queue_alloc(GUI_INPUT_QUEUE_SIZE, sizeof(InputEvent));
+    FuriThread* thread = furi_thread_alloc_ex("GuiSrv", 2048, gui_thread_body, NULL);
+    furi_thread_start(thread);
+    pthread_mutex_lock(&gui_lock);
+    gui_thread = thread;
+    pthread_mutex_unlock(&gui_lock);
+}
+
+void host_gui_stop(void) {
+    furi_check(gui_thread);
+    pthread_mutex_lock(&gui_lock);
+    FuriThread* thread = gui_thread;
+    gui_thread = NULL;
+    pthread_mutex_unlock(&gui_lock);
+
+    furi_thread_flags_set(furi_thread_get_id(thread), GUI_THREAD_FLAG_EXIT);
+    furi_thread_join(thread);
+    furi_thread_free(thread);
+    furi_message_queue_free(gui_input_queue);
+    gui_input_queue = NULL;
+    host_canvas_free(gui_canvas);
+    gui_canvas = NULL;
+}
+
+void host_gui_send_input(InputKey key, InputType type) {
+    pthread_mutex_lock(&gui_lock);
+    InputEvent event = {.sequence = ++gui_input_sequence, .key = key, .type = type};
+    FuriThread* thread = gui_thread;
+    ViewPort* view_port = gui_view_port;
+    pthread_mutex_unlock(&gui_lock);
+
+    if(thread) {
+        furi_check(
+            furi_message_queue_put(gui_input_queue, &event, FuriWaitForever) == FuriStatusOk);
+        furi_thread_flags_set(furi_thread_get_id(thread), GUI_THREAD_FLAG_INPUT);
+    } else if(view_port) {
+        view_port_input(view_port, &event);
+    }
+}
+
+uint32_t host_gui_get_frames(void) {
+    pthread_mutex_lock(&gui_lock);
+    uint32_t frames = gui_frames;
+    pthread_mutex_unlock(&gui_lock);
+    return frames;
+}
+
+uint32_t host_gui_get_off_screen(void) {
+    pthread_mutex_lock(&gui_lock);
+    uint32_t off_screen = gui_off_screen;
+    pthread_mutex_unlock(&gui_lock);
+    return off_screen;
+}
+
+/* View */
+
+View* view_alloc(void) {
+    View* view = calloc(1, sizeof(View));
+    furi_check(view);
+    pthread_mutex_init(&view->model_mutex, NULL);
+    return view;
+}
+
+void view_free(View* view) {
+    furi_check(view);
+    view_free_model(view);
+    pthread_mutex_destroy(&view->model_mutex);
+    free(view);
+}
+
+void view_set_context(View* view, void* context) {
+    furi_check(view);
+    view->context = context;
+}
+
+void view_set_draw_callback(View* view, ViewDrawCallback callback) {
+    furi_check(view);
+    view->draw_callback = callback;
+}
+
+void view_set_input_callback(View* view, ViewInputCallback callback) {
+    furi_check(view);
+    view->input_callback = callback;
+}
+
+void view_allocate_model(View* view, ViewModelType type, size_t size) {
+    furi_check(view);
+    furi_check(!view->model && type != ViewModelTypeNone);
+    view->model_type = type;
+    view->model = calloc(1, size);
+    furi_check(view->model);
+}
+
+void view_free_model(View* view) {
+    furi_check(view);
+    free(view->model);
+    view->model = NULL;
+    view->model_type = ViewModelTypeNone;
+}
+
+void* view_get_model(View* view) {
+    furi_check(view);
+    if(view->model_type == ViewModelTypeLocking) {
+        pthread_mutex_lock(&view->model_mutex);
+    }
+    return view->model;
+}
+
+// Nothing to redraw here, the view isn't in a dispatcher.
+void view_commit_model(View* view, bool update) {
+    furi_check(view);
+    UNUSED(update);
+    if(view->model_type == ViewModelTypeLocking) {
+        pthread_mutex_unlock(&view->model_mutex);
+    }
+}
@@ -0,0 +1,192 @@
+#include "../host.h"
+#include <infrared_worker.h>
+#include <infrared_signal.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+/*
+ * Decoded frames instead of timings. While RX is started, the worker thread
+ * hands every frame passed to host_infrared_inject to the callback, and
+ * stopping RX joins it and drops what wasn't delivered yet, like the
+ * firmware worker resetting its stream buffer. Transmitting only counts.
+ */
+
+#define INFRARED_WORKER_QUEUE_SIZE 16
+
+#define INFRARED_WORKER_FLAG_RX   (1 << 0)
+#define INFRARED_WORKER_FLAG_EXIT (1 << 1)
+
+struct InfraredWorkerSignal {
+    InfraredMessage message;
+    bool decoded;
+};
+
+struct InfraredWorker {
+    FuriThread* thread;
+    FuriMessageQueue* queue;
+    InfraredWorkerReceivedSignalCallback callback;
+    void* context;
+    InfraredWorkerSignal signal;
+};
+
+struct InfraredSignal {
+    InfraredMessage message;
+};
+
+static const struct {
+    uint8_t address_length;
+    uint8_t command_length;
+} infrared_protocol_lengths[InfraredProtocolMAX] = {
+    [InfraredProtocolNEC] = {8, 8},
+    [InfraredProtocolNECext] = {16, 16},
+    [InfraredProtocolNEC42] = {13, 8},
+    [InfraredProtocolNEC42ext] = {26, 16},
+    [InfraredProtocolSamsung32] = {8, 8},
+    [InfraredProtocolRC6] = {8, 8},
+    [InfraredProtocolRC5] = {5, 6},
+    [InfraredProtocolRC5X] = {5, 7},
+    [InfraredProtocolSIRC] = {5, 7},
+    [InfraredProtocolSIRC15] = {8, 7},
+    [InfraredProtocolSIRC20] = {13, 7},
+    [InfraredProtocolKaseikyo] = {26, 10},
+    [InfraredProtocolRCA] = {4, 8},
+    [InfraredProtocolPioneer] = {8, 8},
+};
+
+// The worker that is receiving, the app only ever has one.
+static pthread_mutex_t infrared_worker_lock = PTHREAD_MUTEX_INITIALIZER;
+static InfraredWorker* infrared_worker_receiving;
+static atomic_uint infrared_signal_sent;
+
+uint8_t infrared_get_protocol_address_length(InfraredProtocol protocol) {
+    furi_check(protocol > InfraredProtocolUnknown && protocol < InfraredProtocolMAX);
+    return infrared_protocol_lengths[protocol].address_length;
+}
+
+uint8_t infrared_get_protocol_command_length(InfraredProtocol protocol) {
+    furi_check(protocol > InfraredProtocolUnknown && protocol < InfraredProtocolMAX);
+    return infrared_protocol_lengths[protocol].command_length;
+}
+
+static int32_t infrared_worker_rx_thread(void* context) {
+    InfraredWorker* instance = context;
+    for(;;) {
+        uint32_t flags = furi_thread_flags_wait(
+            INFRARED_WORKER_FLAG_RX | INFRARED_WORKER_FLAG_EXIT, FuriFlagWaitAny, FuriWaitForever);
+        if(flags & INFRARED_WORKER_FLAG_EXIT) {
+            break;
+        }
+        while(furi_message_queue_get(instance->queue, &instance->signal.message, 0) ==
+              FuriStatusOk) {
+            instance->signal.decoded = true;
+            if(instance->callback) {
+                instance->callback(instance->context, &instance->signal);
+            }
+            uint32_t exit = furi_thread_flags_wait(INFRARED_WORKER_FLAG_EXIT, FuriFlagWaitAny, 0);
+            if(!(exit & FuriFlagError)) {
+                return 0;
+            }
+        }
+    }
+    return 0;
+}
+
+InfraredWorker* infrared_worker_alloc(void) {
+    InfraredWorker* instance = calloc(1, sizeof(InfraredWorker));
+    furi_check(instance);
+    instance->thread =
+        furi_thread_alloc_ex("InfraredWorker", 2048, infrared_worker_rx_thread, instance);
+    instance->queue =
+        furi_message_queue_alloc(INFRARED_WORKER_QUEUE_SIZE, sizeof(InfraredMessage));
+    return instance;
+}
+
+void infrared_worker_free(InfraredWorker* instance) {
+    furi_check(instance);
+    pthread_mutex_lock(&infrared_worker_lock);
+    furi_check(infrared_worker_receiving != instance);
+    pthread_mutex_unlock(&infrared_worker_lock);
+    furi_thread_free(instance->thread);
+    furi_message_queue_free(instance->queue);
+    free(instance);
+}
+
+void infrared_worker_rx_start(InfraredWorker* instance) {
+    furi_check(instance);
+    pthread_mutex_lock(&infrared_worker_lock);
+    furi_check(!infrared_worker_receiving);
+    furi_thread_start(instance->thread);
+    infrared_worker_receiving = instance;
+    pthread_mutex_unlock(&infrared_worker_lock);
+}
+
+void infrared_worker_rx_stop(InfraredWorker* instance) {
+    furi_check(instance);
+    pthread_mutex_lock(&infrared_worker_lock);
+    furi_check(infrared_worker_receiving == instance);
+    infrared_worker_receiving = NULL;
+    pthread_mutex_unlock(&infrared_worker_lock);
+
+    furi_thread_flags_set(furi_thread_get_id(instance->thread), INFRARED_WORKER_FLAG_EXIT);
+    furi_thread_join(instance->thread);
+
+    InfraredMessage dropped;
+    while(furi_message_queue_get(instance->queue, &dropped, 0) == FuriStatusOk) {
+    }
+}
+
+void infrared_worker_rx_set_received_signal_callback(
+    InfraredWorker* instance,
+    InfraredWorkerReceivedSignalCallback callback,
+    void* context) {
+    furi_check(instance);
+    instance->callback = callback;
+    instance->context = context;
+}
+
+bool infrared_worker_signal_is_decoded(const InfraredWorkerSignal* signal) {
+    furi_check(signal);
+    return signal->decoded;
+}
+
+const InfraredMessage* infrared_worker_get_decoded_signal(const InfraredWorkerSignal* signal) {
+    furi_check(signal);
+    return signal->decoded ? &signal->message : NULL;
+}
+
+bool host_infrared_inject(const InfraredMessage* message) {
+    furi_check(message);
+    pthread_mutex_lock(&infrared_worker_lock);
+    InfraredWorker* instance = infrared_worker_receiving;
+    bool queued = instance && furi_message_queue_put(instance->queue, message, 0) == FuriStatusOk;
+    if(queued) {
+        furi_thread_flags_set(furi_thread_get_id(instance->thread), INFRARED_WORKER_FLAG_RX);
+    }
+    pthread_mutex_unlock(&infrared_worker_lock);
+    return queued;
+}
+
+InfraredSignal* infrared_signal_alloc() {
+    InfraredSignal* signal = calloc(1, sizeof(InfraredSignal));
+    furi_check(signal);
+    return signal;
+}
+
+void infrared_signal_free(InfraredSignal* signal) {
+    furi_check(signal);
+    free(signal);
+}
+
+void infrared_signal_set_message(InfraredSignal* signal, const InfraredMessage* message) {
+    furi_check(signal && message);
+    signal->message = *message;
+}
+
+void infrared_signal_transmit(const InfraredSignal* signal) {
+    furi_check(signal);
+    atomic_fetch_add(&infrared_signal_sent, 1);
+}
+
+uint32_t host_infrared_get_sent(void) {
+    return atomic_load(&infrared_signal_sent);
+}
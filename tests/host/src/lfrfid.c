@@ -0,0 +1,232 @@
+#include "../host.h"
+#include <lib/lfrfid/lfrfid_worker.h>
+#include <lfrfid/protocols/lfrfid_protocols.h>
+#include <pthread.h>
+
+/*
+ * The worker thread idles until read mode is entered, reports the ASK read as
+ * started, and reports a tag handed to host_lfrfid_inject as read by the
+ * first protocol of the dictionary. Like the firmware worker it then goes
+ * back to idle until the read is started again.
+ */
+
+#define LFRFID_WORKER_FLAG_READ (1 << 0)
+#define LFRFID_WORKER_FLAG_STOP (1 << 1)
+#define LFRFID_WORKER_FLAG_EXIT (1 << 2)
+#define LFRFID_WORKER_FLAG_TAG  (1 << 3)
+#define LFRFID_WORKER_FLAG_ALL  0xF
+
+#define LFRFID_WORKER_TAG_SIZE 16
+
+struct ProtocolDict {
+    const ProtocolBase** protocols;
+    size_t count;
+    uint8_t** data;
+};
+
+struct LFRFIDWorker {
+    ProtocolDict* dict;
+    FuriThread* thread;
+    LFRFIDWorkerReadCallback callback;
+    void* context;
+    uint8_t tag[LFRFID_WORKER_TAG_SIZE]; // guarded by lfrfid_worker_lock
+    size_t tag_size;
+};
+
+static const ProtocolBase lfrfid_protocol_em4100 = {.name = "EM4100", .data_size = 5};
+static const ProtocolBase lfrfid_protocol_em4100_32 = {.name = "EM4100/32", .data_size = 5};
+static const ProtocolBase lfrfid_protocol_em4100_16 = {.name = "EM4100/16", .data_size = 5};
+static const ProtocolBase lfrfid_protocol_h10301 = {.name = "H10301", .data_size = 3};
+static const ProtocolBase lfrfid_protocol_indala26 = {.name = "Indala26", .data_size = 4};
+
+const ProtocolBase* lfrfid_protocols[] = {
+    [LFRFIDProtocolEM4100] = &lfrfid_protocol_em4100,
+    [LFRFIDProtocolEM4100_32] = &lfrfid_protocol_em4100_32,
+    [LFRFIDProtocolEM4100_16] = &lfrfid_protocol_em4100_16,
+    [LFRFIDProtocolH10301] = &lfrfid_protocol_h10301,
+    [LFRFIDProtocolIndala26] = &lfrfid_protocol_indala26,
+};
+
+// The worker in read mode, the app only ever has one.
+static pthread_mutex_t lfrfid_worker_lock = PTHREAD_MUTEX_INITIALIZER;
+static LFRFIDWorker* lfrfid_worker_reading;
+
+/* Protocol dictionary */
+
+ProtocolDict* protocol_dict_alloc(const ProtocolBase** protocols, size_t protocol_count) {
+    ProtocolDict* dict = calloc(1, sizeof(ProtocolDict));
+    furi_check(dict);
+    dict->protocols = protocols;
+    dict->count = protocol_count;
+    dict->data = calloc(protocol_count, sizeof(uint8_t*));
+    furi_check(dict->data);
+    for(size_t i = 0; i < protocol_count; i++) {
+        dict->data[i] = calloc(1, protocols[i]->data_size);
+        furi_check(dict->data[i]);
+    }
+    return dict;
+}
+
+void protocol_dict_free(ProtocolDict* dict) {
+    furi_check(dict);
+    for(size_t i = 0; i < dict->count; i++) {
+        free(dict->data[i]);
+    }
+    free(dict->data);
+    free(dict);
+}
+
+size_t protocol_dict_get_max_data_size(ProtocolDict* dict) {
+    furi_check(dict);
+    size_t size = 0;
+    for(size_t i = 0; i < dict->count; i++) {
+        size = MAX(size, dict->protocols[i]->data_size);
+    }
+    return size;
+}
+
+const char* protocol_dict_get_name(ProtocolDict* dict, size_t protocol_index) {
+    furi_check(dict && protocol_index < dict->count);
+    return dict->protocols[protocol_index]->name;
+}
+
+size_t protocol_dict_get_data_size(ProtocolDict* dict, size_t protocol_index) {
+    furi_check(dict && protocol_index < dict->count);
+    return dict->protocols[protocol_index]->data_size;
+}
+
+void protocol_dict_get_data(
+    ProtocolDict* dict,
+    size_t protocol_index,
+    uint8_t* data,
+    size_t data_size) {
+    furi_check(dict && protocol_index < dict->count);
+    furi_check(data_size >= dict->protocols[protocol_index]->data_size);
+    memcpy(data, dict->data[protocol_index], dict->protocols[protocol_index]->data_size);
+}
+
+void protocol_dict_set_data(
+    ProtocolDict* dict,
+    size_t protocol_index,
+    const uint8_t* data,
+    size_t data_size) {
+    furi_check(dict && protocol_index < dict->count);
+    furi_check(data_size >= dict->protocols[protocol_index]->data_size);
+    memcpy(dict->data[protocol_index], data, dict->protocols[protocol_index]->data_size);
+}
+
+/* Worker */
+
+static void lfrfid_worker_set_reading(LFRFIDWorker* worker, bool reading) {
+    pthread_mutex_lock(&lfrfid_worker_lock);
+    if(reading) {
+        furi_check(!lfrfid_worker_reading || lfrfid_worker_reading == worker);
+        lfrfid_worker_reading = worker;
+    } else if(lfrfid_worker_reading == worker) {
+        lfrfid_worker_reading = NULL;
+    }
+    pthread_mutex_unlock(&lfrfid_worker_lock);
+}
+
+// The reader arms a read again while the worker may still report the last one.
+static void lfrfid_worker_notify(LFRFIDWorker* worker, LFRFIDWorkerReadResult result) {
+    pthread_mutex_lock(&lfrfid_worker_lock);
+    LFRFIDWorkerReadCallback callback = worker->callback;
+    void* callback_context = worker->context;
+    pthread_mutex_unlock(&lfrfid_worker_lock);
+    callback(result, result == LFRFIDWorkerReadDone ? 0 : PROTOCOL_NO, callback_context);
+}
+
+static int32_t lfrfid_worker_thread(void* context) {
+    LFRFIDWorker* worker = context;
+    bool reading = false;
+    for(;;) {
+        uint32_t flags =
+            furi_thread_flags_wait(LFRFID_WORKER_FLAG_ALL, FuriFlagWaitAny, FuriWaitForever);
+        if(flags & LFRFID_WORKER_FLAG_EXIT) {
+            break;
+        }
+        if(flags & LFRFID_WORKER_FLAG_STOP) {
+            reading = false;
+            lfrfid_worker_set_reading(worker, false);
+        }
+        if(flags & LFRFID_WORKER_FLAG_READ) {
+            reading = true;
+            lfrfid_worker_set_reading(worker, true);
+            lfrfid_worker_notify(worker, LFRFIDWorkerReadStartASK);
+        }
+        if((flags & LFRFID_WORKER_FLAG_TAG) && reading) {
+            uint8_t tag[LFRFID_WORKER_TAG_SIZE];
+            pthread_mutex_lock(&lfrfid_worker_lock);
+            memcpy(tag, worker->tag, sizeof(tag));
+            size_t tag_size = worker->tag_size;
+            pthread_mutex_unlock(&lfrfid_worker_lock);
+            if(tag_size >= worker->dict->protocols[0]->data_size) {
+                protocol_dict_set_data(worker->dict, 0, tag, tag_size);
+                reading = false;
+                lfrfid_worker_set_reading(worker, false);
+                lfrfid_worker_notify(worker, LFRFIDWorkerReadDone);
+            }
+        }
+    }
+    lfrfid_worker_set_reading(worker, false);
+    return 0;
+}
+
+LFRFIDWorker* lfrfid_worker_alloc(ProtocolDict* dict) {
+    furi_check(dict);
+    LFRFIDWorker* worker = calloc(1, sizeof(LFRFIDWorker));
+    furi_check(worker);
+    worker->dict = dict;
+    worker->thread = furi_thread_alloc_ex("LfrfidWorker", 2048, lfrfid_worker_thread, worker);
+    return worker;
+}
+
+void lfrfid_worker_free(LFRFIDWorker* worker) {
+    furi_check(worker);
+    furi_thread_free(worker->thread);
+    free(worker);
+}
+
+void lfrfid_worker_start_thread(LFRFIDWorker* worker) {
+    furi_check(worker);
+    furi_thread_start(worker->thread);
+}
+
+void lfrfid_worker_stop_thread(LFRFIDWorker* worker) {
+    furi_check(worker);
+    furi_thread_flags_set(furi_thread_get_id(worker->thread), LFRFID_WORKER_FLAG_EXIT);
+    furi_thread_join(worker->thread);
+}
+
+void lfrfid_worker_read_start(
+    LFRFIDWorker* worker,
+    LFRFIDWorkerReadType type,
+    LFRFIDWorkerReadCallback callback,
+    void* context) {
+    furi_check(worker && callback);
+    UNUSED(type);
+    pthread_mutex_lock(&lfrfid_worker_lock);
+    worker->callback = callback;
+    worker->context = context;
+    pthread_mutex_unlock(&lfrfid_worker_lock);
+    furi_thread_flags_set(furi_thread_get_id(worker->thread), LFRFID_WORKER_FLAG_READ);
+}
+
+void lfrfid_worker_stop(LFRFIDWorker* worker) {
+    furi_check(worker);
+    furi_thread_flags_set(furi_thread_get_id(worker->thread), LFRFID_WORKER_FLAG_STOP);
+}
+
+bool host_lfrfid_inject(const uint8_t* data, size_t size) {
+    furi_check(data && size <= LFRFID_WORKER_TAG_SIZE);
+    pthread_mutex_lock(&lfrfid_worker_lock);
+    LFRFIDWorker* worker = lfrfid_worker_reading;
+    if(worker) {
+        memcpy(worker->tag, data, size);
+        worker->tag_size = size;
+        furi_thread_flags_set(furi_thread_get_id(worker->thread), LFRFID_WORKER_FLAG_TAG);
+    }
+    pthread_mutex_unlock(&lfrfid_worker_lock);
+    return worker != NULL;
+}
@@ -0,0 +1,42 @@
+#include <furi.h>
+#include <notification/notification_messages.h>
+
+const NotificationMessage message_vibro_on = {NotificationMessageTypeVibro, 0};
+const NotificationMessage message_vibro_off = {NotificationMessageTypeVibro, 0};
+const NotificationMessage message_note_c4 = {NotificationMessageTypeSoundOn, 0};
+const NotificationMessage message_note_d4 = {NotificationMessageTypeSoundOn, 0};
+const NotificationMessage message_note_g3 = {NotificationMessageTypeSoundOn, 0};
+const NotificationMessage message_sound_off = {NotificationMessageTypeSoundOff, 0};
+const NotificationMessage message_red_255 = {NotificationMessageTypeLed, 0};
+const NotificationMessage message_green_255 = {NotificationMessageTypeLed, 0};
+const NotificationMessage message_blue_255 = {NotificationMessageTypeLed, 0};
+const NotificationMessage message_delay_10 = {NotificationMessageTypeDelay, 10};
+const NotificationMessage message_delay_50 = {NotificationMessageTypeDelay, 50};
+const NotificationMessage message_delay_100 = {NotificationMessageTypeDelay, 100};
+const NotificationMessage message_delay_1000 = {NotificationMessageTypeDelay, 1000};
+
+const NotificationSequence sequence_blink_red_100 = {&message_red_255, &message_delay_100, NULL};
+const NotificationSequence sequence_blink_blue_100 = {&message_blue_255, &message_delay_100, NULL};
+const NotificationSequence sequence_success =
+    {&message_green_255, &message_vibro_on, &message_delay_100, &message_vibro_off, NULL};
+const NotificationSequence sequence_error =
+    {&message_red_255, &message_vibro_on, &message_delay_100, &message_vibro_off, NULL};
+const NotificationSequence sequence_single_vibro =
+    {&message_vibro_on, &message_delay_100, &message_vibro_off, NULL};
+
+void notification_message(NotificationApp* app, const NotificationSequence* sequence) {
+    UNUSED(app);
+    furi_check(sequence);
+}
+
+void notification_message_block(NotificationApp* app, const NotificationSequence* sequence) {
+    UNUSED(app);
+    furi_check(sequence);
+    uint32_t delay = 0;
+    for(size_t i = 0; (*sequence)[i]; i++) {
+        if((*sequence)[i]->type == NotificationMessageTypeDelay) {
+            delay += (*sequence)[i]->length;
+        }
+    }
+    furi_delay_ms(delay / HOST_NOTIFICATION_SPEEDUP);
+}
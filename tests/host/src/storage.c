@@ -0,0 +1,130 @@
+#include <furi.h>
+#include <storage/storage.h>
+#include <toolbox/crc32_calc.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Files under $HOST_STORAGE (./storage if unset) with the device path
+ * appended. Only the access and open modes the app uses are supported.
+ */
+
+#define STORAGE_PATH_SIZE 256
+
+struct File {
+    FILE* stream;
+};
+
+static void storage_host_path(const char* path, char* host_path) {
+    const char* root = getenv("HOST_STORAGE");
+    int length = snprintf(host_path, STORAGE_PATH_SIZE, "%s%s", root ? root : "storage", path);
+    furi_check(length > 0 && length < STORAGE_PATH_SIZE);
+}
+
+// mkdir -p for the directory the file goes in.
+static void storage_host_make_parents(const char* host_path) {
+    char directory[STORAGE_PATH_SIZE];
+    snprintf(directory, sizeof(directory), "%s", host_path);
+    for(char* slash = strchr(directory + 1, '/'); slash; slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        if(mkdir(directory, 0777) && errno != EEXIST) {
+            return;
+        }
+        *slash = '/';
+    }
+}
+
+File* storage_file_alloc(Storage* storage) {
+    UNUSED(storage);
+    File* file = calloc(1, sizeof(File));
+    furi_check(file);
+    return file;
+}
+
+void storage_file_free(File* file) {
+    furi_check(file);
+    if(file->stream) {
+        fclose(file->stream);
+    }
+    free(file);
+}
+
+bool storage_file_open(File* file, const char* path, FS_AccessMode access, FS_OpenMode mode) {
+    furi_check(file && !file->stream);
+    char host_path[STORAGE_PATH_SIZE];
+    storage_host_path(path, host_path);
+
+    if(access == FSAM_READ && mode == FSOM_OPEN_EXISTING) {
+        file->stream = fopen(host_path, "rb");
+    } else if(access == FSAM_WRITE && mode == FSOM_CREATE_ALWAYS) {
+        storage_host_make_parents(host_path);
+        file->stream = fopen(host_path, "wb");
+    } else {
+        furi_crash_host(__FILE__, __LINE__, "open mode not supported on the host");
+    }
+    return file->stream != NULL;
+}
+
+bool storage_file_close(File* file) {
+    furi_check(file);
+    if(!file->stream) {
+        return false;
+    }
+    bool closed = fclose(file->stream) == 0;
+    file->stream = NULL;
+    return closed;
+}
+
+size_t storage_file_read(File* file, void* buff, size_t bytes_to_read) {
+    furi_check(file && file->stream);
+    return fread(buff, 1, bytes_to_read, file->stream);
+}
+
+size_t storage_file_write(File* file, const void* buff, size_t bytes_to_write) {
+    furi_check(file && file->stream);
+    return fwrite(buff, 1, bytes_to_write, file->stream);
+}
+
+bool storage_file_sync(File* file) {
+    furi_check(file && file->stream);
+    return fflush(file->stream) == 0;
+}
+
+FS_Error storage_common_remove(Storage* storage, const char* path) {
+    UNUSED(storage);
+    char host_path[STORAGE_PATH_SIZE];
+    storage_host_path(path, host_path);
+    if(unlink(host_path)) {
+        return errno == ENOENT ? FSE_NOT_EXIST : FSE_INTERNAL;
+    }
+    return FSE_OK;
+}
+
+// Like the firmware, this doesn't replace an existing file.
+FS_Error storage_common_rename(Storage* storage, const char* old_path, const char* new_path) {
+    UNUSED(storage);
+    char host_old_path[STORAGE_PATH_SIZE];
+    char host_new_path[STORAGE_PATH_SIZE];
+    storage_host_path(old_path, host_old_path);
+    storage_host_path(new_path, host_new_path);
+    if(access(host_new_path, F_OK) == 0) {
+        return FSE_EXIST;
+    }
+    if(rename(host_old_path, host_new_path)) {
+        return errno == ENOENT ? FSE_NOT_EXIST : FSE_INTERNAL;
+    }
+    return FSE_OK;
+}
+
+uint32_t crc32_calc_buffer(uint32_t crc, const void* buffer, size_t size) {
+    const uint8_t* data = buffer;
+    crc = ~crc;
+    for(size_t i = 0; i < size; i++) {
+        crc ^= data[i];
+        for(int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
@@ -0,0 +1,116 @@
+#include "../../laser_tag_app.c"
+#include "host.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <time.h>
+
+/*
+ * Resumes and pauses the RFID reader the way the radio scheduler does, slot
+ * after slot, and checks that a cycle costs no thread start and no heap: the
+ * reader and worker threads are started once, and the bytes in use are the
+ * same after the last cycle as after the first. Every few cycles a tag is
+ * read while armed, so the re-arm after a read is part of it.
+ *
+ * Prints the time from resume to the worker reporting the ASK read started,
+ * which is what the scheduler and a scan wait for before the antenna is on.
+ */
+
+#define LFRFID_CYCLES      500
+#define LFRFID_TAG_EVERY   10
+#define LFRFID_TAG_WAIT_MS 100
+
+static const LFRFIDProtocol lfrfid_test_protocols[] = {LFRFIDProtocolEM4100};
+static const uint8_t lfrfid_test_tag[] = {0x13, 0x37, 0x00, 0xFD, 0x0A};
+
+static atomic_uint lfrfid_test_tags;
+
+static void lfrfid_test_tag_callback(uint8_t* data, uint8_t length, void* context) {
+    UNUSED(context);
+    if(length == sizeof(lfrfid_test_tag) && !memcmp(data, lfrfid_test_tag, length)) {
+        atomic_fetch_add(&lfrfid_test_tags, 1);
+    }
+}
+
+static uint64_t lfrfid_test_now_us(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static bool lfrfid_test_read_tag(void) {
+    uint32_t tags = atomic_load(&lfrfid_test_tags);
+    if(!host_lfrfid_inject(lfrfid_test_tag, sizeof(lfrfid_test_tag))) {
+        return false;
+    }
+    for(uint32_t waited = 0; waited < LFRFID_TAG_WAIT_MS; waited++) {
+        if(atomic_load(&lfrfid_test_tags) != tags) {
+            return true;
+        }
+        furi_delay_ms(1);
+    }
+    return false;
+}
+
+int main(void) {
+    LFRFIDReader* reader =
+        lfrfid_reader_alloc(lfrfid_test_protocols, COUNT_OF(lfrfid_test_protocols));
+    lfrfid_reader_set_tag_callback(reader, LFRFIDProtocolEM4100, lfrfid_test_tag_callback, NULL);
+    lfrfid_reader_start(reader);
+
+    // The first cycle sets up whatever the threads allocate on first use.
+    lfrfid_reader_resume(reader);
+    lfrfid_reader_pause(reader);
+    uint32_t threads = host_thread_get_started();
+    size_t bytes = host_alloc_get_live_bytes();
+
+    bool ok = true;
+    uint32_t tags_missed = 0;
+    uint64_t armed_total_us = 0;
+    uint64_t armed_max_us = 0;
+    uint32_t armed_max_ticks = 0;
+    for(uint32_t cycle = 0; cycle < LFRFID_CYCLES; cycle++) {
+        uint32_t start_tick = furi_get_tick();
+        uint64_t start = lfrfid_test_now_us();
+        lfrfid_reader_resume(reader);
+        uint64_t armed_us = lfrfid_test_now_us() - start;
+        armed_total_us += armed_us;
+        armed_max_us = MAX(armed_max_us, armed_us);
+        armed_max_ticks = MAX(armed_max_ticks, furi_get_tick() - start_tick);
+
+        if(cycle % LFRFID_TAG_EVERY == 0 && !lfrfid_test_read_tag()) {
+            tags_missed++;
+        }
+        lfrfid_reader_pause(reader);
+    }
+
+    // The worker leaves read mode on its own time after a pause.
+    furi_delay_ms(LFRFID_TAG_WAIT_MS);
+    if(host_lfrfid_inject(lfrfid_test_tag, sizeof(lfrfid_test_tag))) {
+        printf("FAIL worker still reading after pause\n");
+        ok = false;
+    }
+
+    uint32_t threads_started = host_thread_get_started() - threads;
+    long bytes_grown = (long)host_alloc_get_live_bytes() - (long)bytes;
+    printf(
+        "%u cycles: %lu threads started, %ld heap bytes grown, %lu of %u tags missed\n",
+        LFRFID_CYCLES,
+        (unsigned long)threads_started,
+        bytes_grown,
+        (unsigned long)tags_missed,
+        LFRFID_CYCLES / LFRFID_TAG_EVERY);
+    printf(
+        "resume to read armed: mean %.1f us, max %lu us, max %lu ticks\n",
+        (double)armed_total_us / LFRFID_CYCLES,
+        (unsigned long)armed_max_us,
+        (unsigned long)armed_max_ticks);
+    if(threads_started || bytes_grown || tags_missed) {
+        ok = false;
+    }
+
+    lfrfid_reader_stop(reader);
+    lfrfid_reader_free(reader);
+
+    printf(ok ? "no failures\n" : "lfrfid test failed\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,408 @@
+#include "../../laser_tag_app.c"
+#include "host.h"
+#include <sys/stat.h>
+#include <time.h>
+
+/*
+ * Draws every screen of the app on the host canvas and compares it with
+ * golden/<screen>.pbm, pixel for pixel. A screen also fails if anything on it
+ * is drawn outside the 128x64 frame, even if the pixels that land on screen
+ * are right, and if drawing it allocated on the heap. Each screen is then
+ * drawn again in a loop, still without a single allocation, and the time per
+ * draw printed along with the canvas calls and pixel writes it takes.
+ *
+ * With UPDATE_GOLDEN=1 the goldens are rewritten instead. Mismatching frames
+ * are written to build/actual/ to look at next to the golden.
+ */
+
+#define RENDER_GOLDEN_DIR   "golden"
+#define RENDER_ACTUAL_DIR   "build/actual"
+#define RENDER_BENCH_FRAMES 2000
+
+// 03:07 into the match, on the HUD and in the checkpoint.
+#define RENDER_GAME_TIME_MS 187000
+
+typedef struct {
+    const char* name;
+    void (*setup)(LaserTagApp* app);
+} RenderScreen;
+
+/* Screens */
+
+static void render_game(LaserTagApp* app, LaserTagTeam team) {
+    app->state = LaserTagStateGame;
+    app->perf_visible = false;
+    game_state_reset(app->game_state);
+    game_state_set_team(app->game_state, team);
+    host_clock_advance(RENDER_GAME_TIME_MS);
+    laser_tag_view_update(app->view, app->game_state);
+    laser_tag_view_set_scan_progress(app->view, 0);
+    laser_tag_view_set_shooter_clash(app->view, false);
+}
+
+static void render_splash(LaserTagApp* app) {
+    app->state = LaserTagStateSplashScreen;
+}
+
+static void render_team_select(LaserTagApp* app) {
+    app->state = LaserTagStateTeamSelect;
+    app->rules = (GameRules)GAME_RULES_DEFAULT;
+    app->scan_active = false;
+}
+
+static void render_team_select_scan(LaserTagApp* app) {
+    render_team_select(app);
+    app->scan_active = true;
+}
+
+static void render_team_select_tournament(LaserTagApp* app) {
+    render_team_select(app);
+    app->rules.match_key = 0x5EED1234;
+}
+
+static void render_resume(LaserTagApp* app) {
+    app->state = LaserTagStateResume;
+}
+
+static void render_referee_open(LaserTagApp* app) {
+    render_team_select(app);
+    app->state = LaserTagStateReferee;
+    referee_start(app->referee);
+    for(uint32_t i = 0; i < 12; i++) {
+        referee_record_shot(app->referee, i % 3 ? TeamRed : TeamBlue, REFEREE_NO_SHOOTER);
+    }
+}
+
+static void render_referee_tournament(LaserTagApp* app) {
+    render_team_select_tournament(app);
+    app->state = LaserTagStateReferee;
+    referee_start(app->referee);
+    for(uint32_t shooter = 1; shooter <= 8; shooter++) {
+        for(uint32_t i = 0; i < shooter * 3; i++) {
+            referee_record_shot(app->referee, shooter % 2 ? TeamRed : TeamBlue, shooter);
+        }
+    }
+}
+
+static void render_game_over(LaserTagApp* app) {
+    referee_stop(app->referee);
+    app->state = LaserTagStateGameOver;
+    app->scan_active = false;
+}
+
+static void render_game_over_scan(LaserTagApp* app) {
+    render_game_over(app);
+    app->scan_active = true;
+}
+
+static void render_game_full(LaserTagApp* app) {
+    render_game(app, TeamRed);
+}
+
+static void render_game_hurt(LaserTagApp* app) {
+    render_game(app, TeamBlue);
+    game_state_decrease_health(app->game_state, 40);
+    game_state_increase_armor(app->game_state, 50);
+    game_state_set_flag(app->game_state, true);
+    laser_tag_view_update(app->view, app->game_state);
+}
+
+static void render_game_empty(LaserTagApp* app) {
+    render_game(app, TeamRed);
+    game_state_decrease_ammo(app->game_state, game_state_get_ammo(app->game_state));
+    laser_tag_view_update(app->view, app->game_state);
+}
+
+static void render_game_scan(LaserTagApp* app) {
+    render_game(app, TeamRed);
+    laser_tag_view_set_scan_progress(app->view, 50);
+}
+
+static void render_game_clash(LaserTagApp* app) {
+    render_game(app, TeamRed);
+    laser_tag_view_set_shooter_clash(app->view, true);
+}
+
+static void render_game_dead(LaserTagApp* app) {
+    render_game(app, TeamRed);
+    game_state_decrease_health(app->game_state, MAX_HEALTH);
+    laser_tag_view_update(app->view, app->game_state);
+}
+
+// The overlay turns a page with every sample, a second apart.
+static void render_perf(LaserTagApp* app, uint8_t page) {
+    render_game(app, TeamRed);
+    PerfSample sample = {
+        .loop_iterations = 1000,
+        .loop_max_us = 850,
+        .redraws = 40,
+        .rx_callbacks = 120,
+        .rx_decoded = 100,
+        .rx_accepted = 80,
+        .rx_dropped = 2,
+        .queue_depth = 1,
+        .queue_size = LASER_TAG_EVENT_QUEUE_SIZE,
+        .queue_overflows = 3,
+        .free_heap = 65536,
+        .main_stack_free = 1200,
+        .rx_stack_free = 700,
+    };
+    perf_overlay_reset(app->perf, &sample);
+    for(uint8_t i = 0; i < (page ? page : 3); i++) {
+        host_clock_advance(1000);
+        sample.loop_iterations += 250;
+        sample.redraws += 10;
+        sample.rx_callbacks += 30;
+        perf_overlay_update(app->perf, &sample);
+    }
+    app->perf_visible = true;
+}
+
+static void render_perf_0(LaserTagApp* app) {
+    render_perf(app, 0);
+}
+
+static void render_perf_1(LaserTagApp* app) {
+    render_perf(app, 1);
+}
+
+static void render_perf_2(LaserTagApp* app) {
+    render_perf(app, 2);
+}
+
+static const RenderScreen render_screens[] = {
+    {"splash", render_splash},
+    {"team_select", render_team_select},
+    {"team_select_scan", render_team_select_scan},
+    {"team_select_tournament", render_team_select_tournament},
+    {"resume", render_resume},
+    {"referee_open", render_referee_open},
+    {"referee_tournament", render_referee_tournament},
+    {"game_over", render_game_over},
+    {"game_over_scan", render_game_over_scan},
+    {"game_full", render_game_full},
+    {"game_hurt", render_game_hurt},
+    {"game_empty", render_game_empty},
+    {"game_scan", render_game_scan},
+    {"game_clash", render_game_clash},
+    {"game_dead", render_game_dead},
+    {"perf_0", render_perf_0},
+    {"perf_1", render_perf_1},
+    {"perf_2", render_perf_2},
+};
+
+/* Frames */
+
+// Returns the number of heap allocations the draw made.
+static uint32_t render_draw(LaserTagApp* app, Canvas* canvas) {
+    host_canvas_reset(canvas);
+    host_canvas_reset_stats(canvas);
+    host_alloc_count_enable(true);
+    laser_tag_app_draw_callback(canvas, app);
+    uint32_t allocations = host_alloc_count_get();
+    host_alloc_count_enable(false);
+    return allocations;
+}
+
+// Plain PBM, one row of the screen per line.
+static bool render_write_pbm(const char* path, const Canvas* canvas) {
+    FILE* file = fopen(path, "w");
+    if(!file) {
+        return false;
+    }
+    fprintf(file, "P1\n%d %d\n", HOST_CANVAS_WIDTH, HOST_CANVAS_HEIGHT);
+    for(int32_t y = 0; y < HOST_CANVAS_HEIGHT; y++) {
+        for(int32_t x = 0; x < HOST_CANVAS_WIDTH; x++) {
+            fputc(host_canvas_get_pixel(canvas, x, y) ? '1' : '0', file);
+        }
+        fputc('\n', file);
+    }
+    return fclose(file) == 0;
+}
+
+static bool render_read_pbm(const char* path, bool* pixels) {
+    FILE* file = fopen(path, "r");
+    if(!file) {
+        return false;
+    }
+    int width = 0;
+    int height = 0;
+    bool valid = fscanf(file, "P1 %d %d", &width, &height) == 2 &&
+                 width == HOST_CANVAS_WIDTH && height == HOST_CANVAS_HEIGHT;
+    for(int32_t i = 0; valid && i < HOST_CANVAS_WIDTH * HOST_CANVAS_HEIGHT; i++) {
+        int pixel;
+        do {
+            pixel = fgetc(file);
+        } while(pixel == ' ' || pixel == '\n' || pixel == '\r' || pixel == '\t');
+        valid = pixel == '0' || pixel == '1';
+        pixels[i] = pixel == '1';
+    }
+    fclose(file);
+    return valid;
+}
+
+static bool render_check(const RenderScreen* screen, const Canvas* canvas, bool update) {
+    char path[128];
+    snprintf(path, sizeof(path), "%s/%s.pbm", RENDER_GOLDEN_DIR, screen->name);
+
+    const HostCanvasStats* stats = host_canvas_get_stats(canvas);
+    if(stats->off_screen) {
+        printf(
+            "FAIL %s: %lu drawing calls off screen, the first at (%ld, %ld)\n",
+            screen->name,
+            (unsigned long)stats->off_screen,
+            (long)stats->off_screen_x,
+            (long)stats->off_screen_y);
+        return false;
+    }
+
+    if(update) {
+        if(!render_write_pbm(path, canvas)) {
+            printf("FAIL %s: can't write %s\n", screen->name, path);
+            return false;
+        }
+        return true;
+    }
+
+    static bool golden[HOST_CANVAS_WIDTH * HOST_CANVAS_HEIGHT];
+    if(!render_read_pbm(path, golden)) {
+        printf("FAIL %s: no valid %s, run make golden\n", screen->name, path);
+        return false;
+    }
+    uint32_t differ = 0;
+    int32_t first_x = 0;
+    int32_t first_y = 0;
+    for(int32_t y = 0; y < HOST_CANVAS_HEIGHT; y++) {
+        for(int32_t x = 0; x < HOST_CANVAS_WIDTH; x++) {
+            if(host_canvas_get_pixel(canvas, x, y) != golden[y * HOST_CANVAS_WIDTH + x]) {
+                if(!differ) {
+                    first_x = x;
+                    first_y = y;
+                }
+                differ++;
+            }
+        }
+    }
+    if(differ) {
+        snprintf(path, sizeof(path), "%s/%s.pbm", RENDER_ACTUAL_DIR, screen->name);
+        mkdir(RENDER_ACTUAL_DIR, 0777);
+        render_write_pbm(path, canvas);
+        printf(
+            "FAIL %s: %lu pixels differ from the golden, the first at (%ld, %ld), see %s\n",
+            screen->name,
+            (unsigned long)differ,
+            (long)first_x,
+            (long)first_y,
+            path);
+        return false;
+    }
+    return true;
+}
+
+static double render_bench(LaserTagApp* app, Canvas* canvas, uint32_t* allocations) {
+    uint64_t total_ns = 0;
+    host_alloc_count_enable(true);
+    for(uint32_t i = 0; i < RENDER_BENCH_FRAMES; i++) {
+        struct timespec start;
+        struct timespec end;
+        host_canvas_reset(canvas);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        laser_tag_app_draw_callback(canvas, app);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        total_ns += (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000ULL +
+                    (uint64_t)(end.tv_nsec - start.tv_nsec);
+    }
+    *allocations = host_alloc_count_get();
+    host_alloc_count_enable(false);
+    return (double)total_ns / RENDER_BENCH_FRAMES / 1000.0;
+}
+
+// The Resume screen shows what the init thread finds on the card, so a match
+// is saved before the app starts.
+static void render_save_checkpoint(void) {
+    GameCheckpointData data = {
+        .game =
+            {
+                .team = TeamBlue,
+                .health = 70,
+                .ammo = 42,
+                .max_ammo = INITIAL_AMMO,
+                .time_ms = RENDER_GAME_TIME_MS,
+            },
+        .rules = GAME_RULES_DEFAULT,
+    };
+    GameCheckpoint* checkpoint = game_checkpoint_alloc();
+    game_checkpoint_save(checkpoint, &data);
+    game_checkpoint_free(checkpoint);
+    laser_tag_arena_reset();
+}
+
+int main(void) {
+    bool update = getenv("UPDATE_GOLDEN") != NULL;
+    host_clock_set_manual(true);
+    render_save_checkpoint();
+
+    // Log lines are formatted on the heap, as on the device, so this is what
+    // a FURI_LOG_* in a draw path would look like.
+    host_alloc_count_enable(true);
+    FURI_LOG_I(TAG, "Allocation counter check");
+    if(host_alloc_count_get() != 1) {
+        printf("FAIL setup: allocations aren't counted\n");
+        return 1;
+    }
+    host_alloc_count_enable(false);
+
+    LaserTagApp* app = laser_tag_app_alloc();
+    furi_check(app);
+    if(!laser_tag_app_radio_ready(app) || !app->resume_available) {
+        printf("FAIL setup: radios or checkpoint missing\n");
+        return 1;
+    }
+
+    Canvas* canvas = host_canvas_alloc();
+    uint32_t failed = 0;
+    for(size_t i = 0; i < COUNT_OF(render_screens); i++) {
+        const RenderScreen* screen = &render_screens[i];
+        screen->setup(app);
+        uint32_t allocations = render_draw(app, canvas);
+        if(!render_check(screen, canvas, update)) {
+            failed++;
+            continue;
+        }
+        const HostCanvasStats* stats = host_canvas_get_stats(canvas);
+        uint32_t calls = stats->calls;
+        uint32_t pixels = stats->pixels;
+        uint32_t bench_allocations;
+        double us = render_bench(app, canvas, &bench_allocations);
+        if(allocations || bench_allocations) {
+            printf(
+                "FAIL %s: %lu heap allocations in the first draw, %lu in the next %d\n",
+                screen->name,
+                (unsigned long)allocations,
+                (unsigned long)bench_allocations,
+                RENDER_BENCH_FRAMES);
+            failed++;
+            continue;
+        }
+        printf(
+            "ok   %-24s %7.2f us/draw %4lu calls %6lu pixels\n",
+            screen->name,
+            us,
+            (unsigned long)calls,
+            (unsigned long)pixels);
+    }
+    host_canvas_free(canvas);
+
+    referee_stop(app->referee);
+    laser_tag_app_free(app);
+
+    if(failed) {
+        printf(
+            "%lu of %lu screens failed\n",
+            (unsigned long)failed,
+            (unsigned long)COUNT_OF(render_screens));
+        return 1;
+    }
+    printf(update ? "goldens written\n" : "all screens match\n");
+    return 0;
+}
@@ -0,0 +1,243 @@
+#include "../../laser_tag_app.c"
+#include "host.h"
+#include <stdio.h>
+
+/*
+ * Tournament mode shot authentication, from the victim's side: which shots
+ * shot_auth_verify counts and which it refuses as replays or forgeries, and
+ * when shot_auth_is_clash reports another player with our shooter id. Every
+ * case has a shooter and a victim with the same match key, both fresh from
+ * the arena.
+ *
+ * Prints what a received frame costs, timed the way the IR controller times
+ * it for auth_cycles_max: shot_auth_is_clash and shot_auth_verify together,
+ * in cycles of the host's DWT stand-in. The maximum catches the odd
+ * preemption, the 99th percentile is the steadier number.
+ */
+
+#define SHOT_AUTH_TEST_KEY   0x5EED1234
+#define SHOT_AUTH_TEST_SPAN  (1 << SHOT_AUTH_COUNTER_BITS)
+#define SHOT_AUTH_TEST_SHOTS 64
+#define SHOT_AUTH_TEST_COST  10000
+
+typedef struct {
+    const char* name;
+    bool (*run)(ShotAuth* shooter, ShotAuth* victim);
+} ShotAuthCase;
+
+static uint32_t shot_auth_test_cycles[SHOT_AUTH_TEST_COST];
+
+// What the IR controller does with a frame, see infrared_controller_is_hit.
+static bool shot_auth_test_receive(ShotAuth* victim, uint32_t data) {
+    shot_auth_is_clash(victim, data, TeamBlue);
+    return shot_auth_verify(victim, data, TeamRed);
+}
+
+static int shot_auth_test_compare(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Fires count shots and keeps them, as a recording would.
+static void shot_auth_test_fire(ShotAuth* shooter, uint32_t* shots, size_t count) {
+    for(size_t i = 0; i < count; i++) {
+        shots[i] = shot_auth_next(shooter, TeamRed);
+    }
+}
+
+static void shot_auth_test_skip(ShotAuth* shooter, uint32_t count) {
+    shot_auth_set_counter(shooter, shot_auth_get_counter(shooter) + count);
+}
+
+static bool shot_auth_test_in_order(ShotAuth* shooter, ShotAuth* victim) {
+    for(uint32_t i = 0; i < 4 * SHOT_AUTH_TEST_SPAN; i++) {
+        if(!shot_auth_test_receive(victim, shot_auth_next(shooter, TeamRed))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool shot_auth_test_wrong_team(ShotAuth* shooter, ShotAuth* victim) {
+    // A red shot claiming to be blue fails the tag, not only the team check.
+    uint32_t shot = shot_auth_next(shooter, TeamRed);
+    return !shot_auth_verify(victim, shot, TeamBlue) &&
+           !shot_auth_verify(victim, shot ^ 1, TeamBlue) &&
+           shot_auth_verify(victim, shot, TeamRed);
+}
+
+static bool shot_auth_test_replay(ShotAuth* shooter, ShotAuth* victim) {
+    uint32_t shots[SHOT_AUTH_TEST_SHOTS];
+    shot_auth_test_fire(shooter, shots, COUNT_OF(shots));
+    for(size_t i = 0; i < COUNT_OF(shots); i++) {
+        if(!shot_auth_test_receive(victim, shots[i]) ||
+           shot_auth_test_receive(victim, shots[i])) {
+            return false;
+        }
+    }
+    // Still refused once they have fallen out of the window.
+    for(size_t i = 0; i < COUNT_OF(shots); i++) {
+        if(shot_auth_test_receive(victim, shots[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Shots overtaken in the air count as long as they are within the window of
+// the newest one seen, and only once.
+static bool shot_auth_test_below_window(ShotAuth* shooter, ShotAuth* victim) {
+    uint32_t shots[SHOT_AUTH_TEST_SHOTS];
+    shot_auth_test_fire(shooter, shots, COUNT_OF(shots));
+    size_t newest = COUNT_OF(shots) - 1;
+    if(!shot_auth_test_receive(victim, shots[newest])) {
+        return false;
+    }
+    for(size_t i = newest; i-- > 0;) {
+        bool in_window = newest - i < SHOT_AUTH_WINDOW_SIZE;
+        if(shot_auth_test_receive(victim, shots[i]) != in_window) {
+            return false;
+        }
+    }
+    return !shot_auth_test_receive(victim, shots[newest - 1]);
+}
+
+// A shooter who was out of sight keeps firing. The next shot seen counts
+// however far the counter moved, within one span or past it.
+static bool shot_auth_test_forward_jump(ShotAuth* shooter, ShotAuth* victim) {
+    uint32_t before[2];
+    shot_auth_test_fire(shooter, before, COUNT_OF(before));
+    if(!shot_auth_test_receive(victim, before[0])) {
+        return false;
+    }
+    shot_auth_test_skip(shooter, SHOT_AUTH_TEST_SPAN - SHOT_AUTH_WINDOW_SIZE);
+    if(!shot_auth_test_receive(victim, shot_auth_next(shooter, TeamRed))) {
+        return false;
+    }
+    shot_auth_test_skip(shooter, SHOT_AUTH_TEST_SPAN + SHOT_AUTH_TEST_SPAN / 2);
+    if(!shot_auth_test_receive(victim, shot_auth_next(shooter, TeamRed))) {
+        return false;
+    }
+    // The shot fired right after the first one was never seen, it is long gone.
+    return !shot_auth_test_receive(victim, before[1]);
+}
+
+// A shot recorded a full counter span ago has the same low bits as one that
+// is new now, the epoch in its tag gives it away.
+static bool shot_auth_test_epoch_rollover(ShotAuth* shooter, ShotAuth* victim) {
+    shot_auth_test_skip(shooter, SHOT_AUTH_TEST_SPAN - SHOT_AUTH_TEST_SHOTS / 2);
+    uint32_t shots[SHOT_AUTH_TEST_SHOTS];
+    shot_auth_test_fire(shooter, shots, COUNT_OF(shots));
+    for(size_t i = 0; i < COUNT_OF(shots); i++) {
+        if(!shot_auth_test_receive(victim, shots[i])) {
+            return false;
+        }
+    }
+    for(uint32_t i = 0; i < SHOT_AUTH_TEST_SPAN; i++) {
+        if(!shot_auth_test_receive(victim, shot_auth_next(shooter, TeamRed))) {
+            return false;
+        }
+    }
+    for(size_t i = 0; i < COUNT_OF(shots); i++) {
+        if(shot_auth_test_receive(victim, shots[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Shots fired just before the counter rolled into a new epoch, seen after the
+// first ones of the new epoch, are still within the window.
+static bool shot_auth_test_late_shot(ShotAuth* shooter, ShotAuth* victim) {
+    shot_auth_test_skip(shooter, SHOT_AUTH_TEST_SPAN - SHOT_AUTH_WINDOW_SIZE / 2);
+    uint32_t shots[SHOT_AUTH_WINDOW_SIZE];
+    shot_auth_test_fire(shooter, shots, COUNT_OF(shots));
+    size_t rollover = SHOT_AUTH_WINDOW_SIZE / 2;
+    for(size_t i = rollover; i < COUNT_OF(shots); i++) {
+        if(!shot_auth_test_receive(victim, shots[i])) {
+            return false;
+        }
+    }
+    for(size_t i = 0; i < rollover; i++) {
+        if(!shot_auth_test_receive(victim, shots[i]) ||
+           shot_auth_test_receive(victim, shots[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The shooter and the victim share a UID here, so the victim's shooter id is
+// the shooter's: the victim hears the shooter as a clash, and its own shots
+// coming back as echoes.
+static bool shot_auth_test_clash(ShotAuth* shooter, ShotAuth* victim) {
+    uint32_t own[SHOT_AUTH_WINDOW_SIZE];
+    for(size_t i = 0; i < COUNT_OF(own); i++) {
+        own[i] = shot_auth_next(victim, TeamRed);
+    }
+    for(size_t i = 0; i < COUNT_OF(own); i++) {
+        if(shot_auth_is_clash(victim, own[i], TeamRed)) {
+            return false;
+        }
+    }
+
+    // The other player is further along in the same epoch.
+    shot_auth_test_skip(shooter, SHOT_AUTH_TEST_SPAN / 2);
+    uint32_t other = shot_auth_next(shooter, TeamRed);
+    uint32_t forged = other ^ (1UL << (SHOT_AUTH_DATA_BITS - 1));
+    return shot_auth_is_clash(victim, other, TeamRed) &&
+           !shot_auth_is_clash(victim, forged, TeamRed);
+}
+
+static const ShotAuthCase shot_auth_cases[] = {
+    {"in_order", shot_auth_test_in_order},
+    {"wrong_team", shot_auth_test_wrong_team},
+    {"replay", shot_auth_test_replay},
+    {"below_window", shot_auth_test_below_window},
+    {"forward_jump", shot_auth_test_forward_jump},
+    {"epoch_rollover", shot_auth_test_epoch_rollover},
+    {"late_shot", shot_auth_test_late_shot},
+    {"clash", shot_auth_test_clash},
+};
+
+static void shot_auth_test_begin(ShotAuth** shooter, ShotAuth** victim) {
+    laser_tag_arena_reset();
+    *shooter = shot_auth_alloc();
+    *victim = shot_auth_alloc();
+    shot_auth_set_key(*shooter, SHOT_AUTH_TEST_KEY);
+    shot_auth_set_key(*victim, SHOT_AUTH_TEST_KEY);
+}
+
+int main(void) {
+    bool ok = true;
+    ShotAuth* shooter;
+    ShotAuth* victim;
+    for(size_t i = 0; i < COUNT_OF(shot_auth_cases); i++) {
+        shot_auth_test_begin(&shooter, &victim);
+        bool passed = shot_auth_cases[i].run(shooter, victim);
+        printf("%s %s\n", passed ? "ok  " : "FAIL", shot_auth_cases[i].name);
+        ok = ok && passed;
+    }
+
+    // Cost per frame in a steady stream of shots, rather than over the cases.
+    shot_auth_test_begin(&shooter, &victim);
+    for(uint32_t i = 0; i < SHOT_AUTH_TEST_COST; i++) {
+        uint32_t data = shot_auth_next(shooter, TeamRed);
+        uint32_t start = DWT->CYCCNT;
+        shot_auth_test_receive(victim, data);
+        shot_auth_test_cycles[i] = DWT->CYCCNT - start;
+    }
+    qsort(shot_auth_test_cycles, SHOT_AUTH_TEST_COST, sizeof(uint32_t), shot_auth_test_compare);
+    printf(
+        "%u frames: median %lu, p99 %lu, max %lu cycles at %lu MHz\n",
+        SHOT_AUTH_TEST_COST,
+        (unsigned long)shot_auth_test_cycles[SHOT_AUTH_TEST_COST / 2],
+        (unsigned long)shot_auth_test_cycles[SHOT_AUTH_TEST_COST * 99 / 100],
+        (unsigned long)shot_auth_test_cycles[SHOT_AUTH_TEST_COST - 1],
+        (unsigned long)furi_hal_cortex_instructions_per_microsecond());
+
+    laser_tag_arena_reset();
+    printf(ok ? "no failures\n" : "shot auth test failed\n");
+    return ok ? 0 : 1;
+}
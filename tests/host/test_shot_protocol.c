@@ -0,0 +1,96 @@
+#include "../../laser_tag_app.c"
+#include "host.h"
+#include <stdio.h>
+
+/*
+ * Checks the SECDED promise in shot_protocol.h for every protocol and both
+ * teams: a shot with any one payload bit flipped still decodes to the team
+ * that fired it, and one with any two bits flipped is rejected, never taken
+ * for the other team. Bits are flipped the way match_sim_shot does, address
+ * bits first, then command bits.
+ */
+
+static const LaserTagTeam shot_test_teams[] = {TeamRed, TeamBlue};
+
+// A NECext frame whose inverted bytes all match is reported as plain NEC by
+// the firmware decoder, with only the low bytes.
+static void shot_test_receive(InfraredMessage* message) {
+    if(message->protocol == InfraredProtocolNECext &&
+       ((message->address >> 8) & 0xFF) == (~message->address & 0xFF) &&
+       ((message->command >> 8) & 0xFF) == (~message->command & 0xFF)) {
+        message->protocol = InfraredProtocolNEC;
+        message->address &= 0xFF;
+        message->command &= 0xFF;
+    }
+}
+
+static bool shot_test_decode(
+    InfraredProtocol protocol,
+    LaserTagTeam team,
+    uint32_t error_mask,
+    LaserTagTeam* received) {
+    InfraredMessage message;
+    shot_protocol_encode(protocol, team, &message);
+    uint8_t address_length = infrared_get_protocol_address_length(message.protocol);
+    message.address ^= error_mask & ((1UL << address_length) - 1);
+    message.command ^= error_mask >> address_length;
+    shot_test_receive(&message);
+    return shot_protocol_decode(protocol, &message, received);
+}
+
+int main(void) {
+    bool ok = true;
+    InfraredProtocol protocol = InfraredProtocolNEC;
+    do {
+        const char* name = shot_protocol_get(protocol)->name;
+        InfraredProtocol frame = shot_protocol_get(protocol)->frame;
+        uint8_t length = infrared_get_protocol_address_length(frame) +
+                         infrared_get_protocol_command_length(frame);
+        uint32_t corrected = 0;
+        uint32_t rejected = 0;
+        uint32_t failures = 0;
+
+        for(size_t t = 0; t < COUNT_OF(shot_test_teams); t++) {
+            LaserTagTeam team = shot_test_teams[t];
+            LaserTagTeam received;
+            if(!shot_test_decode(protocol, team, 0, &received) || received != team) {
+                printf("FAIL %s team %d: clean shot not decoded\n", name, team);
+                failures++;
+            }
+            for(uint8_t i = 0; i < length; i++) {
+                if(shot_test_decode(protocol, team, 1UL << i, &received) && received == team) {
+                    corrected++;
+                } else {
+                    printf("FAIL %s team %d: bit %u not corrected\n", name, team, i);
+                    failures++;
+                }
+                for(uint8_t j = i + 1; j < length; j++) {
+                    if(!shot_test_decode(protocol, team, (1UL << i) | (1UL << j), &received)) {
+                        rejected++;
+                    } else {
+                        printf(
+                            "FAIL %s team %d: bits %u and %u taken for team %d\n",
+                            name,
+                            team,
+                            i,
+                            j,
+                            received);
+                        failures++;
+                    }
+                }
+            }
+        }
+
+        printf(
+            "%-8s %2u bits: %4lu single flips corrected, %5lu double flips rejected\n",
+            name,
+            length,
+            (unsigned long)corrected,
+            (unsigned long)rejected);
+        ok = ok && !failures;
+        protocol = shot_protocol_next(protocol);
+    } while(protocol != InfraredProtocolNEC);
+
+    printf(ok ? "no failures\n" : "shot protocol test failed\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,220 @@
+#include "../../laser_tag_app.c"
+#include "host.h"
+#include <stdatomic.h>
+
+/*
+ * Runs the app the way the firmware does, its main loop on a thread of its
+ * own and a GUI thread drawing it, and throws everything at it at once: keys,
+ * IR frames, RFID tags and the external board coming and going, each from a
+ * thread of its own, while the timer thread runs the board monitor and the
+ * hit feedback. The app is started three times, for open play, referee mode
+ * and a tournament match.
+ *
+ * Built with ThreadSanitizer by make tsan, which stops the run at the first
+ * data race. Without it this still checks that the app gets through all of it
+ * and exits cleanly.
+ */
+
+#define STRESS_GAME_MS       3000
+#define STRESS_REFEREE_MS    1500
+#define STRESS_TOURNAMENT_MS 2000
+#define STRESS_KEY_MS        5
+#define STRESS_EXIT_MS       10000
+
+#define STRESS_IR_PERIOD_MS    10
+#define STRESS_RFID_PERIOD_MS  15
+#define STRESS_BOARD_PERIOD_MS 250
+
+typedef struct {
+    InputKey key;
+    InputType type;
+} StressKey;
+
+// Everything a player does in a match, and what gets them from game over back
+// into one: OK restarts, Left picks a team.
+static const StressKey stress_game_keys[] = {
+    {InputKeyOk, InputTypePress},
+    {InputKeyOk, InputTypePress},
+    {InputKeyOk, InputTypePress},
+    {InputKeyOk, InputTypeShort},
+    {InputKeyUp, InputTypePress},
+    {InputKeyDown, InputTypePress},
+    {InputKeyLeft, InputTypeLong},
+    {InputKeyLeft, InputTypePress},
+};
+
+static atomic_bool stress_running;
+
+static int32_t stress_app_thread(void* context) {
+    atomic_bool* done = context;
+    int32_t code = laser_tag_app(NULL);
+    atomic_store(done, true);
+    return code;
+}
+
+// Shots from both teams and frames that are no shot at all, so every RX path
+// runs: hits, ignored friendly fire, rejects, and in tournament mode failed
+// authentication and shooter id clashes. Hits are the rarest, while one is
+// shown the player can't fire.
+static int32_t stress_ir_thread(void* context) {
+    UNUSED(context);
+    uint32_t frame = 0;
+    while(atomic_load(&stress_running)) {
+        InfraredMessage message;
+        switch(frame % 32) {
+        case 0:
+            shot_protocol_encode(InfraredProtocolNEC, TeamBlue, &message);
+            break;
+        case 1:
+        case 2:
+            shot_protocol_encode(InfraredProtocolNEC, TeamRed, &message);
+            break;
+        default:
+            shot_protocol_encode_data(InfraredProtocolNEC, frame * 2654435761UL, &message);
+            break;
+        }
+        host_infrared_inject(&message);
+        frame++;
+        furi_delay_ms(STRESS_IR_PERIOD_MS);
+    }
+    return 0;
+}
+
+// Ammo tags and the Red respawn point, each with another argument, so that
+// none of them is cooling down.
+static int32_t stress_rfid_thread(void* context) {
+    UNUSED(context);
+    uint8_t ammo[] = {0x13, 0x37, 0x00, 0xFD, 0x00};
+    uint8_t respawn[] = {0x13, 0x37, 0xA1, 0xF6, 0x00};
+    while(atomic_load(&stress_running)) {
+        uint8_t* tag = (ammo[4] % 2) ? respawn : ammo;
+        ammo[4]++;
+        tag[4] = ammo[4];
+        host_lfrfid_inject(tag, TAG_PAYLOAD_SIZE);
+        furi_delay_ms(STRESS_RFID_PERIOD_MS);
+    }
+    return 0;
+}
+
+static int32_t stress_board_thread(void* context) {
+    UNUSED(context);
+    bool connected = false;
+    while(atomic_load(&stress_running)) {
+        connected = !connected;
+        host_infrared_set_board(connected);
+        furi_delay_ms(STRESS_BOARD_PERIOD_MS);
+    }
+    host_infrared_set_board(false);
+    return 0;
+}
+
+static void stress_key(InputKey key, InputType type) {
+    host_gui_send_input(key, type);
+    furi_delay_ms(STRESS_KEY_MS);
+}
+
+static void stress_keys(const StressKey* keys, size_t count, uint32_t duration_ms) {
+    uint32_t start = furi_get_tick();
+    for(size_t i = 0; furi_get_tick() - start < duration_ms; i = (i + 1) % count) {
+        stress_key(keys[i].key, keys[i].type);
+    }
+}
+
+// Back leaves every screen but game over, which OK leaves.
+static bool stress_exit(FuriThread* app_thread, atomic_bool* done) {
+    uint32_t start = furi_get_tick();
+    while(!atomic_load(done)) {
+        if(furi_get_tick() - start > STRESS_EXIT_MS) {
+            return false;
+        }
+        stress_key(InputKeyBack, InputTypePress);
+        stress_key(InputKeyOk, InputTypePress);
+    }
+    furi_thread_join(app_thread);
+    return furi_thread_get_return_code(app_thread) == 0;
+}
+
+static void stress_game(void) {
+    stress_key(InputKeyLeft, InputTypePress);
+    stress_keys(stress_game_keys, COUNT_OF(stress_game_keys), STRESS_GAME_MS);
+}
+
+static void stress_referee(void) {
+    stress_key(InputKeyOk, InputTypeLong);
+    furi_delay_ms(STRESS_REFEREE_MS);
+    stress_key(InputKeyBack, InputTypePress);
+}
+
+// The first tag the RFID thread hands over while scanning is the match card.
+static void stress_tournament(void) {
+    stress_key(InputKeyOk, InputTypeShort);
+    furi_delay_ms(LASER_TAG_SCAN_TIMEOUT_MS / 10);
+    stress_key(InputKeyRight, InputTypePress);
+    stress_keys(stress_game_keys, COUNT_OF(stress_game_keys), STRESS_TOURNAMENT_MS);
+}
+
+static bool stress_run(const char* name, void (*drive)(void)) {
+    // A match left by Back would be offered for resuming, which takes the keys
+    // meant for the next run.
+    storage_common_remove(NULL, APP_DATA_PATH("checkpoint.bin"));
+
+    atomic_bool done = false;
+    FuriThread* app_thread =
+        furi_thread_alloc_ex("LaserTag", LASER_TAG_MAIN_STACK_SIZE, stress_app_thread, &done);
+    furi_thread_start(app_thread);
+    uint32_t frames = host_gui_get_frames();
+    uint32_t sent = host_infrared_get_sent();
+
+    // Keys sent before the view port is up are dropped.
+    uint32_t start = furi_get_tick();
+    while(host_gui_get_frames() == frames && furi_get_tick() - start < STRESS_EXIT_MS) {
+        furi_delay_ms(1);
+    }
+    drive();
+    bool exited = stress_exit(app_thread, &done);
+    if(exited) {
+        furi_thread_free(app_thread);
+    }
+
+    frames = host_gui_get_frames() - frames;
+    sent = host_infrared_get_sent() - sent;
+    printf(
+        "%s %-12s %5lu frames %4lu shots sent\n",
+        exited ? "ok  " : "FAIL",
+        name,
+        (unsigned long)frames,
+        (unsigned long)sent);
+    return exited && frames;
+}
+
+int main(void) {
+    host_gui_start();
+    atomic_store(&stress_running, true);
+    FuriThread* ir = furi_thread_alloc_ex("StressIr", 1024, stress_ir_thread, NULL);
+    FuriThread* rfid = furi_thread_alloc_ex("StressRfid", 1024, stress_rfid_thread, NULL);
+    FuriThread* board = furi_thread_alloc_ex("StressBoard", 1024, stress_board_thread, NULL);
+    furi_thread_start(ir);
+    furi_thread_start(rfid);
+    furi_thread_start(board);
+
+    bool ok = stress_run("game", stress_game);
+    ok = stress_run("referee", stress_referee) && ok;
+    ok = stress_run("tournament", stress_tournament) && ok;
+
+    atomic_store(&stress_running, false);
+    furi_thread_join(ir);
+    furi_thread_join(rfid);
+    furi_thread_join(board);
+    furi_thread_free(ir);
+    furi_thread_free(rfid);
+    furi_thread_free(board);
+    host_gui_stop();
+
+    uint32_t off_screen = host_gui_get_off_screen();
+    if(off_screen) {
+        printf("FAIL %lu drawing calls off screen\n", (unsigned long)off_screen);
+        ok = false;
+    }
+    printf(ok ? "no failures\n" : "stress test failed\n");
+    return ok ? 0 : 1;
+}
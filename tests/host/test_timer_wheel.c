@@ -0,0 +1,233 @@
+#include "../../laser_tag_app.c"
+#include "host.h"
+#include <stdatomic.h>
+#include <stdio.h>
+
+/*
+ * Randomized check of the timer wheel against a plain list of deadlines, on
+ * the manual clock. Timers are scheduled, rescheduled and cancelled at random
+ * delays, from a few ticks to past the longest delay the wheel holds, and
+ * their callbacks reschedule themselves and cancel or move other timers,
+ * including ones due on the same tick that haven't fired yet. The clock
+ * starts just before the tick counter wraps and crosses it early on.
+ *
+ * After every timer_wheel_run each timer must have fired exactly when the
+ * list says: once, on the first run at or after its deadline, never after it
+ * was cancelled, in deadline order, and timer_wheel_is_pending must agree.
+ */
+
+#define WHEEL_TEST_SEEDS  16
+#define WHEEL_TEST_STEPS  50000
+#define WHEEL_TEST_TIMERS 64
+#define WHEEL_TEST_START  (UINT32_MAX - 100000)
+
+typedef struct {
+    TimerWheelTimer timer;
+    uint32_t index;
+    bool pending;
+    uint32_t due;
+} WheelTestTimer;
+
+typedef struct {
+    uint32_t fired;
+    uint32_t scheduled;
+    uint32_t cancelled;
+    uint32_t in_callback;
+    uint32_t failures;
+} WheelTestStats;
+
+static TimerWheel* wheel_test_wheel;
+static WheelTestTimer wheel_test_timers[WHEEL_TEST_TIMERS];
+static uint32_t wheel_test_random_state;
+static uint32_t wheel_test_last_run; // tick of the previous timer_wheel_run
+static uint32_t wheel_test_last_due; // deadline of the last timer fired in this run
+static WheelTestStats wheel_test_stats;
+static atomic_uint wheel_test_wakes;
+
+static uint32_t wheel_test_random(uint32_t bound) {
+    // xorshift32
+    uint32_t x = wheel_test_random_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    wheel_test_random_state = x;
+    return x % bound;
+}
+
+static void wheel_test_fail(const char* what, const WheelTestTimer* timer) {
+    if(wheel_test_stats.failures++ < 10) {
+        printf(
+            "FAIL timer %lu %s: due %lu, tick %lu, last run %lu\n",
+            (unsigned long)timer->index,
+            what,
+            (unsigned long)timer->due,
+            (unsigned long)furi_get_tick(),
+            (unsigned long)wheel_test_last_run);
+    }
+}
+
+// Mostly short game delays, now and then one past the top level.
+static uint32_t wheel_test_delay(void) {
+    switch(wheel_test_random(8)) {
+    case 0:
+        return wheel_test_random(4);
+    case 1:
+        return wheel_test_random(1U << 20) + (1U << 20);
+    case 2:
+        return wheel_test_random(60000);
+    default:
+        return wheel_test_random(2000);
+    }
+}
+
+static void wheel_test_schedule(WheelTestTimer* timer) {
+    uint32_t delay = wheel_test_delay();
+    timer_wheel_schedule(wheel_test_wheel, &timer->timer, delay);
+    timer->pending = true;
+    timer->due = furi_get_tick() + MAX(delay, 1U);
+    wheel_test_stats.scheduled++;
+}
+
+static void wheel_test_cancel(WheelTestTimer* timer) {
+    timer_wheel_cancel(wheel_test_wheel, &timer->timer);
+    timer->pending = false;
+    wheel_test_stats.cancelled++;
+}
+
+// Prefers a timer due on the same tick that hasn't fired yet, it is on the
+// list timer_wheel_run is walking.
+static WheelTestTimer* wheel_test_other(const WheelTestTimer* timer) {
+    uint32_t start = wheel_test_random(WHEEL_TEST_TIMERS);
+    for(uint32_t i = 0; i < WHEEL_TEST_TIMERS; i++) {
+        WheelTestTimer* other = &wheel_test_timers[(start + i) % WHEEL_TEST_TIMERS];
+        if(other != timer && other->pending && other->due == timer->due) {
+            return other;
+        }
+    }
+    return &wheel_test_timers[start];
+}
+
+static void wheel_test_callback(void* context) {
+    WheelTestTimer* timer = context;
+    uint32_t now = furi_get_tick();
+    if(!timer->pending) {
+        wheel_test_fail("fired while not pending", timer);
+    } else if((int32_t)(now - timer->due) < 0) {
+        wheel_test_fail("fired early", timer);
+    } else if((int32_t)(timer->due - wheel_test_last_run) <= 0) {
+        wheel_test_fail("fired late", timer);
+    } else if((int32_t)(timer->due - wheel_test_last_due) < 0) {
+        wheel_test_fail("fired out of order", timer);
+    }
+    timer->pending = false;
+    wheel_test_last_due = timer->due;
+    wheel_test_stats.fired++;
+
+    if(timer_wheel_is_pending(&timer->timer)) {
+        wheel_test_fail("still pending in its callback", timer);
+    }
+
+    WheelTestTimer* other = wheel_test_other(timer);
+    switch(wheel_test_random(4)) {
+    case 0:
+        wheel_test_schedule(timer);
+        break;
+    case 1:
+        wheel_test_schedule(other);
+        break;
+    case 2:
+        wheel_test_cancel(other);
+        break;
+    default:
+        return;
+    }
+    wheel_test_stats.in_callback++;
+}
+
+static void wheel_test_wake(void* context) {
+    UNUSED(context);
+    atomic_fetch_add(&wheel_test_wakes, 1);
+}
+
+static void wheel_test_run(void) {
+    wheel_test_last_due = wheel_test_last_run;
+    timer_wheel_run(wheel_test_wheel);
+    uint32_t now = furi_get_tick();
+    for(size_t i = 0; i < WHEEL_TEST_TIMERS; i++) {
+        WheelTestTimer* timer = &wheel_test_timers[i];
+        if(timer->pending && (int32_t)(now - timer->due) >= 0) {
+            wheel_test_fail("missed", timer);
+            timer->pending = false;
+        }
+        if(timer_wheel_is_pending(&timer->timer) != timer->pending) {
+            wheel_test_fail("pending state wrong", timer);
+            timer->pending = timer_wheel_is_pending(&timer->timer);
+        }
+    }
+    wheel_test_last_run = now;
+}
+
+// Mostly a tick or two between runs, now and then a long stall, so that
+// timers parked in the top level live to see their deadline.
+static uint32_t wheel_test_advance(void) {
+    uint32_t kind = wheel_test_random(10);
+    if(kind == 0) {
+        return wheel_test_random(200000);
+    }
+    return kind < 4 ? wheel_test_random(100) : wheel_test_random(3);
+}
+
+static bool wheel_test_seed(uint32_t seed) {
+    wheel_test_random_state = seed * 2654435761UL + 1;
+    host_clock_set(WHEEL_TEST_START);
+    laser_tag_arena_reset();
+    wheel_test_wheel = timer_wheel_alloc(wheel_test_wake, NULL);
+    for(size_t i = 0; i < WHEEL_TEST_TIMERS; i++) {
+        WheelTestTimer* timer = &wheel_test_timers[i];
+        timer_wheel_timer_init(&timer->timer, wheel_test_callback, timer);
+        timer->index = i;
+        timer->pending = false;
+    }
+    wheel_test_last_run = furi_get_tick();
+
+    uint32_t failures = wheel_test_stats.failures;
+    for(uint32_t step = 0; step < WHEEL_TEST_STEPS; step++) {
+        WheelTestTimer* timer = &wheel_test_timers[wheel_test_random(WHEEL_TEST_TIMERS)];
+        uint32_t action = wheel_test_random(64);
+        if(action < 4) {
+            wheel_test_schedule(timer);
+        } else if(action == 4) {
+            wheel_test_cancel(timer);
+        }
+        host_clock_advance(wheel_test_advance());
+        wheel_test_run();
+    }
+    timer_wheel_free(wheel_test_wheel);
+    return wheel_test_stats.failures == failures;
+}
+
+int main(void) {
+    host_clock_set_manual(true);
+    bool ok = true;
+    for(uint32_t seed = 1; seed <= WHEEL_TEST_SEEDS; seed++) {
+        uint32_t start = WHEEL_TEST_START;
+        bool passed = wheel_test_seed(seed);
+        printf(
+            "%s seed %2lu: ran to tick %lu, %s\n",
+            passed ? "ok  " : "FAIL",
+            (unsigned long)seed,
+            (unsigned long)furi_get_tick(),
+            furi_get_tick() < start ? "wrapped" : "no wrap");
+        ok = ok && passed;
+    }
+    printf(
+        "%lu scheduled, %lu cancelled, %lu fired, %lu changes from callbacks\n",
+        (unsigned long)wheel_test_stats.scheduled,
+        (unsigned long)wheel_test_stats.cancelled,
+        (unsigned long)wheel_test_stats.fired,
+        (unsigned long)wheel_test_stats.in_callback);
+
+    laser_tag_arena_reset();
+    printf(ok ? "no failures\n" : "timer wheel test failed\n");
+    return ok ? 0 : 1;
+}
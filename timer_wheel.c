@@ -0,0 +1,258 @@
+#include "timer_wheel.h"
+#include "laser_tag_arena.h"
+#include <furi.h>
+
+#define TAG "TimerWheel"
+
+// Four levels of 32 slots. Level 0 has one tick per slot, every level above
+// covers 32 times the span of the one below: 32 ms, 1 s, 33 s and 17 minutes
+// at 1 kHz. Later deadlines are parked in the top level and re-inserted when
+// they come around.
+#define TIMER_WHEEL_LEVELS     4
+#define TIMER_WHEEL_SLOT_BITS  5
+#define TIMER_WHEEL_SLOTS      (1 << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_SLOT_MASK  (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_MAX_DELTA  ((1UL << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOT_BITS)) - 1)
+
+struct TimerWheel {
+    TimerWheelTimer* slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    uint32_t occupied[TIMER_WHEEL_LEVELS]; // bit n set: slot n is not empty
+    uint32_t now; // every slot up to this tick has been processed
+    uint32_t armed; // tick the FuriTimer fires at
+    bool is_armed;
+    FuriTimer* timer;
+    TimerWheelCallback wake_callback;
+    void* wake_context;
+};
+
+LASER_TAG_ARENA_CHECK(struct TimerWheel, LASER_TAG_ARENA_TIMER_WHEEL_SIZE);
+
+static void timer_wheel_timer_callback(void* context) {
+    TimerWheel* wheel = context;
+    wheel->wake_callback(wheel->wake_context);
+}
+
+static void timer_wheel_link(TimerWheel* wheel, TimerWheelTimer* timer) {
+    int32_t delta = timer->expires - wheel->now;
+    uint8_t level = 0;
+    uint8_t slot;
+
+    if(delta <= 0) {
+        // Cascaded down exactly when due: the current slot is processed next.
+        slot = wheel->now & TIMER_WHEEL_SLOT_MASK;
+    } else {
+        uint32_t expires = timer->expires;
+        if((uint32_t)delta > TIMER_WHEEL_MAX_DELTA) {
+            delta = TIMER_WHEEL_MAX_DELTA;
+            expires = wheel->now + TIMER_WHEEL_MAX_DELTA;
+        }
+        while((uint32_t)delta >> ((level + 1) * TIMER_WHEEL_SLOT_BITS)) {
+            level++;
+        }
+        slot = (expires >> (level * TIMER_WHEEL_SLOT_BITS)) & TIMER_WHEEL_SLOT_MASK;
+    }
+
+    TimerWheelTimer** head = &wheel->slots[level][slot];
+    timer->next = *head;
+    if(timer->next) {
+        timer->next->pprev = &timer->next;
+    }
+    timer->pprev = head;
+    *head = timer;
+    timer->level = level;
+    timer->slot = slot;
+    wheel->occupied[level] |= 1UL << slot;
+}
+
+static void timer_wheel_unlink(TimerWheel* wheel, TimerWheelTimer* timer) {
+    *timer->pprev = timer->next;
+    if(timer->next) {
+        timer->next->pprev = timer->pprev;
+    }
+    if(!wheel->slots[timer->level][timer->slot]) {
+        wheel->occupied[timer->level] &= ~(1UL << timer->slot);
+    }
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+// Moves a slot's timers into a local list the caller walks, so callbacks may
+// cancel or reschedule any timer, including ones still on that list.
+static void timer_wheel_detach(
+    TimerWheel* wheel,
+    uint8_t level,
+    uint8_t slot,
+    TimerWheelTimer** list) {
+    *list = wheel->slots[level][slot];
+    if(*list) {
+        (*list)->pprev = list;
+    }
+    wheel->slots[level][slot] = NULL;
+    wheel->occupied[level] &= ~(1UL << slot);
+}
+
+static void timer_wheel_cascade(TimerWheel* wheel, uint8_t level) {
+    uint8_t slot = (wheel->now >> (level * TIMER_WHEEL_SLOT_BITS)) & TIMER_WHEEL_SLOT_MASK;
+    TimerWheelTimer* list;
+    timer_wheel_detach(wheel, level, slot, &list);
+    while(list) {
+        TimerWheelTimer* timer = list;
+        list = timer->next;
+        if(list) {
+            list->pprev = &list;
+        }
+        timer_wheel_link(wheel, timer);
+    }
+}
+
+// Finds the next tick the wheel has work at: the next occupied level 0 slot,
+// or the next time an occupied slot of a higher level is cascaded down.
+static bool timer_wheel_next_event(TimerWheel* wheel, uint32_t* tick) {
+    bool found = false;
+    for(uint8_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        uint32_t occupied = wheel->occupied[level];
+        if(!occupied) {
+            continue;
+        }
+
+        // Rotate so bit 0 is the slot after the current one.
+        uint8_t shift = level * TIMER_WHEEL_SLOT_BITS;
+        uint8_t start = ((wheel->now >> shift) + 1) & TIMER_WHEEL_SLOT_MASK;
+        uint32_t rotated =
+            start ? (occupied >> start) | (occupied << (TIMER_WHEEL_SLOTS - start)) : occupied;
+        uint32_t distance = __builtin_ctz(rotated) + 1;
+        uint32_t next = ((wheel->now >> shift) + distance) << shift;
+
+        if(!found || (int32_t)(next - *tick) < 0) {
+            *tick = next;
+            found = true;
+        }
+    }
+    return found;
+}
+
+static void timer_wheel_arm(TimerWheel* wheel) {
+    uint32_t next;
+    if(!timer_wheel_next_event(wheel, &next)) {
+        furi_timer_stop(wheel->timer);
+        wheel->is_armed = false;
+        return;
+    }
+
+    if(wheel->is_armed && wheel->armed == next) {
+        return;
+    }
+
+    int32_t delay = next - furi_get_tick();
+    furi_timer_start(wheel->timer, MAX(delay, 1));
+    wheel->armed = next;
+    wheel->is_armed = true;
+}
+
+TimerWheel* timer_wheel_alloc(TimerWheelCallback wake_callback, void* context) {
+    furi_assert(wake_callback);
+
+    TimerWheel* wheel = laser_tag_arena_alloc(sizeof(TimerWheel));
+    memset(wheel, 0, sizeof(TimerWheel));
+    wheel->now = furi_get_tick();
+    wheel->wake_callback = wake_callback;
+    wheel->wake_context = context;
+    wheel->timer = furi_timer_alloc(timer_wheel_timer_callback, FuriTimerTypeOnce, wheel);
+    return wheel;
+}
+
+void timer_wheel_free(TimerWheel* wheel) {
+    furi_assert(wheel);
+    furi_timer_stop(wheel->timer);
+    furi_timer_free(wheel->timer);
+}
+
+void timer_wheel_timer_init(TimerWheelTimer* timer, TimerWheelCallback callback, void* context) {
+    furi_assert(timer);
+    memset(timer, 0, sizeof(TimerWheelTimer));
+    timer->callback = callback;
+    timer->context = context;
+}
+
+void timer_wheel_schedule(TimerWheel* wheel, TimerWheelTimer* timer, uint32_t delay_ms) {
+    furi_assert(wheel);
+    furi_assert(timer);
+
+    if(timer->pprev) {
+        timer_wheel_unlink(wheel, timer);
+    }
+
+    // The wheel only catches up with the tick counter in timer_wheel_run, but
+    // an empty wheel has nothing to catch up on.
+    uint32_t now = furi_get_tick();
+    bool empty = true;
+    for(uint8_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        empty &= !wheel->occupied[level];
+    }
+    if(empty) {
+        wheel->now = now;
+    }
+
+    timer->expires = now + MAX(furi_ms_to_ticks(delay_ms), 1UL);
+    timer_wheel_link(wheel, timer);
+    timer_wheel_arm(wheel);
+}
+
+void timer_wheel_cancel(TimerWheel* wheel, TimerWheelTimer* timer) {
+    furi_assert(wheel);
+    furi_assert(timer);
+
+    // The FuriTimer is left armed, a wake with nothing due is harmless.
+    if(timer->pprev) {
+        timer_wheel_unlink(wheel, timer);
+    }
+}
+
+bool timer_wheel_is_pending(const TimerWheelTimer* timer) {
+    furi_assert(timer);
+    return timer->pprev != NULL;
+}
+
+void timer_wheel_run(TimerWheel* wheel) {
+    furi_assert(wheel);
+
+    uint32_t target = furi_get_tick();
+
+    while((int32_t)(target - wheel->now) > 0) {
+        // Skip straight to the next slot that has anything to do.
+        uint32_t next;
+        if(!timer_wheel_next_event(wheel, &next) || (int32_t)(next - target) > 0) {
+            wheel->now = target;
+            break;
+        }
+        wheel->now = next;
+
+        for(uint8_t level = TIMER_WHEEL_LEVELS - 1; level > 0; level--) {
+            uint32_t below = wheel->now & ((1UL << (level * TIMER_WHEEL_SLOT_BITS)) - 1);
+            if(!below) {
+                timer_wheel_cascade(wheel, level);
+            }
+        }
+
+        TimerWheelTimer* list;
+        timer_wheel_detach(wheel, 0, wheel->now & TIMER_WHEEL_SLOT_MASK, &list);
+        while(list) {
+            TimerWheelTimer* timer = list;
+            list = timer->next;
+            if(list) {
+                list->pprev = &list;
+            }
+            timer->next = NULL;
+            timer->pprev = NULL;
+
+            if((int32_t)(timer->expires - wheel->now) > 0) {
+                // Was parked at the longest delay the wheel holds.
+                timer_wheel_link(wheel, timer);
+            } else {
+                timer->callback(timer->context);
+            }
+        }
+    }
+
+    timer_wheel_arm(wheel);
+}
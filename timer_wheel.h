@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Hierarchical timer wheel for game deadlines (splash timeout, HUD clock,
+ * scan timeouts, respawn and power-up timers...). Any number of timers share
+ * one FuriTimer, which is always armed to the next point the wheel has work
+ * to do. Scheduling and cancelling are O(1), and timers are embedded in their
+ * owner, so nothing is allocated.
+ *
+ * The wheel itself isn't thread safe: schedule, cancel and run must all be
+ * called from the same thread. When something is due, the wake callback is
+ * called from the timer thread, and the owner is expected to get
+ * timer_wheel_run called on its own thread, e.g. through its event queue.
+ * Expired timers' callbacks are called from timer_wheel_run.
+ */
+
+typedef struct TimerWheel TimerWheel;
+typedef struct TimerWheelTimer TimerWheelTimer;
+
+typedef void (*TimerWheelCallback)(void* context);
+
+struct TimerWheelTimer {
+    TimerWheelTimer* next;
+    TimerWheelTimer** pprev; // NULL if not pending
+    uint32_t expires; // tick
+    uint8_t level;
+    uint8_t slot;
+    TimerWheelCallback callback;
+    void* context;
+};
+
+TimerWheel* timer_wheel_alloc(TimerWheelCallback wake_callback, void* context);
+void timer_wheel_free(TimerWheel* wheel);
+
+void timer_wheel_timer_init(TimerWheelTimer* timer, TimerWheelCallback callback, void* context);
+
+/** Fire the timer after delay_ms, replacing its previous deadline if it is pending. */
+void timer_wheel_schedule(TimerWheel* wheel, TimerWheelTimer* timer, uint32_t delay_ms);
+void timer_wheel_cancel(TimerWheel* wheel, TimerWheelTimer* timer);
+bool timer_wheel_is_pending(const TimerWheelTimer* timer);
+
+/** Fire every timer that is due and re-arm the FuriTimer. */
+void timer_wheel_run(TimerWheel* wheel);